@@ -2,17 +2,170 @@
  * License, v. 2.0. If a copy of the MPL was not distributed with this
  * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
 
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include "basicgeometry.h"
 #include "exceptions.h"
 #include "utils.h"
 
 namespace ddb{
 
+namespace{
+
+// Geometry class codes (ISO WKB, also used by SpatiaLite)
+const uint32_t WkbPoint = 1;
+const uint32_t WkbLineString = 2;
+const uint32_t WkbPolygon = 3;
+const uint32_t WkbZ = 1000;
+
+bool isLittleEndian(){
+    const uint16_t one = 1;
+    return *reinterpret_cast<const uint8_t *>(&one) == 1;
+}
+
+template <typename T> void putValue(std::string &out, T v){
+    out.append(reinterpret_cast<const char *>(&v), sizeof(T));
+}
+
+// Start a WKB geometry in the host byte order
+std::string wkbHeader(uint32_t type, size_t capacity){
+    std::string out;
+    out.reserve(capacity);
+    out.push_back(isLittleEndian() ? 1 : 0);
+    putValue(out, type);
+    return out;
+}
+
+class BlobReader{
+    const uint8_t *p;
+    const uint8_t *end;
+    bool swap = false;
+public:
+    BlobReader(const uint8_t *p, const uint8_t *end) : p(p), end(end) {}
+
+    void setLittleEndian(bool littleEndian){
+        swap = littleEndian != isLittleEndian();
+    }
+
+    template <typename T> T read(){
+        if (static_cast<size_t>(end - p) < sizeof(T)) throw InvalidArgsException("Malformed geometry blob");
+        uint8_t buf[sizeof(T)];
+        memcpy(buf, p, sizeof(T));
+        p += sizeof(T);
+        if (swap) std::reverse(buf, buf + sizeof(T));
+
+        T v;
+        memcpy(&v, buf, sizeof(T));
+        return v;
+    }
+
+    void skip(size_t n){
+        if (static_cast<size_t>(end - p) < n) throw InvalidArgsException("Malformed geometry blob");
+        p += n;
+    }
+};
+
+struct GeometryClass{
+    uint32_t type = 0;
+    bool z = false;
+    bool m = false;
+
+    // SpatiaLite compressed geometries store the X, Y and Z of
+    // intermediate vertices as float offsets from the previous vertex
+    bool compressed = false;
+
+    // EWKB geometries can embed their SRID
+    bool srid = false;
+};
+
+GeometryClass parseClass(uint32_t code){
+    GeometryClass c;
+
+    // EWKB flags
+    c.z = (code & 0x80000000) != 0;
+    c.m = (code & 0x40000000) != 0;
+    c.srid = (code & 0x20000000) != 0;
+    code &= 0x0FFFFFFF;
+
+    if (code >= 1000000){
+        c.compressed = true;
+        code -= 1000000;
+    }
+
+    // ISO: 1000 = Z, 2000 = M, 3000 = ZM
+    switch (code / 1000){
+        case 0: break;
+        case 1: c.z = true; break;
+        case 2: c.m = true; break;
+        case 3: c.z = c.m = true; break;
+        default: throw InvalidArgsException("Unsupported geometry type " + std::to_string(code));
+    }
+    c.type = code % 1000;
+
+    return c;
+}
+
+void readPoints(BlobReader &r, const GeometryClass &c, uint32_t count, std::vector<Point> &out){
+    Point prev;
+    for (uint32_t i = 0; i < count; i++){
+        Point pt;
+        if (!c.compressed || i == 0 || i == count - 1){
+            pt.x = r.read<double>();
+            pt.y = r.read<double>();
+            if (c.z) pt.z = r.read<double>();
+        }else{
+            pt.x = prev.x + r.read<float>();
+            pt.y = prev.y + r.read<float>();
+            if (c.z) pt.z = prev.z + r.read<float>();
+        }
+
+        // M is never compressed, SpatiaLite stores it as
+        // a double for intermediate vertices too
+        if (c.m) r.read<double>();
+
+        out.push_back(pt);
+        prev = pt;
+    }
+}
+
+void readGeometry(BlobReader &r, const GeometryClass &c, std::vector<Point> &out){
+    switch (c.type){
+        case WkbPoint:
+            if (c.compressed) throw InvalidArgsException("Malformed geometry blob");
+            readPoints(r, c, 1, out);
+            break;
+        case WkbLineString:
+            readPoints(r, c, r.read<uint32_t>(), out);
+            break;
+        case WkbPolygon: {
+            // Exterior ring only
+            const uint32_t rings = r.read<uint32_t>();
+            if (rings > 0) readPoints(r, c, r.read<uint32_t>(), out);
+            break;
+        }
+        default:
+            throw InvalidArgsException("Unsupported geometry type " + std::to_string(c.type));
+    }
+}
+
+}
+
 std::string BasicPointGeometry::toWkt() const{
     if (empty()) return "";
     return utils::stringFormat("POINT Z (%lf %lf %lf)", points[0].x, points[0].y, points[0].z);
 }
 
+std::string BasicPointGeometry::toWkb() const{
+    if (empty()) return "";
+
+    std::string out = wkbHeader(WkbPoint + WkbZ, 5 + 3 * sizeof(double));
+    putValue(out, points[0].x);
+    putValue(out, points[0].y);
+    putValue(out, points[0].z);
+    return out;
+}
+
 json BasicPointGeometry::toGeoJSON() const{
     json j;
     initGeoJsonBase(j);
@@ -42,6 +195,20 @@ std::string BasicPolygonGeometry::toWkt() const{
     return os.str();
 }
 
+std::string BasicPolygonGeometry::toWkb() const{
+    if (empty()) return "";
+
+    std::string out = wkbHeader(WkbPolygon + WkbZ, 13 + points.size() * 3 * sizeof(double));
+    putValue(out, static_cast<uint32_t>(1));
+    putValue(out, static_cast<uint32_t>(points.size()));
+    for (auto &p : points){
+        putValue(out, p.x);
+        putValue(out, p.y);
+        putValue(out, p.z);
+    }
+    return out;
+}
+
 json BasicPolygonGeometry::toGeoJSON() const{
     json j;
     initGeoJsonBase(j);
@@ -63,6 +230,32 @@ json BasicPolygonGeometry::toGeoJSON() const{
     return j;
 }
 
+void BasicGeometry::fromBlob(const void *data, size_t size){
+    points.clear();
+    if (data == nullptr || size == 0) return;
+
+    const uint8_t *b = static_cast<const uint8_t *>(data);
+
+    // SpatiaLite: 0x00, endianness, SRID (4), MBR (32), 0x7C, class (4), ..., 0xFE
+    if (size >= 44 && b[0] == 0x00 && b[1] <= 0x01 && b[38] == 0x7C && b[size - 1] == 0xFE){
+        BlobReader r(b + 39, b + size - 1);
+        r.setLittleEndian(b[1] == 0x01);
+        const GeometryClass c = parseClass(r.read<uint32_t>());
+        if (c.srid) throw InvalidArgsException("Malformed geometry blob");
+        readGeometry(r, c, points);
+        return;
+    }
+
+    // WKB / EWKB
+    if (b[0] > 0x01) throw InvalidArgsException("Malformed geometry blob");
+    BlobReader r(b + 1, b + size);
+    r.setLittleEndian(b[0] == 0x01);
+    const GeometryClass c = parseClass(r.read<uint32_t>());
+    if (c.compressed) throw InvalidArgsException("Malformed geometry blob");
+    if (c.srid) r.skip(4);
+    readGeometry(r, c, points);
+}
+
 void BasicGeometry::addPoint(const Point &p){
     points.push_back(p);
 }
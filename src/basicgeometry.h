@@ -38,6 +38,14 @@ struct BasicGeometry{
     DDB_DLL virtual std::string toWkt() const = 0;
     DDB_DLL virtual json toGeoJSON() const = 0;
 
+    // Well known binary (ISO, with Z), empty if there are no points
+    DDB_DLL virtual std::string toWkb() const = 0;
+
+    // Replace the points with those of a SpatiaLite geometry blob or a
+    // WKB/EWKB geometry (points, linestrings and the exterior ring of
+    // polygons). A null or empty blob clears the geometry.
+    DDB_DLL void fromBlob(const void *data, size_t size);
+
     std::vector<Point> points;
 protected:
     void initGeoJsonBase(json &j) const;
@@ -55,11 +63,13 @@ inline std::ostream& operator<<(std::ostream& os, const BasicGeometry& g)
 struct BasicPointGeometry : BasicGeometry{
     DDB_DLL virtual std::string toWkt() const override;
     DDB_DLL virtual json toGeoJSON() const override;
+    DDB_DLL virtual std::string toWkb() const override;
 };
 
 struct BasicPolygonGeometry : BasicGeometry{
     DDB_DLL virtual std::string toWkt() const override;
     DDB_DLL virtual json toGeoJSON() const override;
+    DDB_DLL virtual std::string toWkb() const override;
 };
 
 enum BasicGeometryType {
@@ -0,0 +1,347 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+#include <algorithm>
+#include <cstring>
+#include "binarystamp.h"
+#include "exceptions.h"
+#include "hash.h"
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ddb {
+
+namespace {
+
+const size_t HeaderSize = 32;
+const size_t DigestSize = 32;
+const size_t TrailerSize = DigestSize * 2;
+
+enum HashType : uint8_t {
+    NoHash = 0,
+    SHA256Hash = 1,
+    OtherHash = 2
+};
+
+int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+// Decode a 64 characters (lowercase) hex string
+// @return false if s is not a SHA256 in hex form
+bool fromHex(const std::string &s, uint8_t *out) {
+    if (s.length() != DigestSize * 2) return false;
+
+    for (size_t i = 0; i < DigestSize; i++) {
+        const int hi = hexValue(s[i * 2]);
+        const int lo = hexValue(s[i * 2 + 1]);
+        if (hi < 0 || lo < 0) return false;
+        out[i] = static_cast<uint8_t>(hi << 4 | lo);
+    }
+
+    return true;
+}
+
+void toHex(const uint8_t *digest, std::string &out) {
+    static const char *digits = "0123456789abcdef";
+    out.resize(DigestSize * 2);
+    for (size_t i = 0; i < DigestSize; i++) {
+        out[i * 2] = digits[digest[i] >> 4];
+        out[i * 2 + 1] = digits[digest[i] & 0x0f];
+    }
+}
+
+void putU64(std::string &out, uint64_t v) {
+    for (int i = 0; i < 8; i++) out.push_back(static_cast<char>((v >> (i * 8)) & 0xff));
+}
+
+uint64_t getU64(const uint8_t *p) {
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; i--) v = v << 8 | p[i];
+    return v;
+}
+
+void putVarint(std::string &out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<char>((v & 0x7f) | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<char>(v));
+}
+
+uint64_t getVarint(const uint8_t *&p, const uint8_t *end) {
+    uint64_t v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (p >= end) break;
+        const uint8_t b = *p++;
+        v |= static_cast<uint64_t>(b & 0x7f) << shift;
+        if (!(b & 0x80)) return v;
+    }
+    throw AppException("Malformed binary stamp (truncated varint)");
+}
+
+const uint8_t *getBytes(const uint8_t *&p, const uint8_t *end, uint64_t len) {
+    if (len > static_cast<uint64_t>(end - p)) throw AppException("Malformed binary stamp (truncated data)");
+    const uint8_t *r = p;
+    p += len;
+    return r;
+}
+
+// Same definition as Database::getStamp
+std::string stampChecksum(const Stamp &stamp) {
+    SHA256 checksum;
+    for (const auto &e : stamp.entries) {
+        checksum.add(e.path.c_str(), e.path.length());
+        checksum.add(e.hash.c_str(), e.hash.length());
+    }
+    for (const auto &id : stamp.meta) checksum.add(id.c_str(), id.length());
+    return checksum.getHash();
+}
+
+}
+
+std::string encodeBinaryStamp(const Stamp &stamp) {
+    std::string out;
+    out.reserve(HeaderSize + stamp.entries.size() * 48 + stamp.meta.size() * 40 + TrailerSize);
+
+    out.append(DDB_BINARY_STAMP_MAGIC, 4);
+    out.push_back(static_cast<char>(DDB_BINARY_STAMP_VERSION));
+    out.append(3, '\0');
+    putU64(out, stamp.entries.size());
+    putU64(out, stamp.meta.size());
+    putU64(out, 0); // meta offset, set below
+
+    uint8_t digest[DigestSize];
+    const std::string *prev = nullptr;
+    for (const auto &e : stamp.entries) {
+        if (prev != nullptr && !(*prev < e.path)) throw InvalidArgsException("Stamp entries are not sorted");
+
+        size_t shared = 0;
+        if (prev != nullptr) {
+            const size_t n = std::min(prev->length(), e.path.length());
+            while (shared < n && (*prev)[shared] == e.path[shared]) shared++;
+        }
+        putVarint(out, shared);
+        putVarint(out, e.path.length() - shared);
+        out.append(e.path, shared, std::string::npos);
+
+        if (e.hash.empty()) {
+            out.push_back(static_cast<char>(NoHash));
+        } else if (fromHex(e.hash, digest)) {
+            out.push_back(static_cast<char>(SHA256Hash));
+            out.append(reinterpret_cast<const char *>(digest), DigestSize);
+        } else {
+            out.push_back(static_cast<char>(OtherHash));
+            putVarint(out, e.hash.length());
+            out.append(e.hash);
+        }
+
+        prev = &e.path;
+    }
+
+    const uint64_t metaOffset = out.size();
+    for (size_t i = 0; i < 8; i++) out[24 + i] = static_cast<char>((metaOffset >> (i * 8)) & 0xff);
+
+    for (const auto &id : stamp.meta) {
+        putVarint(out, id.length());
+        out.append(id);
+    }
+
+    // Stamps without a (valid) checksum get one computed from their contents
+    if (!fromHex(stamp.checksum, digest)) fromHex(stampChecksum(stamp), digest);
+    out.append(reinterpret_cast<const char *>(digest), DigestSize);
+
+    fromHex(Hash::dataSHA256(out.data(), out.size()), digest);
+    out.append(reinterpret_cast<const char *>(digest), DigestSize);
+
+    return out;
+}
+
+bool isBinaryStamp(const char *data, size_t size) {
+    return size >= 4 && memcmp(data, DDB_BINARY_STAMP_MAGIC, 4) == 0;
+}
+
+struct BinaryStamp::MappedFile {
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+#ifdef WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#endif
+
+    MappedFile(const fs::path &p) {
+#ifdef WIN32
+        file = CreateFileW(p.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                           OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) throw FSException("Cannot open " + p.string());
+
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize)) {
+            CloseHandle(file);
+            throw FSException("Cannot stat " + p.string());
+        }
+        size = static_cast<size_t>(fileSize.QuadPart);
+
+        mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping != nullptr) data = static_cast<const uint8_t *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        if (data == nullptr) {
+            if (mapping != nullptr) CloseHandle(mapping);
+            CloseHandle(file);
+            throw FSException("Cannot map " + p.string());
+        }
+#else
+        const int fd = ::open(p.string().c_str(), O_RDONLY);
+        if (fd == -1) throw FSException("Cannot open " + p.string());
+
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) {
+            close(fd);
+            throw FSException("Cannot read " + p.string());
+        }
+        size = static_cast<size_t>(st.st_size);
+
+        void *m = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (m == MAP_FAILED) throw FSException("Cannot map " + p.string());
+        data = static_cast<const uint8_t *>(m);
+#endif
+    }
+
+    ~MappedFile() {
+#ifdef WIN32
+        UnmapViewOfFile(data);
+        CloseHandle(mapping);
+        CloseHandle(file);
+#else
+        munmap(const_cast<uint8_t *>(data), size);
+#endif
+    }
+};
+
+BinaryStamp::BinaryStamp(const void *data, size_t size) :
+    data(static_cast<const uint8_t *>(data)), size(size) {
+    if (!isBinaryStamp(static_cast<const char *>(data), size))
+        throw AppException("Not a binary stamp");
+    if (size < HeaderSize + TrailerSize)
+        throw AppException("Malformed binary stamp (truncated header)");
+    if (this->data[4] != DDB_BINARY_STAMP_VERSION)
+        throw AppException("Unsupported binary stamp version " + std::to_string(this->data[4]));
+
+    std::string digest;
+    toHex(this->data + size - DigestSize, digest);
+    if (Hash::dataSHA256(this->data, size - DigestSize) != digest)
+        throw AppException("Corrupted binary stamp (checksum mismatch)");
+
+    entryCount = getU64(this->data + 8);
+    metaCount = getU64(this->data + 16);
+    metaOffset = getU64(this->data + 24);
+    if (metaOffset < HeaderSize || metaOffset > size - TrailerSize)
+        throw AppException("Malformed binary stamp (invalid meta offset)");
+}
+
+BinaryStamp BinaryStamp::open(const fs::path &file) {
+    auto f = std::make_shared<MappedFile>(file);
+    BinaryStamp s(f->data, f->size);
+    s.file = std::move(f);
+    return s;
+}
+
+BinaryStamp::Reader::Reader(const uint8_t *begin, const uint8_t *end, uint64_t count) :
+    p(begin), end(end), remaining(count) {}
+
+bool BinaryStamp::Reader::next() {
+    if (remaining == 0) return false;
+    remaining--;
+
+    const uint64_t shared = getVarint(p, end);
+    const uint64_t len = getVarint(p, end);
+    if (shared > path_.length()) throw AppException("Malformed binary stamp (invalid path prefix)");
+    const uint8_t *suffix = getBytes(p, end, len);
+    path_.resize(shared);
+    path_.append(reinterpret_cast<const char *>(suffix), len);
+
+    type = *getBytes(p, end, 1);
+    digest_ = nullptr;
+    hexed = true;
+    switch (type) {
+        case NoHash:
+            hash_.clear();
+            break;
+        case SHA256Hash:
+            digest_ = getBytes(p, end, DigestSize);
+            hexed = false;
+            break;
+        case OtherHash: {
+            const uint64_t hlen = getVarint(p, end);
+            hash_.assign(reinterpret_cast<const char *>(getBytes(p, end, hlen)), hlen);
+            break;
+        }
+        default:
+            throw AppException("Malformed binary stamp (unknown hash type)");
+    }
+
+    return true;
+}
+
+std::string_view BinaryStamp::Reader::hash() {
+    if (!hexed) {
+        toHex(digest_, hash_);
+        hexed = true;
+    }
+    return hash_;
+}
+
+std::vector<std::string> BinaryStamp::meta() const {
+    std::vector<std::string> result;
+    result.reserve(metaCount);
+
+    const uint8_t *p = data + metaOffset;
+    const uint8_t *end = data + size - TrailerSize;
+    for (uint64_t i = 0; i < metaCount; i++) {
+        const uint64_t len = getVarint(p, end);
+        result.emplace_back(reinterpret_cast<const char *>(getBytes(p, end, len)), len);
+    }
+
+    return result;
+}
+
+std::string BinaryStamp::checksum() const {
+    std::string h;
+    toHex(data + size - TrailerSize, h);
+    return h;
+}
+
+Stamp BinaryStamp::toStamp() const {
+    Stamp s;
+    s.entries.reserve(entryCount);
+
+    auto r = reader();
+    while (r.next()) s.entries.emplace_back(std::string(r.path()), std::string(r.hash()));
+    s.meta = meta();
+    s.checksum = checksum();
+
+    return s;
+}
+
+json BinaryStamp::toJSON() const {
+    json j;
+    j["entries"] = json::array();
+
+    auto r = reader();
+    while (r.next()) j["entries"].push_back(json::object({{std::string(r.path()), std::string(r.hash())}}));
+    j["meta"] = meta();
+    j["checksum"] = checksum();
+
+    return j;
+}
+
+}
@@ -0,0 +1,104 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+#ifndef BINARYSTAMP_H
+#define BINARYSTAMP_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "fs.h"
+#include "json.h"
+#include "simpleentry.h"
+#include "ddb_export.h"
+
+#define DDB_BINARY_STAMP_MAGIC "DDBS"
+#define DDB_BINARY_STAMP_VERSION 2
+
+namespace ddb {
+
+// Contents of a stamp, with entries sorted by path and meta ids sorted
+struct Stamp {
+    std::vector<SimpleEntry> entries;
+    std::vector<std::string> meta;
+    std::string checksum;
+};
+
+// Binary encoding of a stamp (all integers are little endian):
+//
+//   header   "DDBS", version (u8), 3 reserved bytes,
+//            entry count (u64), meta count (u64), offset of the meta ids (u64)
+//   entries  sorted by path: length of the prefix shared with the previous
+//            path (varint), length of the rest (varint), rest of the path,
+//            hash type (u8): 0 = none (directory), 1 = SHA256 as 32 raw bytes,
+//            2 = other (length (varint) + bytes)
+//   meta     sorted ids: length (varint) + bytes
+//   trailer  stamp checksum (SHA256, 32 raw bytes),
+//            SHA256 of all the preceding bytes (32 raw bytes)
+//
+// The last digest is checked whenever a stamp is read, so that
+// corrupted or truncated files are rejected with an AppException
+DDB_DLL std::string encodeBinaryStamp(const Stamp &stamp);
+
+// @return true if data starts like a binary stamp
+DDB_DLL bool isBinaryStamp(const char *data, size_t size);
+
+// Read-only view of a binary stamp. Data is used in place (from memory
+// or a memory mapped file) and entries are decoded one at a time.
+class BinaryStamp {
+    struct MappedFile;
+    std::shared_ptr<MappedFile> file;
+
+    const uint8_t *data;
+    size_t size;
+    uint64_t entryCount;
+    uint64_t metaCount;
+    uint64_t metaOffset;
+public:
+    // Sequential reader of the entries. Path and hash
+    // views are valid until the next call to next()
+    class Reader {
+        const uint8_t *p;
+        const uint8_t *end;
+        uint64_t remaining;
+        std::string path_;
+        std::string hash_;
+        const uint8_t *digest_ = nullptr;
+        uint8_t type = 0;
+        bool hexed = true;
+    public:
+        DDB_DLL Reader(const uint8_t *begin, const uint8_t *end, uint64_t count);
+
+        // Move to the next entry
+        // @return false when there are no more entries
+        DDB_DLL bool next();
+
+        std::string_view path() const { return path_; }
+        DDB_DLL std::string_view hash();
+        bool isDirectory() const { return type == 0; }
+
+        // Raw SHA256 of the entry, nullptr if the hash is not a SHA256
+        const uint8_t *digest() const { return digest_; }
+    };
+
+    // Data must outlive the stamp
+    // @throws AppException if data is not a valid binary stamp
+    DDB_DLL BinaryStamp(const void *data, size_t size);
+
+    // Memory map a binary stamp file
+    DDB_DLL static BinaryStamp open(const fs::path &file);
+
+    uint64_t entries() const { return entryCount; }
+    Reader reader() const { return Reader(data + 32, data + metaOffset, entryCount); }
+    DDB_DLL std::vector<std::string> meta() const;
+    DDB_DLL std::string checksum() const;
+
+    DDB_DLL Stamp toStamp() const;
+    DDB_DLL json toJSON() const;
+};
+
+}
+
+#endif // BINARYSTAMP_H
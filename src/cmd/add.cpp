@@ -19,6 +19,7 @@ void Add::setOptions(cxxopts::Options &opts) {
     .add_options()
     ("w,working-dir", "Working directory", cxxopts::value<std::string>()->default_value("."))
     ("r,recursive", "Recursively add subdirectories and files", cxxopts::value<bool>())
+    ("t,threads", "Number of threads used to parse files (0 = one per CPU core)", cxxopts::value<int>()->default_value("0"))
     ("p,paths", "Paths to add to index (files or directories)", cxxopts::value<std::vector<std::string>>());
     // clang-format on
     opts.parse_positional({"paths"});
@@ -36,6 +37,7 @@ void Add::run(cxxopts::ParseResult &opts) {
     const auto ddbPath = opts["working-dir"].as<std::string>();
     const auto paths = opts["paths"].as<std::vector<std::string>>();
     const auto recursive = opts.count("recursive") > 0;
+    const auto threads = opts["threads"].as<int>();
 
     const auto db = ddb::open(std::string(ddbPath), true);
     addToIndex(db.get(), ddb::expandPathList(paths, recursive, 0),
@@ -43,7 +45,7 @@ void Add::run(cxxopts::ParseResult &opts) {
                    std::cout << (updated ? "U\t" : "A\t") << e.path
                              << std::endl;
                    return true;
-               });
+               }, threads);
 }
 
 }  // namespace cmd
@@ -54,6 +54,11 @@ namespace cmd {
             const auto source = ddb::open(sourceDdbPath, false);
             const auto target = ddb::open(targetDdbPath, false);
 
+            // Bring the stamp trees up to date, so that
+            // the delta only reads the folders that differ
+            source->getStampTree()->update();
+            target->getStampTree()->update();
+
             ddb::delta(source.get(), target.get(), std::cout, format);
 			
 		}
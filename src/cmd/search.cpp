@@ -11,6 +11,7 @@
 
 #include "fs.h"
 #include "dbops.h"
+#include "utils.h"
 
 #include "exceptions.h"
 
@@ -23,6 +24,9 @@ namespace cmd {
             .custom_help("search '*file*'")
             .add_options()
             ("q,query", "Search query", cxxopts::value<std::string>())
+            ("bbox", "Only return entries intersecting a bounding box (minx,miny,maxx,maxy in EPSG:4326)", cxxopts::value<std::string>())
+            ("intersects", "Only return entries intersecting a WKT geometry (EPSG:4326)", cxxopts::value<std::string>())
+            ("filter", "Filter on entry fields, e.g. \"captureTime BETWEEN '2021-06-01' AND '2021-07-01' AND make = 'DJI'\" (fields: path, type, size, mtime, depth, captureTime, make, model, width, height, focalLength)", cxxopts::value<std::string>())
 			("w,working-dir", "Working directory", cxxopts::value<std::string>()->default_value("."))
 			("f,format", "Output format (text|json)", cxxopts::value<std::string>()->default_value("text"));
         // clang-format on
@@ -38,12 +42,28 @@ namespace cmd {
 		try {
 
 			const auto ddbPath = opts["working-dir"].as<std::string>();
-            const auto query = opts.count("query") > 0 ? opts["query"].as<std::string>() : "%";
+            const auto query = opts.count("query") > 0 ? opts["query"].as<std::string>() : "*";
 			const auto format = opts["format"].as<std::string>();
+
+            std::string intersects;
+            if (opts.count("bbox") > 0) {
+                const auto parts = ddb::utils::split(opts["bbox"].as<std::string>(), ",");
+                if (parts.size() != 4) throw ddb::InvalidArgsException("Invalid bbox");
+
+                try {
+                    intersects = ddb::bboxToWkt(std::stod(parts[0]), std::stod(parts[1]), std::stod(parts[2]), std::stod(parts[3]));
+                } catch (const std::logic_error &) {
+                    throw ddb::InvalidArgsException("Invalid bbox");
+                }
+            } else if (opts.count("intersects") > 0) {
+                intersects = opts["intersects"].as<std::string>();
+            }
 			
 			const auto db = ddb::open(std::string(ddbPath), true);
 
-            searchIndex(db.get(), query, std::cout, format);
+            const auto filter = opts.count("filter") > 0 ? opts["filter"].as<std::string>() : "";
+
+            searchIndex(db.get(), query, std::cout, format, intersects, filter);
 		}
 		catch (ddb::InvalidArgsException) {
 			printHelp();
@@ -16,17 +16,41 @@
 namespace ddb {
 
 void Database::afterOpen() {
-    spatialiteCache = spatialite_alloc_connection();
-    spatialite_init_ex(db, spatialiteCache, 0);
-    
+    // SpatiaLite is initialized on demand (see loadExtensions)
+    if (spatialiteCache != nullptr){
+        spatialite_cleanup_ex(spatialiteCache);
+        spatialiteCache = nullptr;
+    }
+
     this->setJournalMode("wal");
 
+    // Rows deleted by INSERT OR REPLACE must go through the delete
+    // triggers too (stamp tree, summary)
+    this->exec("PRAGMA recursive_triggers = ON");
+
     // If table is locked, sleep up to 30 seconds
     if (sqlite3_busy_timeout(db, 30000) != SQLITE_OK) {
         LOGD << "Cannot set busy timeout";
     }
 }
 
+void Database::ensureSpatialite() const{
+    if (spatialiteCache != nullptr) return;
+
+    LOGD << "Initializing SpatiaLite";
+    spatialiteCache = spatialite_alloc_connection();
+    spatialite_init_ex(db, spatialiteCache, 0);
+}
+
+// Most operations (stamps, meta, listing) never use geometry functions,
+// so SpatiaLite is only initialized the first time a statement needs it
+bool Database::loadExtensions() const{
+    if (spatialiteCache != nullptr) return false;
+
+    this->ensureSpatialite();
+    return true;
+}
+
 const char *entriesTableDdl = R"<<<(
   SELECT InitSpatialMetaData(1, 'NONE');
   SELECT InsertEpsgSrid(4326);
@@ -42,9 +66,36 @@ const char *entriesTableDdl = R"<<<(
   );
   SELECT AddGeometryColumn("entries", "point_geom", 4326, "POINTZ", "XYZ");
   SELECT AddGeometryColumn("entries", "polygon_geom", 4326, "POLYGONZ", "XYZ");
+  SELECT CreateSpatialIndex("entries", "point_geom");
+  SELECT CreateSpatialIndex("entries", "polygon_geom");
+)<<<";
 
+// Path lookups (see pathquery.h)
+const char *entriesIndexesDdl = R"<<<(
   CREATE INDEX IF NOT EXISTS ix_entries_type
   ON entries (type);
+  CREATE INDEX IF NOT EXISTS ix_entries_lower_path
+  ON entries (lower(path));
+  CREATE INDEX IF NOT EXISTS ix_entries_depth_path
+  ON entries (depth, path);
+  CREATE INDEX IF NOT EXISTS ix_entries_size
+  ON entries (size);
+)<<<";
+
+// Entry properties that can be searched (see entryfilter.cpp)
+const char *entriesPropertiesIndexesDdl = R"<<<(
+  CREATE INDEX IF NOT EXISTS ix_entries_capture_time
+  ON entries (json_extract(properties, '$.captureTime'));
+  CREATE INDEX IF NOT EXISTS ix_entries_make
+  ON entries (json_extract(properties, '$.make'));
+  CREATE INDEX IF NOT EXISTS ix_entries_model
+  ON entries (json_extract(properties, '$.model'));
+  CREATE INDEX IF NOT EXISTS ix_entries_width
+  ON entries (json_extract(properties, '$.width'));
+  CREATE INDEX IF NOT EXISTS ix_entries_height
+  ON entries (json_extract(properties, '$.height'));
+  CREATE INDEX IF NOT EXISTS ix_entries_focal_length
+  ON entries (json_extract(properties, '$.focalLength'));
 )<<<";
 
 const char *passwordsTableDdl = R"<<<(
@@ -79,8 +130,68 @@ BEGIN
 END;
 )<<<";
 
+const char *hashCacheTableDdl = R"<<<(
+  CREATE TABLE IF NOT EXISTS hash_cache (
+      dev INTEGER NOT NULL,
+      inode INTEGER NOT NULL,
+      size INTEGER NOT NULL,
+      mtime_ns INTEGER NOT NULL,
+      hash TEXT NOT NULL,
+      UNIQUE (dev, inode)
+  );
+)<<<";
+
+// Merkle tree of the index (see stamptree.h). Triggers record the parent
+// folder of every entry or meta row that changes in stamp_dirty
+const char *stampTreeDdl = R"<<<(
+  CREATE TABLE IF NOT EXISTS stamp_tree (
+      folder TEXT PRIMARY KEY,
+      depth INTEGER NOT NULL,
+      hash TEXT NOT NULL
+  );
+  CREATE INDEX IF NOT EXISTS ix_stamp_tree_depth_folder
+  ON stamp_tree (depth, folder);
+  CREATE TABLE IF NOT EXISTS stamp_dirty (
+      folder TEXT PRIMARY KEY
+  ) WITHOUT ROWID;
+
+CREATE TRIGGER IF NOT EXISTS tg_entries_stamp_insert
+AFTER INSERT ON entries
+BEGIN
+   INSERT OR IGNORE INTO stamp_dirty VALUES (rtrim(rtrim(NEW.path, replace(NEW.path, '/', '')), '/'));
+END;
+CREATE TRIGGER IF NOT EXISTS tg_entries_stamp_delete
+AFTER DELETE ON entries
+BEGIN
+   INSERT OR IGNORE INTO stamp_dirty VALUES (rtrim(rtrim(OLD.path, replace(OLD.path, '/', '')), '/'));
+END;
+CREATE TRIGGER IF NOT EXISTS tg_entries_stamp_update
+AFTER UPDATE OF path, hash ON entries
+BEGIN
+   INSERT OR IGNORE INTO stamp_dirty VALUES (rtrim(rtrim(OLD.path, replace(OLD.path, '/', '')), '/'));
+   INSERT OR IGNORE INTO stamp_dirty VALUES (rtrim(rtrim(NEW.path, replace(NEW.path, '/', '')), '/'));
+END;
+CREATE TRIGGER IF NOT EXISTS tg_entries_meta_stamp_insert
+AFTER INSERT ON entries_meta
+BEGIN
+   INSERT OR IGNORE INTO stamp_dirty VALUES (rtrim(rtrim(NEW.path, replace(NEW.path, '/', '')), '/'));
+END;
+CREATE TRIGGER IF NOT EXISTS tg_entries_meta_stamp_delete
+AFTER DELETE ON entries_meta
+BEGIN
+   INSERT OR IGNORE INTO stamp_dirty VALUES (rtrim(rtrim(OLD.path, replace(OLD.path, '/', '')), '/'));
+END;
+CREATE TRIGGER IF NOT EXISTS tg_entries_meta_stamp_update
+AFTER UPDATE OF id, path ON entries_meta
+BEGIN
+   INSERT OR IGNORE INTO stamp_dirty VALUES (rtrim(rtrim(OLD.path, replace(OLD.path, '/', '')), '/'));
+   INSERT OR IGNORE INTO stamp_dirty VALUES (rtrim(rtrim(NEW.path, replace(NEW.path, '/', '')), '/'));
+END;
+)<<<";
+
 Database &Database::createTables() {
     const std::string sql = std::string(entriesTableDdl) + '\n' +
+                            entriesIndexesDdl + '\n' +
                             passwordsTableDdl;
 
     LOGD << "About to create tables...";
@@ -90,8 +201,131 @@ Database &Database::createTables() {
     return *this;
 }
 
+// Dataset totals (see Database::getSummary). Empty bounds are stored as
+// +/-1e308 so that min()/max() can extend them without special cases.
+// Removing a row that lies on a bound can't shrink it incrementally:
+// the summary is flagged dirty and the bounds are recomputed on read,
+// until refreshSummary stores them again.
+const char *summaryTableDdl = R"<<<(
+  CREATE TABLE IF NOT EXISTS entries_summary (
+      id INTEGER PRIMARY KEY CHECK (id = 1),
+      entries INTEGER NOT NULL,
+      size INTEGER NOT NULL,
+      minx REAL NOT NULL,
+      miny REAL NOT NULL,
+      maxx REAL NOT NULL,
+      maxy REAL NOT NULL,
+      min_capture_time REAL NOT NULL,
+      max_capture_time REAL NOT NULL,
+      dirty INTEGER NOT NULL
+  );
+  CREATE TABLE IF NOT EXISTS entries_summary_types (
+      type INTEGER PRIMARY KEY,
+      count INTEGER NOT NULL
+  );
+)<<<";
+
+namespace {
+
+const char *summaryBounds[][2] = {{"minx", "MbrMinX"}, {"miny", "MbrMinY"},
+                                  {"maxx", "MbrMaxX"}, {"maxy", "MbrMaxY"}};
+
+bool isMinBound(const std::string &column){
+    return column.rfind("min", 0) == 0;
+}
+
+// Capture time of a row, NULL if missing or if properties are malformed
+// (json_extract would fail the statement and with it the trigger)
+std::string captureTimeSql(const std::string &row){
+    const std::string p = row + ".properties";
+    return "(CASE WHEN json_valid(" + p + ") THEN CASE WHEN json_type(" + p +
+           ", '$.captureTime') IN ('integer', 'real') THEN json_extract(" + p +
+           ", '$.captureTime') END END)";
+}
+
+// Add (NEW) or remove (OLD) a row from the summary
+std::string summaryUpdateSql(const std::string &row, bool add){
+    const std::string op = add ? " + " : " - ";
+    std::string sql = "UPDATE entries_summary SET entries = entries" + op + "1, "
+                      "size = size" + op + "coalesce(" + row + ".size, 0)";
+
+    if (add){
+        for (const auto &b : summaryBounds){
+            const std::string c = b[0];
+            const std::string f = isMinBound(c) ? "min" : "max";
+            const std::string empty = isMinBound(c) ? "1e308" : "-1e308";
+            sql += ", " + c + " = " + f + "(" + c +
+                   ", coalesce(" + b[1] + "(" + row + ".point_geom), " + empty + ")" +
+                   ", coalesce(" + b[1] + "(" + row + ".polygon_geom), " + empty + "))";
+        }
+        sql += ", min_capture_time = min(min_capture_time, coalesce(" + captureTimeSql(row) + ", 1e308))";
+        sql += ", max_capture_time = max(max_capture_time, coalesce(" + captureTimeSql(row) + ", -1e308))";
+    }else{
+        std::string onBound;
+        for (const auto &b : summaryBounds){
+            const std::string c = b[0];
+            const std::string cmp = isMinBound(c) ? " <= " : " >= ";
+            for (const std::string geom : {"point_geom", "polygon_geom"}){
+                onBound += std::string(b[1]) + "(" + row + "." + geom + ")" + cmp + c + " OR ";
+            }
+        }
+        onBound += captureTimeSql(row) + " <= min_capture_time OR " +
+                   captureTimeSql(row) + " >= max_capture_time";
+        sql += ", dirty = CASE WHEN " + onBound + " THEN 1 ELSE dirty END";
+    }
+    sql += " WHERE id = 1;\n";
+
+    if (add){
+        // Not INSERT OR IGNORE: an INSERT OR REPLACE on entries would
+        // turn it into a REPLACE, resetting the count
+        sql += "INSERT INTO entries_summary_types SELECT " + row + ".type, 0 WHERE " + row + ".type IS NOT NULL "
+               "AND NOT EXISTS (SELECT 1 FROM entries_summary_types WHERE type = " + row + ".type);\n";
+        sql += "UPDATE entries_summary_types SET count = count + 1 WHERE type = " + row + ".type;\n";
+    }else{
+        sql += "UPDATE entries_summary_types SET count = count - 1 WHERE type = " + row + ".type;\n";
+    }
+
+    return sql;
+}
+
+// Extent and capture time range of the entries table, in column order
+std::string summaryBoundsSql(){
+    std::string sql;
+    for (const auto &b : summaryBounds){
+        const std::string c = b[0];
+        const std::string f = isMinBound(c) ? "min" : "max";
+        const std::string empty = isMinBound(c) ? "1e308" : "-1e308";
+        sql += f + "(coalesce(" + f + "(" + b[1] + "(point_geom)), " + empty + "), " +
+               "coalesce(" + f + "(" + b[1] + "(polygon_geom)), " + empty + ")), ";
+    }
+    sql += "coalesce(min(" + captureTimeSql("entries") + "), 1e308), ";
+    sql += "coalesce(max(" + captureTimeSql("entries") + "), -1e308)";
+    return sql;
+}
+
+std::string summaryTriggersDdl(){
+    return "CREATE TRIGGER IF NOT EXISTS tg_entries_summary_insert\n"
+           "AFTER INSERT ON entries\nBEGIN\n" + summaryUpdateSql("NEW", true) + "END;\n"
+           "CREATE TRIGGER IF NOT EXISTS tg_entries_summary_delete\n"
+           "AFTER DELETE ON entries\nBEGIN\n" + summaryUpdateSql("OLD", false) + "END;\n"
+           "CREATE TRIGGER IF NOT EXISTS tg_entries_summary_update\n"
+           "AFTER UPDATE OF type, size, properties, point_geom, polygon_geom ON entries\nBEGIN\n" +
+           summaryUpdateSql("OLD", false) + summaryUpdateSql("NEW", true) + "END;\n";
+}
+
+}
+
 DDB_DLL void Database::ensureSchemaConsistency() {
 
+    // Databases already brought up to date skip all the probing below
+    // (the version is cleared while a bulk load is in progress)
+    const int version = this->getUserVersion();
+    if (version == DDB_SCHEMA_VERSION) return;
+    if (version > DDB_SCHEMA_VERSION){
+        LOGW << "Database schema version " << version << " is newer than this version of DroneDB (" << DDB_SCHEMA_VERSION << ")";
+        return;
+    }
+
     LOGD << "Ensuring schema consistency";
 
     if (!this->tableExists("entries")) {
@@ -100,6 +334,8 @@ DDB_DLL void Database::ensureSchemaConsistency() {
         LOGD << "Entries table created";
     }
 
+    this->ensureIndexes();
+
     if (!this->tableExists("passwords")) {
         LOGD << "Passwords table does not exist, creating it";
         this->exec(passwordsTableDdl);
@@ -112,6 +348,33 @@ DDB_DLL void Database::ensureSchemaConsistency() {
         LOGD << "Entries meta table created";
     }
 
+    // Schema version 1 keyed the hash cache on ctime
+    // and had no rowids for pruning; it's a cache, start over
+    if (version < 2 && this->tableExists("hash_cache")){
+        this->exec("DROP TABLE hash_cache");
+        LOGD << "Dropped old hash cache table";
+    }
+
+    if (!this->tableExists("hash_cache")){
+        LOGD << "Hash cache table does not exist, creating it";
+        this->exec(hashCacheTableDdl);
+        LOGD << "Hash cache table created";
+    }
+
+    if (!this->tableExists("stamp_tree")){
+        LOGD << "Stamp tree table does not exist, creating it";
+        this->exec(stampTreeDdl);
+        LOGD << "Stamp tree table created";
+    }
+
+    if (!this->tableExists("entries_summary")){
+        LOGD << "Entries summary table does not exist, creating it";
+        this->exec(summaryTableDdl);
+        this->exec(summaryTriggersDdl());
+        this->rebuildSummary();
+        LOGD << "Entries summary table created";
+    }
+
     // Migration from 0.9.11 to 0.9.12 (can be removed in the near future)
     // where we renamed "entries.meta" --> "entries.properties"
     // TODO: remove me in 2022
@@ -139,6 +402,99 @@ DDB_DLL void Database::ensureSchemaConsistency() {
         LOGD << "Dropped attributes table";
     }
 
+    this->setUserVersion(DDB_SCHEMA_VERSION);
+}
+
+void Database::ensureIndexes(){
+    this->exec(entriesIndexesDdl);
+
+    // Rows with malformed properties would make this fail,
+    // searches still work without these indexes (only slower)
+    try{
+        this->exec(entriesPropertiesIndexesDdl);
+    }catch(const SQLException &e){
+        LOGW << "Cannot index entry properties: " << e.what();
+    }
+
+    // Databases created before R*Tree indexes were maintained
+    // on the geometry columns, or after a bulk load
+    // (CreateSpatialIndex also fills them)
+    for (const std::string column : {"point_geom", "polygon_geom"}){
+        const auto q = this->query("SELECT spatial_index_enabled FROM geometry_columns WHERE f_table_name = 'entries' AND f_geometry_column = ?");
+        q->bind(1, column);
+        if (q->fetch() && q->getInt(0) == 0){
+            q->reset();
+            this->exec("SELECT CreateSpatialIndex('entries', '" + column + "')");
+            LOGD << "Created spatial index on entries." << column;
+        }
+    }
+}
+
+void Database::beginBulkLoad(const BulkLoadSettings &settings){
+    if (bulkLoading) throw DBException("Bulk load already in progress");
+
+    LOGD << "Beginning bulk load";
+
+    // Remember the current settings so that endBulkLoad can restore them
+    savedPragmas.clear();
+    for (const std::string pragma : {"synchronous", "cache_size", "mmap_size", "temp_store"}){
+        const auto q = this->query("PRAGMA " + pragma);
+        if (q->fetch()) savedPragmas.emplace_back(pragma, q->getInt64(0));
+    }
+
+    this->exec("PRAGMA synchronous = OFF");
+    this->exec("PRAGMA cache_size = " + std::to_string(-1024LL * settings.cacheSize));
+    this->exec("PRAGMA mmap_size = " + std::to_string(1024LL * 1024LL * settings.mmapSize));
+    this->exec("PRAGMA temp_store = MEMORY");
+
+    // Path and spatial indexes are rebuilt in one pass by endBulkLoad,
+    // which is much cheaper than maintaining them on every insert.
+    // Property indexes are kept: rebuilding them fails on rows with
+    // malformed properties, which ensureIndexes tolerates
+    std::vector<std::string> indexes;
+    {
+        const auto q = this->query("SELECT name FROM sqlite_master WHERE type = 'index' AND tbl_name = 'entries' AND sql IS NOT NULL AND sql NOT LIKE '%json_extract%'");
+        while (q->fetch()) indexes.push_back(q->getText(0));
+    }
+    for (const auto &index : indexes) this->exec("DROP INDEX IF EXISTS \"" + index + "\"");
+
+    for (const std::string column : {"point_geom", "polygon_geom"}){
+        this->exec("SELECT DisableSpatialIndex('entries', '" + column + "')");
+        this->exec("DROP TABLE IF EXISTS idx_entries_" + column);
+    }
+
+    // If the load doesn't complete, the next open restores the indexes
+    this->setUserVersion(0);
+
+    bulkLoading = true;
+}
+
+void Database::endBulkLoad(){
+    if (!bulkLoading) return;
+    bulkLoading = false;
+
+    LOGD << "Ending bulk load";
+
+    const auto restorePragmas = [this](){
+        for (const auto &p : savedPragmas){
+            this->exec("PRAGMA " + p.first + " = " + std::to_string(p.second));
+        }
+        savedPragmas.clear();
+    };
+
+    try{
+        this->ensureIndexes();
+    }catch(...){
+        restorePragmas();
+        throw;
+    }
+    this->setUserVersion(DDB_SCHEMA_VERSION);
+    restorePragmas();
+
+    this->exec("ANALYZE");
+    this->exec("PRAGMA wal_checkpoint(TRUNCATE)");
+
+    LOGD << "Bulk load completed";
 }
 
 json Database::getProperties() const {
@@ -159,14 +515,7 @@ json Database::getProperties() const {
         }
     }
 
-    // Count entries
-    {
-        const std::string sql = "SELECT COUNT(1) FROM entries";
-        const auto q = this->query(sql);
-        while (q->fetch()) {
-            j["entries"] = q->getInt(0);
-        }
-    }
+    j["entries"] = this->getSummary().entries;
 
     // Find meta
     {
@@ -206,22 +555,23 @@ json Database::getStamp() const{
     SHA256 checksum;
 
     auto q = this->query("SELECT path,hash FROM entries ORDER BY path ASC");
-    j["entries"] = json::array();
+    json &entries = j["entries"] = json::array();
     while (q->fetch()){
-        const std::string p = q->getText(0);
-        const std::string h = q->getText(1);
-        checksum.add(p.c_str(), p.length());
-        checksum.add(h.c_str(), h.length());
+        const auto [p, h] = q->getRow<std::string_view, std::string_view>();
+        checksum.add(p.data(), p.length());
+        checksum.add(h.data(), h.length());
 
-        j["entries"].push_back(json::object({{p, h}}));
+        json entry = json::object();
+        entry.emplace(std::string(p), std::string(h));
+        entries.push_back(std::move(entry));
     }
 
     q = this->query("SELECT id FROM entries_meta ORDER BY id ASC");
-    j["meta"] = json::array();
+    json &meta = j["meta"] = json::array();
     while (q->fetch()){
-        const std::string id = q->getText(0);
-        checksum.add(id.c_str(), id.length());
-        j["meta"].push_back(id);
+        const auto id = q->getTextView(0);
+        checksum.add(id.data(), id.length());
+        meta.emplace_back(std::string(id));
     }
 
     j["checksum"] = checksum.getHash();
@@ -258,20 +608,69 @@ std::string Database::getReadme() const{
     return "";
 }
 
+Summary Database::getSummary() const{
+    Summary s;
+
+    auto q = this->query("SELECT entries, size, dirty FROM entries_summary WHERE id = 1");
+    if (!q->fetch()) throw DBException("Entries summary is missing");
+    s.entries = q->getInt64(0);
+    s.size = q->getInt64(1);
+    const bool dirty = q->getInt(2) != 0;
+
+    // Stale bounds are computed without storing them (see refreshSummary)
+    if (dirty){
+        LOGD << "Computing summary bounds";
+        q = this->query("SELECT " + summaryBoundsSql() + " FROM entries");
+    }else{
+        q = this->query("SELECT minx, miny, maxx, maxy, min_capture_time, max_capture_time "
+                        "FROM entries_summary WHERE id = 1");
+    }
+    if (q->fetch()){
+        s.minx = q->getDouble(0);
+        s.miny = q->getDouble(1);
+        s.maxx = q->getDouble(2);
+        s.maxy = q->getDouble(3);
+        s.hasExtent = s.minx <= s.maxx && s.miny <= s.maxy;
+        s.minCaptureTime = q->getDouble(4);
+        s.maxCaptureTime = q->getDouble(5);
+        s.hasCaptureTime = s.minCaptureTime <= s.maxCaptureTime;
+    }
+
+    q = this->query("SELECT type, count FROM entries_summary_types WHERE count > 0 ORDER BY type");
+    while (q->fetch()){
+        s.types[static_cast<EntryType>(q->getInt(0))] = q->getInt64(1);
+    }
+
+    return s;
+}
+
+void Database::refreshSummary(){
+    const auto q = this->query("SELECT dirty FROM entries_summary WHERE id = 1");
+    if (!q->fetch() || q->getInt(0) == 0) return;
+
+    LOGD << "Recomputing summary bounds";
+    this->exec("UPDATE entries_summary SET (minx, miny, maxx, maxy, min_capture_time, max_capture_time, dirty) = "
+               "(SELECT " + summaryBoundsSql() + ", 0 FROM entries) WHERE id = 1");
+}
+
+void Database::rebuildSummary(){
+    this->exec("DELETE FROM entries_summary; DELETE FROM entries_summary_types;");
+    this->exec("INSERT INTO entries_summary SELECT 1, COUNT(*), coalesce(SUM(size), 0), " +
+               summaryBoundsSql() + ", 0 FROM entries");
+    this->exec("INSERT INTO entries_summary_types SELECT type, COUNT(*) FROM entries WHERE type IS NOT NULL GROUP BY type");
+}
+
 json Database::getExtent() const{
     json j;
     json j_null;
 
-    const auto sql = "SELECT AsWKT(Extent(GUnion(polygon_geom, ConvexHull(point_geom)))) AS bbox FROM entries";
-    const auto q = this->query(sql);
-    if (q->fetch()){
-        const auto bbox = wktBboxCoordinates(q->getText(0));
-        if (bbox.size() > 0){
-            j["spatial"] = {{"bbox", json::array({bbox}) }};
-        }
-    }
-
-    if (!j.contains("spatial")){
+    const auto s = this->getSummary();
+    if (s.hasExtent){
+        j["spatial"] = {{"bbox", json::array({
+                                   json::array({ s.minx, s.miny, s.maxx, s.maxy })
+                               })
+                        }};
+    }else{
         j["spatial"] = {{"bbox", json::array({
                                    json::array({
                                        0, 0, 0, 0, 0, 0
@@ -280,15 +679,17 @@ json Database::getExtent() const{
                         }};
     }
 
-    // No reliable temporal information is available
-    // TODO: some assets (geoimages) have temporal information
-    // perhaps there might be use in the future to populate it here
-    // Other ideas include using creation date / modification date, but
-    // these do not reflect the actual time of the assets
-    j["temporal"] = {{"interval", json::array({
-                                      json::array({j_null, j_null})
-                                  })
-                    }};
+    // Capture times of the assets (geoimages). Creation / modification
+    // dates are not used, they do not reflect the actual time of the assets
+    json interval = json::array({j_null, j_null});
+    if (s.hasCaptureTime){
+        const auto q = this->query("SELECT strftime('%Y-%m-%dT%H:%M:%fZ', ? / 1000.0, 'unixepoch'), "
+                                   "strftime('%Y-%m-%dT%H:%M:%fZ', ? / 1000.0, 'unixepoch')");
+        q->bind(1, s.minCaptureTime);
+        q->bind(2, s.maxCaptureTime);
+        if (q->fetch()) interval = json::array({q->getText(0), q->getText(1)});
+    }
+    j["temporal"] = {{"interval", json::array({ interval })}};
 
     return j;
 }
@@ -300,11 +701,37 @@ MetaManager *Database::getMetaManager(){
     return metaManager;
 }
 
+HashCache *Database::getHashCache(){
+    if (hashCache == nullptr){
+        hashCache = new HashCache(this);
+    }
+    return hashCache;
+}
+
+StampTree *Database::getStampTree(){
+    if (stampTree == nullptr){
+        stampTree = new StampTree(this);
+    }
+    return stampTree;
+}
+
 Database::~Database(){
     if (metaManager != nullptr){
         delete metaManager;
         metaManager = nullptr;
     }
+    if (hashCache != nullptr){
+        delete hashCache;
+        hashCache = nullptr;
+    }
+    if (stampTree != nullptr){
+        delete stampTree;
+        stampTree = nullptr;
+    }
+    // Cached statements might use SpatiaLite functions
+    if (statementCache != nullptr){
+        statementCache->clear();
+    }
     if (spatialiteCache != nullptr){
         spatialite_cleanup_ex(spatialiteCache);
         spatialiteCache = nullptr;
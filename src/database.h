@@ -6,24 +6,75 @@
 
 #define DDB_BUILD_PATH "build"
 
+// Stored in PRAGMA user_version once ensureSchemaConsistency has run.
+// Bump it whenever tables, indexes, triggers or migrations change.
+#define DDB_SCHEMA_VERSION 2
+
+#include <map>
+#include <vector>
 #include "metamanager.h"
+#include "hashcache.h"
+#include "stamptree.h"
 #include "sqlite_database.h"
 #include "ddb_export.h"
 #include "json.h"
 #include "constants.h"
+#include "entry_types.h"
 
 namespace ddb{
 
+// Dataset totals, maintained incrementally by triggers on entries
+struct Summary {
+    long long entries = 0;
+    long long size = 0;
+    std::map<EntryType, long long> types;
+
+    // Bounds of the point and polygon geometries (EPSG:4326)
+    bool hasExtent = false;
+    double minx = 0, miny = 0, maxx = 0, maxy = 0;
+
+    // Range of the entries' capture times (ms since epoch)
+    bool hasCaptureTime = false;
+    double minCaptureTime = 0, maxCaptureTime = 0;
+};
+
+// SQLite settings used while loading a fresh index (see Database::beginBulkLoad)
+struct BulkLoadSettings {
+    // Use bulk load mode when adding at least minPaths paths
+    // to an empty index
+    bool enabled = true;
+    int minPaths = 1000;
+
+    // Page cache size (MB)
+    int cacheSize = 256;
+
+    // Memory mapped I/O size (MB)
+    int mmapSize = 1024;
+};
+
 class Database : public SqliteDatabase {
   private:
     MetaManager *metaManager = nullptr;   
-    void *spatialiteCache = nullptr;
+    HashCache *hashCache = nullptr;
+    StampTree *stampTree = nullptr;
+    mutable void *spatialiteCache = nullptr;
+
+    bool bulkLoading = false;
+    std::vector<std::pair<std::string, long long>> savedPragmas;
+
+    void ensureIndexes();
+  protected:
+    bool loadExtensions() const override;
   public:
       DDB_DLL ~Database();
       DDB_DLL void afterOpen() override;
       DDB_DLL Database &createTables();
       DDB_DLL void ensureSchemaConsistency();
 
+      // Initialize SpatiaLite on this connection (done automatically
+      // the first time a statement uses a SpatiaLite function)
+      DDB_DLL void ensureSpatialite() const;
+
       DDB_DLL json getProperties() const;
       DDB_DLL json getStamp() const;
 
@@ -35,7 +86,31 @@ class Database : public SqliteDatabase {
       DDB_DLL std::string getReadme() const;
       DDB_DLL json getExtent() const;
 
+      // Read only. When removals invalidated the stored bounds,
+      // they are computed with a scan of entries
+      DDB_DLL Summary getSummary() const;
+
+      // Store the bounds invalidated by removals, so that
+      // getSummary can read them again
+      DDB_DLL void refreshSummary();
+      DDB_DLL void rebuildSummary();
+
+      // Bulk load mode: durability is turned off, caches are enlarged and
+      // the path and spatial indexes on entries are dropped until
+      // endBulkLoad, which rebuilds them, restores the previous settings
+      // and runs ANALYZE. Indexes on entry properties are kept. Meant for
+      // the initial load of an index: a power loss in between can corrupt
+      // the database. Cannot be used within a transaction.
+      DDB_DLL void beginBulkLoad(const BulkLoadSettings &settings);
+
+      // @throws if the indexes cannot be rebuilt (they are
+      // rebuilt again the next time the database is opened)
+      DDB_DLL void endBulkLoad();
+      bool isBulkLoading() const { return bulkLoading; }
+
       DDB_DLL MetaManager* getMetaManager();
+      DDB_DLL HashCache* getHashCache();
+      DDB_DLL StampTree* getStampTree();
 };
 
 DDB_DLL json wktBboxCoordinates(const std::string &wktBbox);
@@ -9,14 +9,22 @@
 
 
 #include <cstdlib>
+#include <deque>
+#include <future>
+#include <iomanip>
 
 #include "entry_types.h"
+#include "entrycursor.h"
+#include "entryfilter.h"
 #include "exceptions.h"
 #include "exif.h"
+#include "fswalker.h"
+#include "pathquery.h"
 #include "hash.h"
 #include "logger.h"
 #include "mio.h"
 #include "net.h"
+#include "threadpool.h"
 #include "userprofile.h"
 #include "utils.h"
 #include "version.h"
@@ -25,7 +33,7 @@ namespace ddb {
 
 #define UPDATE_QUERY                                                        \
     "UPDATE entries SET hash=?, type=?, properties=?, mtime=?, size=?, depth=?, " \
-    "point_geom=GeomFromText(?, 4326), polygon_geom=GeomFromText(?, 4326) " \
+    "point_geom=GeomFromWKB(?, 4326), polygon_geom=GeomFromWKB(?, 4326) " \
     "WHERE path=?"
 
 std::unique_ptr<Database> open(const std::string &directory,
@@ -71,8 +79,16 @@ std::vector<fs::path> getIndexPathList(const fs::path &rootDirectory,
                                        const std::vector<std::string> &paths,
                                        bool includeDirs) {
     std::vector<fs::path> result;
-    std::unordered_map<std::string, bool> directories;
+    walkIndexPathList(rootDirectory, paths, includeDirs, [&result](const fs::path &p) {
+        result.push_back(p);
+        return true;
+    });
+    return result;
+}
 
+bool walkIndexPathList(const fs::path &rootDirectory,
+                       const std::vector<std::string> &paths,
+                       bool includeDirs, const PathCallback &callback) {
     for (const std::string &p : paths) {
         if (p.empty()) throw FSException("Some paths are empty");
     }
@@ -84,76 +100,76 @@ std::vector<fs::path> getIndexPathList(const fs::path &rootDirectory,
 
     io::Path rootDir = rootDirectory;
 
+    // Directories already reported. If a directory is in the set,
+    // so are all of its parents (up to rootDirectory)
+    PathTrie directories;
+
+    const auto addDirectory = [&](const fs::path &p) {
+        if (!directories.insert(p)) return true;
+        return callback(p);
+    };
+
+    const auto addParents = [&](fs::path p) {
+        if (!includeDirs) return true;
+
+        while (p.has_parent_path() && p.string() != p.parent_path().string()) {
+            p = p.parent_path();
+            if (directories.contains(p)) break;
+            if (!rootDir.isParentOf(p)) break;
+
+            directories.insert(p);
+            if (!callback(p)) return false;
+        }
+
+        return true;
+    };
+
     for (fs::path p : paths) {
         // fs::directory_options::skip_permission_denied
         if (p.filename() == DDB_FOLDER) continue;
 
         if (fs::is_directory(p)) {
-            try {
-                for (auto i = fs::recursive_directory_iterator(p);
-                     i != fs::recursive_directory_iterator(); ++i) {
-                    fs::path rp = i->path();
+            if (!addDirectory(p) || !addParents(p)) return false;
 
-                    // Skip .ddb
-                    if (rp.filename() == DDB_FOLDER)
-                        i.disable_recursion_pending();
-
-                    if (fs::is_directory(rp) && includeDirs) {
-                        directories[rp.string()] = true;
-                    } else {
-                        result.push_back(rp);
-                    }
+            const bool completed = walkDirectory(p, [&](const fs::path &rp, bool isDirectory, int) {
+                // Skip .ddb
+                if (rp.filename() == DDB_FOLDER) return true;
 
-                    if (includeDirs) {
-                        while (rp.has_parent_path() &&
-                               rootDir.isParentOf(rp.parent_path()) &&
-                               rp.string() != rp.parent_path().string()) {
-                            rp = rp.parent_path();
-                            directories[rp.string()] = true;
-                        }
-                    }
+                if (isDirectory) {
+                    if (!addDirectory(rp)) return false;
+                } else {
+                    if (!callback(rp)) return false;
                 }
-            } catch (const fs::filesystem_error &e) {
-                throw FSException(e.what());
-            }
 
-            directories[p.string()] = true;
-            if (includeDirs) {
-                while (p.has_parent_path() &&
-                       rootDir.isParentOf(p.parent_path()) &&
-                       p.string() != p.parent_path().string()) {
-                    p = p.parent_path();
-                    directories[p.string()] = true;
-                }
-            }
+                return addParents(rp);
+            });
+
+            if (!completed) return false;
         } else if (fs::exists(p)) {
             // File
-            result.push_back(p);
-
-            if (includeDirs) {
-                while (p.has_parent_path() &&
-                       rootDir.isParentOf(p.parent_path()) &&
-                       p.string() != p.parent_path().string()) {
-                    p = p.parent_path();
-                    directories[p.string()] = true;
-                }
-            }
+            if (!callback(p) || !addParents(p)) return false;
         } else {
             throw FSException("Path does not exist: " + p.string());
         }
     }
 
-    for (auto [fst, snd] : directories) {
-        result.emplace_back(fst);
-    }
-
-    return result;
+    return true;
 }
 
 std::vector<fs::path> getPathList(const std::vector<std::string> &paths,
                                   bool includeDirs, int maxDepth, bool includeFiles) {
     std::vector<fs::path> result;
-    std::unordered_map<std::string, bool> directories;
+    walkPathList(paths, includeDirs, maxDepth, includeFiles, [&result](const fs::path &p) {
+        result.push_back(p);
+        return true;
+    });
+    return result;
+}
+
+bool walkPathList(const std::vector<std::string> &paths, bool includeDirs,
+                  int maxDepth, bool includeFiles, const PathCallback &callback) {
+    // -1 means direct children only
+    const int levels = maxDepth == -1 ? 1 : maxDepth;
 
     for (fs::path p : paths) {
         // fs::directory_options::skip_permission_denied
@@ -161,40 +177,19 @@ std::vector<fs::path> getPathList(const std::vector<std::string> &paths,
 
         try {
             if (fs::is_directory(p)) {
-                for (auto i = fs::recursive_directory_iterator(p);
-                     i != fs::recursive_directory_iterator(); ++i) {
-                    fs::path rp = i->path();
-
-                    // Ignore system files on Windows
-#ifdef WIN32
-                    const DWORD attrs =
-                        GetFileAttributesW(rp.wstring().c_str());
-                    if (attrs & FILE_ATTRIBUTE_HIDDEN ||
-                        attrs & FILE_ATTRIBUTE_SYSTEM) {
-                        i.disable_recursion_pending();
-                        continue;
-                    }
-#endif
-
-                    // Skip .ddb recursion
-                    if (rp.filename() == DDB_FOLDER)
-                        i.disable_recursion_pending();
-
-                    // Max depth
-                    if (maxDepth > 0 && i.depth() >= (maxDepth - 1))
-                        i.disable_recursion_pending();
-                    else if (maxDepth == -1)
-                        i.disable_recursion_pending();
-
-                    if (fs::is_directory(rp)) {
-                        if (includeDirs) result.push_back(rp);
+                const bool completed = walkDirectory(p, [&](const fs::path &rp, bool isDirectory, int) {
+                    if (isDirectory) {
+                        if (includeDirs) return callback(rp);
                     } else {
-                        if (includeFiles) result.push_back(rp);
+                        if (includeFiles) return callback(rp);
                     }
-                }
+                    return true;
+                }, levels, 0, true);
+
+                if (!completed) return false;
             } else if (fs::exists(p) && includeFiles) {
                 // File
-                result.push_back(p);
+                if (!callback(p)) return false;
             } else {
                 throw FSException("Path does not exist: " + p.string());
             }
@@ -203,7 +198,7 @@ std::vector<fs::path> getPathList(const std::vector<std::string> &paths,
         }
     }
 
-    return result;
+    return true;
 }
 
 std::vector<std::string> expandPathList(const std::vector<std::string> &paths,
@@ -224,8 +219,11 @@ std::vector<std::string> expandPathList(const std::vector<std::string> &paths,
     return result;
 }
 
-FileStatus checkUpdate(Entry &e, const fs::path &p, long long dbMtime,
-                 const std::string &dbHash) {
+// Checks whether the file of an existing entry was modified,
+// hashing it with hashFile when its modified time changed
+template <typename HashFn>
+FileStatus checkModified(Entry &e, const fs::path &p, long long dbMtime,
+                         const std::string &dbHash, HashFn hashFile) {
 
     if (!exists(p))
         return Deleted;
@@ -241,7 +239,7 @@ FileStatus checkUpdate(Entry &e, const fs::path &p, long long dbMtime,
         LOGD << p.string() << " modified time ( " << dbMtime
              << " ) differs from file value: " << e.mtime;
 
-        e.hash = Hash::fileSHA256(p.string());
+        e.hash = hashFile(p);
 
         if (dbHash != e.hash) {
             LOGD << p.string() << " hash differs (old: " << dbHash
@@ -254,25 +252,44 @@ FileStatus checkUpdate(Entry &e, const fs::path &p, long long dbMtime,
     return NotModified;
 }
 
+FileStatus checkUpdate(Entry &e, const fs::path &p, long long dbMtime,
+                 const std::string &dbHash, HashCache *hashCache, bool updateCache) {
+    return checkModified(e, p, dbMtime, dbHash, [hashCache, updateCache](const fs::path &p) {
+        return hashCache != nullptr ? hashCache->fileSHA256(p, updateCache) : Hash::fileSHA256(p.string());
+    });
+}
+
+// Bind WKB for GeomFromWKB (NULL for empty geometries)
+void bindGeometry(Statement *q, int paramNum, const std::string &wkb) {
+    if (wkb.empty()) q->bindNull(paramNum);
+    else q->bindBlob(paramNum, wkb.data(), wkb.size());
+}
+
 void doUpdate(Statement *updateQ, const Entry &e) {
+    // Values are bound without copies, they must outlive execute()
+    const std::string properties = e.properties.dump();
+    const std::string point = e.point_geom.toWkb();
+    const std::string polygon = e.polygon_geom.toWkb();
+
     // Fields
-    updateQ->bind(1, e.hash);
+    updateQ->bind(1, std::string_view(e.hash));
     updateQ->bind(2, e.type);
-    updateQ->bind(3, e.properties.dump());
+    updateQ->bind(3, std::string_view(properties));
     updateQ->bind(4, static_cast<long long>(e.mtime));
     updateQ->bind(5, static_cast<long long>(e.size));
     updateQ->bind(6, e.depth);
-    updateQ->bind(7, e.point_geom.toWkt());
-    updateQ->bind(8, e.polygon_geom.toWkt());
+    bindGeometry(updateQ, 7, point);
+    bindGeometry(updateQ, 8, polygon);
 
     // Where
-    updateQ->bind(9, e.path);
+    updateQ->bind(9, std::string_view(e.path));
 
     updateQ->execute();
 }
 
-void listIndex(Database* db, const std::vector<std::string>& paths, std::ostream& output, const std::string& format, bool recursive, int maxRecursionDepth) {
-    if (format != "json" && format != "text") throw InvalidArgsException("Invalid format " + format);
+std::unique_ptr<EntryCursor> listIndexCursor(Database* db, const std::vector<std::string>& paths, bool recursive, int maxRecursionDepth, bool pathOnly) {
+    if (maxRecursionDepth < 0)
+        throw FSException("Max recursion depth cannot be negative");
 
     const fs::path directory = db->rootDirectory();
     std::vector<fs::path> pathList;
@@ -288,7 +305,9 @@ void listIndex(Database* db, const std::vector<std::string>& paths, std::ostream
         pathList.emplace_back(root.isParentOf(fs::current_path()) ? io::Path(currentPath).generic() : directory.string());
     }else pathList = std::vector<fs::path>(paths.begin(), paths.end());
 
-    std::vector<Entry> baseEntries;
+    // Base entries are those matching the paths (at the same depth)
+    std::string baseCond;
+    std::vector<std::pair<PathCondition, int>> baseParams;
     bool expandFolders = recursive;
 
     for (const fs::path& path : pathList) {
@@ -300,116 +319,277 @@ void listIndex(Database* db, const std::vector<std::string>& paths, std::ostream
         expandFolders = expandFolders || pathStr.length() > 0;
 
         const auto depth = static_cast<int>(count(pathStr.begin(), pathStr.end(), '/'));
-        std::vector<Entry> matches = getMatchingEntries(db, relPath.generic(), depth + 1);
-        baseEntries.insert(baseEntries.end(), matches.begin(), matches.end());
+
+        auto cond = patternCondition(pathStr);
+
+        if (!baseCond.empty()) baseCond += " OR ";
+        baseCond += "(" + cond.sql + " AND depth <= ?)";
+        baseParams.emplace_back(std::move(cond), depth);
     }
 
-    // Remove duplicates
-    sort(baseEntries.begin(), baseEntries.end(), [](const Entry& l, const Entry& r)
-        {
-            return l.path < r.path;
-        });
-    baseEntries.erase(unique(baseEntries.begin(), baseEntries.end(), [](const Entry& l, const Entry& r)
-        {
-            return l.path == r.path;
-        }), baseEntries.end());
-
-    // Sort by type
-    sort(baseEntries.begin(), baseEntries.end(), [](const Entry& l, const Entry& r)
-        {
-            return l.type < r.type;
-        });
+    const std::string baseSql = "SELECT path, type, depth FROM entries WHERE " + baseCond;
+    const auto bindBase = [&baseParams](Statement *q) {
+        int i = 1;
+        for (const auto &p : baseParams) {
+            i = p.first.bind(q, i);
+            q->bind(i++, p.second);
+        }
+    };
+
+    // When a single folder is listed, we show its contents only
+    bool isSingle;
+    {
+        auto q = db->query("SELECT COUNT(*) FROM (" + baseSql + ")");
+        bindBase(q.get());
+        q->fetch();
+        isSingle = static_cast<size_t>(q->getInt64(0)) == pathList.size();
+    }
 
-    const bool isSingle = pathList.size() == baseEntries.size();
+    const std::string dirType = std::to_string(static_cast<int>(EntryType::Directory));
+    std::string sql = "WITH base AS (" + baseSql + "), selected(path) AS (SELECT path FROM base";
+    if (isSingle && expandFolders) sql += " WHERE type <> " + dirType;
 
-    std::vector<Entry> outputEntries;
+    if (expandFolders) {
+        // Folder contents, as a range scan on the primary key
+        // or on the (depth, path) index for direct children
+        sql += " UNION SELECT e.path FROM base b JOIN entries e "
+               "ON e.path >= b.path || '/' AND e.path < b.path || '0' "
+               "WHERE b.type = " + dirType;
 
-    for (const Entry& entry : baseEntries) {
-        if (entry.type != Directory) outputEntries.emplace_back(Entry(entry));
-        else {
-            if (!isSingle || !expandFolders)
-                outputEntries.emplace_back(Entry(entry));
+        if (!recursive) sql += " AND e.depth = b.depth + 1";
+        else if (maxRecursionDepth > 0) sql += " AND e.depth <= " + std::to_string(maxRecursionDepth - 1);
+    }
 
-            if (expandFolders) {
-                const auto depth = recursive ? maxRecursionDepth : entry.depth + 2;
-                std::vector<Entry> entries = getMatchingEntries(db, entry.path, depth, true);
-                for (const Entry& e : entries) outputEntries.emplace_back(Entry(e));
-            }
-        }
+    sql += ") SELECT ";
+    sql += pathOnly ? "e.path" : entryCursorColumns;
+    sql += " FROM selected s JOIN entries e ON e.path = s.path ORDER BY e.path";
+
+    auto q = db->query(sql);
+    bindBase(q.get());
+
+    return std::make_unique<EntryCursor>(std::move(q), pathOnly);
+}
+
+void listIndex(Database* db, const std::vector<std::string>& paths, std::ostream& output, const std::string& format, bool recursive, int maxRecursionDepth) {
+    if (format != "json" && format != "text") throw InvalidArgsException("Invalid format " + format);
+
+    auto cursor = listIndexCursor(db, paths, recursive, maxRecursionDepth, format == "text");
+    writeEntries(*cursor, output, format);
+}
+
+std::unique_ptr<EntryCursor> searchIndexCursor(Database* db, const std::string &query, bool pathOnly, const std::string &intersects, const std::string &filter){
+    LOGD << "Query: " << query;
+
+    const auto cond = patternCondition(query, "e.path");
+
+    std::string sql = "SELECT ";
+    sql += pathOnly ? "e.path" : entryCursorColumns;
+    sql += " FROM entries e WHERE " + cond.sql;
+
+    std::vector<double> mbr;
+
+    if (!intersects.empty()) {
+        LOGD << "Intersects: " << intersects;
+
+        // Bounds of the search area, to query the R*Tree indexes
+        auto q = db->query("SELECT MbrMinX(g), MbrMinY(g), MbrMaxX(g), MbrMaxY(g) FROM (SELECT GeomFromText(?, 4326) AS g) WHERE g IS NOT NULL");
+        q->bind(1, intersects);
+        if (!q->fetch()) throw InvalidArgsException("Invalid geometry: " + intersects);
+        for (int i = 0; i < 4; i++) mbr.push_back(q->getDouble(i));
+
+        // Candidates come from the index, then we check the actual geometries
+        const auto intersecting = [](const std::string &column) {
+            return "(e.rowid IN (SELECT pkid FROM idx_entries_" + column + " WHERE "
+                   "xmax >= ? AND ymax >= ? AND xmin <= ? AND ymin <= ?) AND "
+                   "Intersects(e." + column + ", GeomFromText(?, 4326)) = 1)";
+        };
+
+        sql += " AND (" + intersecting("point_geom") + " OR " + intersecting("polygon_geom") + ")";
     }
 
-    // Sort by path
-    std::sort(outputEntries.begin(), outputEntries.end(), [](const Entry& l, const Entry& r)
-        {
-            return l.path < r.path;
-        });
+    const auto entryFilter = parseEntryFilter(filter);
+    if (!entryFilter.sql.empty()) {
+        LOGD << "Filter: " << entryFilter.sql;
+
+        // The unary + keeps SQLite from walking the primary key to avoid
+        // sorting, so that the index of the filtered field is used instead
+        sql += " AND " + entryFilter.sql + " ORDER BY +e.path";
+    } else {
+        sql += " ORDER BY e.path";
+    }
 
-    if (format == "text"){
-        for (auto& e : outputEntries){
-            output << e.path << std::endl;
+    auto q = db->query(sql);
+    int i = cond.bind(q.get());
+
+    if (!intersects.empty()) {
+        for (int k = 0; k < 2; k++) {
+            for (const double v : mbr) q->bind(i++, v);
+            q->bind(i++, intersects);
         }
-    }else if (format == "json"){
-        output << "[";
-        bool first = true;
+    }
 
-        for (auto& e : outputEntries){
+    entryFilter.bind(q.get(), i);
 
-            json j;
-            e.toJSON(j);
-            if (!first) output << ",";
-            output << j.dump();
+    return std::make_unique<EntryCursor>(std::move(q), pathOnly);
+}
 
-            first = false;
-        }
+void searchIndex(Database* db, const std::string &query, std::ostream& out, const std::string& format, const std::string &intersects, const std::string &filter){
+    if (format != "json" && format != "text") return;
 
-        output << "]";
-    }else{
-        throw InvalidArgsException("Unsupported format '" + format + "'");
-    }
+    auto cursor = searchIndexCursor(db, query, format == "text", intersects, filter);
+    writeEntries(*cursor, out, format);
 }
 
+std::string bboxToWkt(double minx, double miny, double maxx, double maxy){
+    if (minx > maxx || miny > maxy) throw InvalidArgsException("Invalid bounding box");
 
-void searchIndex(Database* db, const std::string &query, std::ostream& out, const std::string& format){
-    auto entries = getMatchingEntries(db, query, 0, false);
-    std::sort(entries.begin(), entries.end(), [](const Entry& l, const Entry& r)
-        {
-            return l.path < r.path;
-        });
+    std::ostringstream ss;
+    ss << std::setprecision(17) << "POLYGON((" <<
+          minx << " " << miny << ", " << maxx << " " << miny << ", " <<
+          maxx << " " << maxy << ", " << minx << " " << maxy << ", " <<
+          minx << " " << miny << "))";
+    return ss.str();
+}
 
-    if (format == "text"){
-        for (auto& e : entries) out << e.path << std::endl;
-    }else if (format == "json"){
-        out << "[";
-        bool first = true;
-        for (auto& e : entries){
-            json j;
-            e.toJSON(j);
-            if (!first) out << ",";
-            out << j.dump();
-            first = false;
-        }
-        out << "]";
+
+void doInsert(Statement *insertQ, const Entry &e) {
+    // Values are bound without copies, they must outlive execute()
+    const std::string properties = e.properties.dump();
+    const std::string point = e.point_geom.toWkb();
+    const std::string polygon = e.polygon_geom.toWkb();
+
+    insertQ->bind(1, std::string_view(e.path));
+    insertQ->bind(2, std::string_view(e.hash));
+    insertQ->bind(3, e.type);
+    insertQ->bind(4, std::string_view(properties));
+    insertQ->bind(5, static_cast<long long>(e.mtime));
+    insertQ->bind(6, static_cast<long long>(e.size));
+    insertQ->bind(7, e.depth);
+    bindGeometry(insertQ, 8, point);
+    bindGeometry(insertQ, 9, polygon);
+
+    insertQ->execute();
+}
+
+// Work item of addToIndex: everything a worker needs
+// to know about a path without touching the database
+struct AddTask {
+    fs::path path;
+    bool add = false;
+    long long dbMtime = 0;
+    std::string dbHash;
+
+    // Hash cache state, looked up by the writer
+    bool hasStamp = false;
+    FileStamp stamp;
+    std::string cachedHash;
+};
+
+struct AddResult {
+    bool add = false;
+    bool changed = false;
+    Entry e;
+
+    // The hash was computed and should be stored in the hash cache
+    bool storeHash = false;
+    FileStamp stamp;
+};
+
+// Hashes and parses a path (the expensive part of adding
+// an entry). Safe to call from multiple threads.
+AddResult processAddTask(const AddTask &t, const fs::path &directory) {
+    AddResult r;
+    r.add = t.add;
+    r.stamp = t.stamp;
+
+    if (t.add) {
+        // Brand new, add
+        r.changed = true;
+
+        // On a cache miss the hash is computed by parseEntry,
+        // in the same read pass used to extract metadata
+        r.e.hash = t.cachedHash;
+        r.storeHash = t.hasStamp && t.cachedHash.empty();
+    } else {
+        // Entry exist, update if necessary
+        const auto status = checkModified(r.e, t.path, t.dbMtime, t.dbHash, [&t, &r](const fs::path &p) {
+            if (!t.cachedHash.empty()) return t.cachedHash;
+            r.storeHash = t.hasStamp;
+            return Hash::fileSHA256(p.string());
+        });
+        r.changed = status != FileStatus::NotModified;
     }
+
+    if (r.changed) parseEntry(t.path, directory, r.e, true);
+
+    return r;
 }
 
+// Keeps a database in bulk load mode, from begin() until end().
+// If an exception skips end(), bulk load ends when it goes out of scope
+class BulkLoad {
+    Database *db;
+    bool active = false;
+public:
+    explicit BulkLoad(Database *db) : db(db) {}
+
+    void begin(const BulkLoadSettings &settings) {
+        db->beginBulkLoad(settings);
+        active = true;
+    }
+
+    void end() {
+        if (!active) return;
+        active = false;
+        db->endBulkLoad();
+    }
+
+    ~BulkLoad() {
+        if (!active) return;
+        try {
+            db->endBulkLoad();
+        } catch (const AppException &e) {
+            LOGW << "Cannot end bulk load: " << e.what();
+        }
+    }
+};
 
 void addToIndex(Database *db, const std::vector<std::string> &paths,
-                AddCallback callback) {
+                AddCallback callback, int threads) {
     if (paths.empty()) return;  // Nothing to do
     const fs::path directory = db->rootDirectory();
-    auto pathList = getIndexPathList(directory, paths, true);
+    HashCache *hashCache = db->getHashCache();
 
     auto q = db->query("SELECT mtime,hash FROM entries WHERE path=?");
     auto insertQ = db->query(
         "INSERT INTO entries (path, hash, type, properties, mtime, size, depth, "
         "point_geom, polygon_geom) "
-        "VALUES (?, ?, ?, ?, ?, ?, ?, GeomFromText(?, 4326), GeomFromText(?, "
+        "VALUES (?, ?, ?, ?, ?, ?, ?, GeomFromWKB(?, 4326), GeomFromWKB(?, "
         "4326))");
     const auto updateQ = db->query(UPDATE_QUERY);
-    db->exec("BEGIN EXCLUSIVE TRANSACTION");
 
-    for (auto &p : pathList) {
-        io::Path relPath = io::Path(p).relativeTo(directory);
+    // Writes a parsed entry to the index
+    // @return false if the callback asked to cancel
+    const auto write = [&](const AddResult &r) {
+        if (r.storeHash && !r.e.hash.empty()) hashCache->store(r.stamp, r.e.hash);
+        if (!r.changed) return true;
+
+        if (r.add) doInsert(insertQ.get(), r.e);
+        else doUpdate(updateQ.get(), r.e);
+
+        if (callback != nullptr) return callback(r.e, !r.add);
+        return true;
+    };
+
+    // Paths already prepared. The same file can be listed more than once
+    // (e.g. an expanded path list also has its parent folders), and
+    // in pipelined mode the first copy may not be written yet
+    PathTrie prepared;
+
+    // Prepares a work item, looking up the current index state
+    // @return false if the path should be skipped
+    const auto prepare = [&](const fs::path &p, AddTask &t) {
+        if (!prepared.insert(p)) return false;
 
         if (p.has_filename()) {
             const auto fileName = p.filename().generic_string();
@@ -418,54 +598,115 @@ void addToIndex(Database *db, const std::vector<std::string> &paths,
                 LOGD << "Skipping '" << p << "'";
 
                 // Skip file
-                continue;
+                return false;
             }
         }
 
+        io::Path relPath = io::Path(p).relativeTo(directory);
         q->bind(1, relPath.generic());
 
-        bool update = false;
-        bool add = false;
-        Entry e;
-
+        t.path = p;
         if (q->fetch()) {
+            t.add = false;
+            t.dbMtime = q->getInt64(0);
+            t.dbHash = q->getText(1);
+        } else {
+            t.add = true;
+        }
+
+        q->reset();
 
-            const auto status = checkUpdate(e, p, q->getInt64(0), q->getText(1));
+        // The hash cache shares the index connection, so it's
+        // only used from this thread, never from the workers
+        if (!fs::is_directory(p) && FileStamp::of(p, t.stamp)) {
+            t.hasStamp = true;
+            hashCache->lookup(t.stamp, t.cachedHash);
+        }
 
-            // Entry exist, update if necessary
-            update = status != FileStatus::NotModified;
-        } else {
-            // Brand new, add
-            add = true;
+        return true;
+    };
+
+    if (threads <= 0) threads = static_cast<int>(ThreadPool::defaultThreadCount());
+
+    // Initial load of a large dataset: paths are counted (up to minPaths)
+    // before the transaction begins, since bulk load settings cannot be
+    // changed within it (a single folder can hold any number of files).
+    // Declared before the transaction begins, so that it ends after it
+    const auto bulkSettings = UserProfile::get()->getBulkLoadSettings();
+    BulkLoad bulkLoad(db);
+    if (bulkSettings.enabled && db->getSummary().entries == 0) {
+        const auto minPaths = static_cast<size_t>(std::max(bulkSettings.minPaths, 0));
+        size_t count = 0;
+        if (minPaths > 0) {
+            walkIndexPathList(directory, paths, true, [&count, minPaths](const fs::path &) {
+                return ++count < minPaths;
+            });
         }
+        if (count >= minPaths) bulkLoad.begin(bulkSettings);
+    }
 
-        if (add || update) {
-            parseEntry(p, directory, e, true);
-
-            if (add) {
-                insertQ->bind(1, e.path);
-                insertQ->bind(2, e.hash);
-                insertQ->bind(3, e.type);
-                insertQ->bind(4, e.properties.dump());
-                insertQ->bind(5, static_cast<long long>(e.mtime));
-                insertQ->bind(6, static_cast<long long>(e.size));
-                insertQ->bind(7, e.depth);
-                insertQ->bind(8, e.point_geom.toWkt());
-                insertQ->bind(9, e.polygon_geom.toWkt());
-
-                insertQ->execute();
-            } else {
-                doUpdate(updateQ.get(), e);
-            }
+    db->exec("BEGIN EXCLUSIVE TRANSACTION");
+
+    // Paths are processed as the file system walker finds them
+    bool completed = true;
+
+    try {
+        if (threads == 1) {
+            completed = walkIndexPathList(directory, paths, true, [&](const fs::path &p) {
+                AddTask t;
+                if (!prepare(p, t)) return true;
+
+                return write(processAddTask(t, directory));
+            });
+        } else {
+            // Pipelined mode: workers hash and parse files while this thread
+            // (the single writer) queries and updates the index. Results are
+            // written in the order paths are found, and at most a few tasks per
+            // worker are in flight at any time to keep memory usage bounded.
+            ThreadPool pool(static_cast<size_t>(threads));
+            const size_t maxInFlight = pool.size() * 4;
+            std::deque<std::future<AddResult>> inFlight;
+
+            LOGD << "Adding paths using " << pool.size() << " threads";
+
+            completed = walkIndexPathList(directory, paths, true, [&](const fs::path &p) {
+                AddTask t;
+                if (!prepare(p, t)) return true;
+
+                inFlight.push_back(pool.submit([t, &directory]() {
+                    return processAddTask(t, directory);
+                }));
+
+                while (inFlight.size() >= maxInFlight) {
+                    const auto r = inFlight.front().get();
+                    inFlight.pop_front();
+                    if (!write(r)) return false;  // cancel (pending tasks are discarded)
+                }
 
-            if (callback != nullptr)
-                if (!callback(e, !add)) return;  // cancel
+                return true;
+            });
+
+            while (completed && !inFlight.empty()) {
+                const auto r = inFlight.front().get();
+                inFlight.pop_front();
+                if (!write(r)) completed = false;  // cancel
+            }
         }
 
-        q->reset();
+        // Updates can leave the summary bounds stale
+        db->refreshSummary();
+        hashCache->prune();
+    } catch (...) {
+        db->exec("ROLLBACK");
+        throw;
     }
 
+    // Entries reported to the callback before it cancelled are kept
     db->exec("COMMIT");
+    bulkLoad.end();
+    if (!completed) return;  // cancelled
+
+    LOGD << "Hash cache hits: " << hashCache->hits() << ", misses: " << hashCache->misses();
 }
 
 void removeFromIndex(Database *db, const std::vector<std::string> &paths, RemoveCallback callback) {
@@ -486,15 +727,17 @@ void removeFromIndex(Database *db, const std::vector<std::string> &paths, Remove
 
         LOGD << "Rel path: " << relPath.generic();
 
-        auto entryMatches = getMatchingEntries(db, relPath.generic());
+        // Only paths and types are needed, skip decoding the rest
+        const auto entryMatches = getMatchingEntryViews(db, relPath.generic());
 
         int tot = 0;
 
-        for (auto &e : entryMatches) {
-            auto cnt = deleteFromIndex(db, e.path, false, callback);
+        for (const auto &e : entryMatches) {
+            const std::string path(e.path());
+            auto cnt = deleteFromIndex(db, path, false, callback);
 
-            if (e.type == Directory)
-                cnt += deleteFromIndex(db, e.path, true, callback);
+            if (e.isDirectory())
+                cnt += deleteFromIndex(db, path, true, callback);
 
             // if (!cnt)
             //     std::cout << "No matching entries" << std::endl;
@@ -504,18 +747,8 @@ void removeFromIndex(Database *db, const std::vector<std::string> &paths, Remove
 
         if (!tot) throw FSException("No matching entries");
     }
-}
-
-std::string sanitize_query_param(const std::string &str) {
-    std::string res(str);
-
-    // TAKES INTO ACCOUNT PATHS THAT CONTAINS EVERY SORT OF STUFF
-    utils::stringReplace(res, "/", "//");
-    utils::stringReplace(res, "%", "/%");
-    //utils::stringReplace(res, "_", "/_");
-    utils::stringReplace(res, "*", "%");
 
-    return res;
+    db->refreshSummary();
 }
 
 void checkDeleteBuild(Database *db, const std::string &hash){
@@ -541,34 +774,32 @@ int deleteFromIndex(Database *db, const std::string &query, bool isFolder, Remov
 
     LOGD << "Query: " << query;
 
-    auto str = sanitize_query_param(query);
+    const auto cond = isFolder ? folderCondition(query) : patternCondition(query);
 
-    LOGD << "Sanitized: " << str;
-
-    if (isFolder) {
-        str += "//%";
-        LOGD << "Folder: " << str;
-    }
+    LOGD << "Condition: " << cond.sql;
 
     db->exec("BEGIN EXCLUSIVE TRANSACTION");
 
-    auto q = db->query(
-        "SELECT path, hash FROM entries WHERE path LIKE ? ESCAPE '/'");
+    // Collect the paths to delete, so that entries and meta
+    // can be removed with one statement each
+    db->exec("CREATE TEMP TABLE IF NOT EXISTS delete_paths (path TEXT PRIMARY KEY)");
+
+    auto q = db->query("INSERT INTO temp.delete_paths SELECT path FROM entries WHERE " + cond.sql);
+    cond.bind(q.get());
+    q->execute();
+
+    const bool hasBuilds = fs::exists(db->buildDirectory());
 
-    q->bind(1, str);
+    q = db->query("SELECT e.path, e.hash FROM temp.delete_paths d JOIN entries e ON e.path = d.path");
 
     int count = 0;
 
     while (q->fetch()) {
 
         const auto path = q->getText(0);
-        const auto hash = q->getText(1);
 
         // Check for build folders to be removed
-        checkDeleteBuild(db, hash);
-
-        // Check for meta info to be removed
-        checkDeleteMeta(db, path);
+        if (hasBuilds) checkDeleteBuild(db, q->getText(1));
 
         if (callback != nullptr)
             callback(path);
@@ -579,21 +810,21 @@ int deleteFromIndex(Database *db, const std::string &query, bool isFolder, Remov
     q->reset();
 
     if (count > 0) {
-        q = db->query("DELETE FROM entries WHERE path LIKE ? ESCAPE '/'");
-
-        q->bind(1, str);
-        q->execute();
-
-        q->reset();
+        db->exec("DELETE FROM entries_meta WHERE path IN (SELECT path FROM temp.delete_paths)");
+        db->exec("DELETE FROM entries WHERE path IN (SELECT path FROM temp.delete_paths)");
     }
 
+    db->exec("DELETE FROM temp.delete_paths");
+
     db->exec("COMMIT");
 
     return count;
 }
 
-std::vector<Entry> getMatchingEntries(Database *db, const fs::path &path,
-                                      int maxRecursionDepth, bool isFolder) {
+namespace {
+
+EntryCursor matchingEntriesCursor(Database *db, const fs::path &path,
+                                  int maxRecursionDepth, bool isFolder) {
     // 0 is ALL_DEPTHS
     if (maxRecursionDepth < 0)
         throw FSException("Max recursion depth cannot be negative");
@@ -602,65 +833,45 @@ std::vector<Entry> getMatchingEntries(Database *db, const fs::path &path,
 
     LOGD << "Query: " << query;
 
-    auto sanitized = sanitize_query_param(query);
-
-    if (sanitized.length() == 0) sanitized = "%";
-
-    LOGD << "Sanitized: " << sanitized;
-
-    if (isFolder) {
-        sanitized += "//%";
-
-        LOGD << "Folder: " << sanitized;
-    }
-
-    std::string sql = R"<<<(
-        SELECT e.path, e.hash, e.type, e.properties, e.mtime, e.size, e.depth,
-        json_extract(AsGeoJSON(e.point_geom), '$.coordinates'), json_extract(AsGeoJSON(e.polygon_geom), '$.coordinates'),
-        CASE
-            WHEN em.id IS NULL THEN NULL
-            WHEN em.id IS NOT NULL THEN (
-                SELECT json_group_object(key, meta)
-                FROM (
-                    SELECT key, CASE WHEN substr(key, -1, 1) = 's'
-                                    THEN json_group_array(json_object('id', emi.id, 'data', json(emi.data), 'mtime', emi.mtime))
-                                    ELSE json_object('id', emi.id, 'data', json(emi.data), 'mtime', emi.mtime)
-                                END AS meta
-                    FROM entries_meta emi
-                    WHERE path = e.path
-                    GROUP BY key
-                )
-            )
-        END AS meta
-        FROM entries e
-        LEFT JOIN entries_meta em
-        ON e.path = em.path
-        WHERE
-        e.path LIKE ? ESCAPE '/'
-    )<<<";
+    const auto cond = isFolder && !query.empty() ? folderCondition(query, "e.path") : patternCondition(query, "e.path");
+
+    LOGD << "Condition: " << cond.sql;
+
+    std::string sql = std::string("SELECT ") + entryCursorColumns + " FROM entries e WHERE " + cond.sql;
 
     if (maxRecursionDepth > 0)
         sql += " AND e.depth <= " + std::to_string(maxRecursionDepth - 1);
 
     auto q = db->query(sql);
+    cond.bind(q.get());
 
-    std::vector<Entry> entries;
+    return EntryCursor(std::move(q));
+}
 
-    q->bind(1, sanitized);
+}
 
-    while (q->fetch()) {
-        Entry e(q->getText(0), q->getText(1), q->getInt(2), q->getText(3),
-                q->getInt64(4), q->getInt64(5), q->getInt(6),
-                q->getText(7), q->getText(8),
-                q->getText(9));
-        entries.push_back(e);
-    }
+std::vector<Entry> getMatchingEntries(Database *db, const fs::path &path,
+                                      int maxRecursionDepth, bool isFolder) {
+    auto cursor = matchingEntriesCursor(db, path, maxRecursionDepth, isFolder);
 
-    q->reset();
+    std::vector<Entry> entries;
+    Entry e;
+    while (cursor.next(e)) entries.push_back(e);
 
     return entries;
 }
 
+EntryViews getMatchingEntryViews(Database *db, const fs::path &path,
+                                 int maxRecursionDepth, bool isFolder) {
+    auto cursor = matchingEntriesCursor(db, path, maxRecursionDepth, isFolder);
+
+    EntryViews views;
+    EntryView v;
+    while (cursor.next(v, views.arena())) views.push_back(v);
+
+    return views;
+}
+
 void syncIndex(Database *db) {
     const fs::path directory = db->rootDirectory();
 
@@ -676,7 +887,7 @@ void syncIndex(Database *db) {
         Entry e;
         const auto mtime = q->getInt64(1);
         const auto hash = q->getText(2);
-        const auto status = checkUpdate(e, p, mtime, hash);
+        const auto status = checkUpdate(e, p, mtime, hash, db->getHashCache());
 
         switch(status) {
 
@@ -702,6 +913,8 @@ void syncIndex(Database *db) {
         }
     }
 
+    db->refreshSummary();
+    db->getHashCache()->prune();
     db->exec("COMMIT");
 }
 
@@ -819,11 +1032,6 @@ void deleteEntry(Database* db, const std::string& path) {
     checkDeleteMeta(db, path);
 }
 
-#define FOLDER_CONSISTENCY_QUERY "SELECT B.folder FROM ( \
-    SELECT A.path, TRIM(A.folder, '/') AS folder FROM ( \
-        SELECT path, replace(path, replace(path, rtrim(path, replace(path, '/', '')), ''), '') AS folder FROM entries WHERE type != 1) AS A \
-        WHERE length(A.folder) > 0) AS B WHERE folder NOT IN (SELECT path FROM entries WHERE type = 1)"
-
 #define CREATE_FOLDER_QUERY "INSERT INTO entries (path, type, properties, mtime, size, depth) VALUES (?, 1, 'null', ?, 0, ?)"
 
 void addFolder(Database *db, const std::string path, const time_t mtime) {
@@ -834,22 +1042,6 @@ void addFolder(Database *db, const std::string path, const time_t mtime) {
     q->execute();
 }
 
-void createMissingFolders(Database* db) {
-
-    const auto q = db->query(FOLDER_CONSISTENCY_QUERY);
-
-    while(q->fetch()) {
-
-        const auto folder = q->getText(0);
-
-        LOGD << "Creating missing folder '" << folder << "'";
-
-        addFolder(db, folder, time(NULL));
-
-    }
-
-}
-
 bool pathExists(Database* db, const std::string& path) {
     auto q = db->query("SELECT COUNT(path) FROM entries WHERE path = ?");
     q->bind(1, path);
@@ -859,40 +1051,21 @@ bool pathExists(Database* db, const std::string& path) {
 
 bool getEntry(Database* db, const std::string& path, Entry &entry) {
     auto q = db->query("SELECT path, hash, type, properties, mtime, size, depth, "
-        "json_extract(AsGeoJSON(point_geom), '$.coordinates'), json_extract(AsGeoJSON(polygon_geom), '$.coordinates') FROM entries WHERE path = ? LIMIT 1");
+        "point_geom, polygon_geom FROM entries WHERE path = ? LIMIT 1");
 
     q->bind(1, path);
 
     if (!q->fetch())
         return false;
 
-    entry.parseFields(q->getText(0), q->getText(1), q->getInt(2), q->getText(3),
-                   q->getInt64(4), q->getInt64(5), q->getInt(6),
-                   q->getText(7), q->getText(8));
+    entry.parseFields(q->getTextView(0), q->getTextView(1), q->getInt(2), q->getTextView(3),
+                   q->getInt64(4), q->getInt64(5), q->getInt(6));
+    entry.point_geom.fromBlob(q->getBlob(7), q->getBlobSize(7));
+    entry.polygon_geom.fromBlob(q->getBlob(8), q->getBlobSize(8));
     return true;
 
 }
 
-std::vector<std::string> listFolderPaths(Database *db, const std::string& path) {
-
-    std::vector<std::string> res;
-
-    auto q = db->query("SELECT path FROM entries WHERE path LIKE ? OR path = ?");
-
-    q->bind(1, path + "/%");
-    q->bind(2, path);
-
-    while (q->fetch()) {
-
-        const auto p = q->getText(0);
-
-        res.push_back(p);
-    }
-
-    return res;
-
-}
-
 void replacePath(Database* db, const std::string& source, const std::string& dest) {
 
     LOGD << "Replacing '" << source << "' to '" << dest << "'";
@@ -912,6 +1085,43 @@ void replacePath(Database* db, const std::string& source, const std::string& des
     mq->execute();
 }
 
+void replaceFolderPath(Database* db, const std::string& source, const std::string& dest) {
+
+    LOGD << "Replacing folder '" << source << "' to '" << dest << "'";
+
+    const auto sourceCond = folderCondition(source);
+    const auto destCond = folderCondition(dest, "t.path");
+
+    // Rewrites a path from dest to source, to find
+    // the entries that would be overwritten by the move
+    const std::string destToSource = "? || substr(t.path, " + std::to_string(dest.length() + 1) + ")";
+    const std::string sourceToDest = "? || substr(path, " + std::to_string(source.length() + 1) + ")";
+
+    for (const std::string table : {"entries_meta", "entries"}) {
+        auto q = db->query("DELETE FROM " + table + " AS t WHERE (t.path = ? OR " + destCond.sql + ") AND "
+                           "EXISTS (SELECT 1 FROM entries s WHERE s.path = " + destToSource + ")");
+        q->bind(1, dest);
+        const int i = destCond.bind(q.get(), 2);
+        q->bind(i, source);
+        q->execute();
+    }
+
+    // Meta first, as it follows the entries paths
+    auto q = db->query("UPDATE entries_meta SET path = " + sourceToDest + " WHERE (path = ? OR " + sourceCond.sql + ") AND "
+                       "EXISTS (SELECT 1 FROM entries e WHERE e.path = entries_meta.path)");
+    q->bind(1, dest);
+    q->bind(2, source);
+    sourceCond.bind(q.get(), 3);
+    q->execute();
+
+    q = db->query("UPDATE entries SET path = " + sourceToDest + ", depth = depth + ? WHERE path = ? OR " + sourceCond.sql);
+    q->bind(1, dest);
+    q->bind(2, io::Path(dest).depth() - io::Path(source).depth());
+    q->bind(3, source);
+    sourceCond.bind(q.get(), 4);
+    q->execute();
+}
+
 void moveEntry(Database* db, const std::string& source, const std::string& dest) {
 
     if (source[source.length() -1 ] == '/' || source[source.length() -1 ] == '\\')
@@ -953,6 +1163,9 @@ void moveEntry(Database* db, const std::string& source, const std::string& dest)
             throw InvalidArgsException("Cannot move a file on a directory");
     }
 
+    if (sourceEntry.type == Directory && dest.rfind(source + "/", 0) == 0)
+        throw InvalidArgsException("Cannot move a directory inside itself");
+
     const fs::path directory = db->rootDirectory();
 
     db->exec("BEGIN EXCLUSIVE TRANSACTION");
@@ -966,19 +1179,19 @@ void moveEntry(Database* db, const std::string& source, const std::string& dest)
 
     } else {
 
-        const auto paths = listFolderPaths(db, source);
-
-        for (const std::string& path : paths) {
-
-            auto newPath = dest + std::string(path).substr(source.length(), std::string::npos);
-
-            deleteEntry(db, newPath);
-            replacePath(db, path, newPath);
+        replaceFolderPath(db, source, dest);
 
+        // Make sure that the parents of dest exist
+        fs::path parent;
+        for (const auto &part : fs::path(dest).parent_path()) {
+            parent /= part;
+            const auto p = io::Path(parent).generic();
+            if (!pathExists(db, p)) {
+                LOGD << "Creating missing folder '" << p << "'";
+                addFolder(db, p, time(nullptr));
+            }
         }
 
-        createMissingFolders(db);
-
     }
 
     db->exec("COMMIT");
@@ -7,6 +7,7 @@
 #include "database.h"
 #include "statement.h"
 #include "entry.h"
+#include "entrycursor.h"
 #include "fs.h"
 #include "ddb_export.h"
 #include "registryutils.h"
@@ -16,21 +17,44 @@ namespace ddb {
 typedef std::function<bool(const Entry &e, bool updated)> AddCallback;
 typedef std::function<void(const std::string& path)> RemoveCallback;
 typedef std::function<void(const std::string& path)> BuildCallback;
+// @return false to stop
+typedef std::function<bool(const fs::path& path)> PathCallback;
 
 DDB_DLL std::unique_ptr<Database> open(const std::string &directory, bool traverseUp);
 DDB_DLL std::vector<fs::path> getIndexPathList(const fs::path& rootDirectory, const std::vector<std::string> &paths, bool includeDirs);
 DDB_DLL std::vector<fs::path> getPathList(const std::vector<std::string> &paths, bool includeDirs, int maxDepth, bool includeFiles = true);
+// Streaming versions of getIndexPathList and getPathList: paths are passed to the
+// callback as they are found, in no particular order
+// @return false if the callback stopped the walk
+DDB_DLL bool walkIndexPathList(const fs::path& rootDirectory, const std::vector<std::string> &paths, bool includeDirs, const PathCallback &callback);
+DDB_DLL bool walkPathList(const std::vector<std::string> &paths, bool includeDirs, int maxDepth, bool includeFiles, const PathCallback &callback);
 DDB_DLL std::vector<std::string> expandPathList(const std::vector<std::string> &paths, bool recursive, int maxRecursionDepth);
 DDB_DLL std::vector<Entry> getMatchingEntries(Database* db, const fs::path& path, int maxRecursionDepth = 0, bool isFolder = false);
+// Same as getMatchingEntries, but JSON fields and geometries are only decoded when accessed
+DDB_DLL EntryViews getMatchingEntryViews(Database* db, const fs::path& path, int maxRecursionDepth = 0, bool isFolder = false);
 DDB_DLL void checkDeleteBuild(Database *db, const std::string &hash);
 DDB_DLL void checkDeleteMeta(Database *db, const std::string &path);
 DDB_DLL int deleteFromIndex(Database* db, const std::string &query, bool isFolder = false, RemoveCallback callback = nullptr);
 
 DDB_DLL void doUpdate(Statement *updateQ, const Entry &e);
+DDB_DLL void doInsert(Statement *insertQ, const Entry &e);
 
 DDB_DLL void listIndex(Database* db, const std::vector<std::string> &paths, std::ostream& out, const std::string& format, bool recursive = false, int maxRecursionDepth = 0);
-DDB_DLL void searchIndex(Database* db, const std::string &query, std::ostream& out, const std::string& format);
-DDB_DLL void addToIndex(Database *db, const std::vector<std::string> &paths, AddCallback callback = nullptr);
+// @param intersects only return entries whose point or polygon intersects
+// this WKT geometry (EPSG:4326), using the spatial indexes. Empty for no filter
+// @param filter structured filter on entry fields (see entryfilter.h). Empty for no filter
+DDB_DLL void searchIndex(Database* db, const std::string &query, std::ostream& out, const std::string& format, const std::string &intersects = "", const std::string &filter = "");
+
+// Same as listIndex/searchIndex, but return a cursor over the entries (sorted by path)
+// @param pathOnly only read the path of each entry
+DDB_DLL std::unique_ptr<EntryCursor> listIndexCursor(Database* db, const std::vector<std::string> &paths, bool recursive = false, int maxRecursionDepth = 0, bool pathOnly = false);
+DDB_DLL std::unique_ptr<EntryCursor> searchIndexCursor(Database* db, const std::string &query, bool pathOnly = false, const std::string &intersects = "", const std::string &filter = "");
+
+// WKT polygon of a bounding box, to be used as a searchIndex area
+DDB_DLL std::string bboxToWkt(double minx, double miny, double maxx, double maxy);
+// @param threads number of threads used to hash and parse files
+//        (1 = process files sequentially, 0 = one per core)
+DDB_DLL void addToIndex(Database *db, const std::vector<std::string> &paths, AddCallback callback = nullptr, int threads = 1);
 DDB_DLL void removeFromIndex(Database *db, const std::vector<std::string> &paths, RemoveCallback callback = nullptr);
 DDB_DLL void syncIndex(Database *db);
 DDB_DLL void syncLocalMTimes(Database *db, const std::vector<std::string> &files = {});
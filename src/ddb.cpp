@@ -4,6 +4,8 @@
 
 #include "ddb.h"
 
+#include <mutex>
+#include <exiv2/exiv2.hpp>
 #include "gdal_inc.h"
 #include <passwordmanager.h>
 
@@ -27,6 +29,7 @@
 #include "version.h"
 #include "stac.h"
 #include "../vendor/segvcatch/segvcatch.h"
+#include <base64/base64.h>
 
 using namespace ddb;
 
@@ -44,6 +47,14 @@ void handleFpe(){
     throw ddb::AppException("Application encountered a floating point exception");
 }
 
+// The XMP toolkit used by Exiv2 is not thread safe
+// and needs a lock to parse XMP packets from multiple threads
+std::mutex xmpMutex;
+void xmpLock(void *, bool lock){
+    if (lock) xmpMutex.lock();
+    else xmpMutex.unlock();
+}
+
 void DDBRegisterProcess(bool verbose) {
     // Prevent multiple initializations
     if (initialized) {
@@ -89,6 +100,7 @@ void DDBRegisterProcess(bool verbose) {
 
     net::Initialize();
     GDALAllRegister();
+    Exiv2::XmpParser::initialize(xmpLock, nullptr);
 
     // Black magic to catch segfaults/fpes and throw
     // C++ exceptions instead
@@ -191,10 +203,11 @@ DDBErr DDBGet(const char *ddbPath, const char *path, char **output){
     if (path == nullptr) throw InvalidArgsException("No path provided");
     const auto db = ddb::open(std::string(ddbPath), false);
 
-    auto entries = ddb::getMatchingEntries(db.get(), std::string(path));
+    // Decoded only once we know there is a single match
+    const auto entries = ddb::getMatchingEntryViews(db.get(), std::string(path));
     std::string entryJson;
     if (entries.size() == 1){
-        entryJson = entries[0].toJSONString();
+        entryJson = entries[0].toEntry().toJSONString();
     }else if (entries.size() > 1){
         throw InvalidArgsException("Multiple entries were returned for " + std::string(path));
     }else{
@@ -233,6 +246,10 @@ DDBErr DDBList(const char* ddbPath, const char** paths, int numPaths,
 }
 
 DDBErr DDBSearch(const char *ddbPath, const char *query, char **output, const char *format){
+    return DDBSearchFiltered(ddbPath, query, output, format, nullptr, nullptr);
+}
+
+DDBErr DDBSearchFiltered(const char *ddbPath, const char *query, char **output, const char *format, const char *intersects, const char *filter){
     DDB_C_BEGIN
 
     if (ddbPath == nullptr) throw InvalidArgsException("No ddb path provided");
@@ -244,7 +261,7 @@ DDBErr DDBSearch(const char *ddbPath, const char *query, char **output, const ch
     const auto db = ddb::open(std::string(ddbPath), false);
 
     std::ostringstream ss;
-    searchIndex(db.get(), query, ss, format);
+    searchIndex(db.get(), query, ss, format, intersects != nullptr ? intersects : "", filter != nullptr ? filter : "");
 
     utils::copyToPtr(ss.str(), output);
 
@@ -252,6 +269,82 @@ DDBErr DDBSearch(const char *ddbPath, const char *query, char **output, const ch
 }
 
 
+struct DDBEntryCursor {
+    std::unique_ptr<Database> db;
+    std::unique_ptr<EntryCursor> cursor;
+};
+
+DDBErr DDBListOpen(const char *ddbPath, const char **paths, int numPaths, bool recursive, int maxRecursionDepth, DDBEntryCursor **cursor){
+    DDB_C_BEGIN
+
+    if (ddbPath == nullptr) throw InvalidArgsException("No ddb path provided");
+
+    if (paths == nullptr || numPaths == 0)
+        throw InvalidArgsException("No paths provided");
+
+    if (cursor == nullptr) throw InvalidArgsException("No cursor provided");
+
+    auto c = std::make_unique<DDBEntryCursor>();
+    c->db = ddb::open(std::string(ddbPath), true);
+    const std::vector<std::string> pathList(paths, paths + numPaths);
+    c->cursor = listIndexCursor(c->db.get(), pathList, recursive, maxRecursionDepth);
+
+    *cursor = c.release();
+
+    DDB_C_END
+}
+
+DDBErr DDBSearchOpen(const char *ddbPath, const char *query, DDBEntryCursor **cursor){
+    return DDBSearchOpenFiltered(ddbPath, query, cursor, nullptr, nullptr);
+}
+
+DDBErr DDBSearchOpenFiltered(const char *ddbPath, const char *query, DDBEntryCursor **cursor, const char *intersects, const char *filter){
+    DDB_C_BEGIN
+
+    if (ddbPath == nullptr) throw InvalidArgsException("No ddb path provided");
+    if (query == nullptr) throw InvalidArgsException("No query provided");
+    if (cursor == nullptr) throw InvalidArgsException("No cursor provided");
+
+    auto c = std::make_unique<DDBEntryCursor>();
+    c->db = ddb::open(std::string(ddbPath), false);
+    c->cursor = searchIndexCursor(c->db.get(), query, false, intersects != nullptr ? intersects : "", filter != nullptr ? filter : "");
+
+    *cursor = c.release();
+
+    DDB_C_END
+}
+
+DDBErr DDBCursorNext(DDBEntryCursor *cursor, char **output, bool *hasNext){
+    DDB_C_BEGIN
+
+    if (cursor == nullptr) throw InvalidArgsException("No cursor provided");
+    if (output == nullptr) throw InvalidArgsException("No output provided");
+    if (hasNext == nullptr) throw InvalidArgsException("No hasNext provided");
+
+    Entry e;
+    *hasNext = cursor->cursor->next(e);
+
+    if (*hasNext){
+        json j;
+        e.toJSON(j);
+        utils::copyToPtr(j.dump(), output);
+    }
+
+    DDB_C_END
+}
+
+DDBErr DDBCursorClose(DDBEntryCursor *cursor){
+    DDB_C_BEGIN
+
+    if (cursor == nullptr) throw InvalidArgsException("No cursor provided");
+
+    // The statement must be finalized before its database is closed
+    cursor->cursor.reset();
+    delete cursor;
+
+    DDB_C_END
+}
+
 DDBErr DDBAppendPassword(const char* ddbPath, const char* password) {
     DDB_C_BEGIN
 
@@ -427,16 +520,24 @@ DDBErr DDBDelta(const char* ddbSourceStamp, const char* ddbTargetStamp, char** o
 
     std::ostringstream ss;
 
-    try{
-        const json source = json::parse(ddbSourceStamp);
-        const json dest = json::parse(ddbTargetStamp);
-
-        delta(source, dest, ss, format);
+    // Stamps are read without building json documents,
+    // binary stamps are passed as base64 strings
+    const auto stampData = [](const char *stamp){
+        std::string str(stamp);
+        const auto start = str.find_first_not_of(" \t\r\n");
+        if (start == std::string::npos || str[start] == '{') return str;
+
+        // Anything that doesn't decode to a binary stamp is read as JSON,
+        // so that invalid input is reported as a JSON parse error
+        auto data = Base64::decode(str);
+        if (!isBinaryStamp(data.data(), data.size())) return str;
+        return data;
+    };
+    std::istringstream source(stampData(ddbSourceStamp));
+    std::istringstream dest(stampData(ddbTargetStamp));
+    delta(source, dest, ss, format);
 
-        utils::copyToPtr(ss.str(), output);
-    }catch (const json::parse_error &e) {
-        throw InvalidArgsException(e.what());
-    }
+    utils::copyToPtr(ss.str(), output);
 
     DDB_C_END
 }
@@ -105,6 +105,49 @@ DDB_DLL DDBErr DDBList(const char *ddbPath, const char **paths, int numPaths, ch
  * @return DDBERR_NONE on success, an error otherwise */
 DDB_DLL DDBErr DDBSearch(const char *ddbPath, const char *query, char **output, const char *format);
 
+/** Search files inside index, restricting the results to an area and/or a filter.
+ * Arguments are the same as DDBSearch
+ * @param intersects optional WKT geometry (EPSG:4326) that the results must intersect
+ * @param filter optional structured filter, e.g. "captureTime BETWEEN '2021-06-01' AND '2021-07-01' AND make = 'DJI'"
+ * @return DDBERR_NONE on success, an error otherwise */
+DDB_DLL DDBErr DDBSearchFiltered(const char *ddbPath, const char *query, char **output, const char *format, const char *intersects, const char *filter);
+
+typedef struct DDBEntryCursor DDBEntryCursor;
+
+/** Open a cursor to iterate over the files inside index, one at a time.
+ * Arguments are the same as DDBList. The cursor must be released with DDBCursorClose
+ * @param cursor pointer where to store the cursor
+ * @return DDBERR_NONE on success, an error otherwise */
+DDB_DLL DDBErr DDBListOpen(const char *ddbPath, const char **paths, int numPaths, bool recursive, int maxRecursionDepth, DDBEntryCursor **cursor);
+
+/** Open a cursor to iterate over the results of a search inside index.
+ * The cursor must be released with DDBCursorClose
+ * @param ddbPath path to a DroneDB database (parent of ".ddb")
+ * @param query search string
+ * @param cursor pointer where to store the cursor
+ * @return DDBERR_NONE on success, an error otherwise */
+DDB_DLL DDBErr DDBSearchOpen(const char *ddbPath, const char *query, DDBEntryCursor **cursor);
+
+/** Open a cursor to iterate over the results of a search inside index,
+ * restricting the results to an area and/or a filter.
+ * Arguments are the same as DDBSearchOpen
+ * @param intersects optional WKT geometry (EPSG:4326) that the results must intersect
+ * @param filter optional structured filter (see DDBSearchFiltered)
+ * @return DDBERR_NONE on success, an error otherwise */
+DDB_DLL DDBErr DDBSearchOpenFiltered(const char *ddbPath, const char *query, DDBEntryCursor **cursor, const char *intersects, const char *filter);
+
+/** Read the next entry from a cursor
+ * @param cursor cursor opened with DDBListOpen, DDBSearchOpen or DDBSearchOpenFiltered
+ * @param output pointer to C-string where to store the entry (JSON), left untouched when there are no more entries
+ * @param hasNext set to false when there are no more entries
+ * @return DDBERR_NONE on success, an error otherwise */
+DDB_DLL DDBErr DDBCursorNext(DDBEntryCursor *cursor, char **output, bool *hasNext);
+
+/** Release a cursor and its database
+ * @param cursor cursor opened with DDBListOpen, DDBSearchOpen or DDBSearchOpenFiltered
+ * @return DDBERR_NONE on success, an error otherwise */
+DDB_DLL DDBErr DDBCursorClose(DDBEntryCursor *cursor);
+
 /** Append password to database
  * @param ddbPath path to a DroneDB database (parent of ".ddb")
  * @param password password to append
@@ -182,8 +225,8 @@ DDB_DLL DDBErr DDBTile(const char *inputPath, int tz, int tx, int ty, char **out
 DDB_DLL DDBErr DDBMemoryTile(const char *inputPath, int tz, int tx, int ty, uint8_t **outBuffer, int *outBufferSize, int tileSize = 256, bool tms = false, bool forceRecreate = false, const char *inputPathHash = "");
 
 /** Generate delta between two ddbs 
- * @param ddbSourceStamp JSON stamp of the source DroneDB database
- * @param ddbTargetStamp JSON stamp of the target DroneDB database
+ * @param ddbSourceStamp JSON stamp of the source DroneDB database (or base64 encoded binary stamp)
+ * @param ddbTargetStamp JSON stamp of the target DroneDB database (or base64 encoded binary stamp)
  * @param output pointer to C-string where to store result
  * @param format output format. One of: ["text", "json"]
  * @return DDBERR_NONE on success, an error otherwise */
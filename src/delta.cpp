@@ -6,6 +6,8 @@
 #include <mio.h>
 
 #include <algorithm>
+#include <cstring>
+#include <iterator>
 #include <optional>
 #include <utility>
 #include <vector>
@@ -13,6 +15,7 @@
 #include "dbops.h"
 #include "exceptions.h"
 #include "delta.h"
+#include "pathquery.h"
 
 
 namespace ddb {
@@ -60,17 +63,90 @@ void from_json(const json &j, Delta &d){
     }
 }
 
-Delta getDelta(Database* sourceDb, Database* targetDb) {
-    return getDelta(sourceDb->getStamp(), targetDb->getStamp());
-}
+namespace {
+
+// Walks the stamp trees of two indexes, descending
+// only into the folders whose hashes differ
+class TreeDelta {
+    Database *sourceDb;
+    Database *targetDb;
+    StampTree *source;
+    StampTree *target;
+    Delta &d;
+
+    // Everything inside folder (at any depth) is added or removed
+    void subtree(Database *db, const std::string &folder, bool add) {
+        const auto cond = folderCondition(folder);
+
+        auto q = db->query("SELECT path, hash FROM entries WHERE " + cond.sql);
+        cond.bind(q.get());
+        while (q->fetch()) {
+            if (add) d.adds.emplace_back(q->getText(0), q->getText(1));
+            else d.removes.emplace_back(q->getText(0), q->getText(1));
+        }
 
-void delta(Database* sourceDb, Database* targetDb, std::ostream& output, const std::string& format) {
-    delta(sourceDb->getStamp(), targetDb->getStamp(), output, format);
-}
+        q = db->query("SELECT id FROM entries_meta WHERE " + cond.sql);
+        cond.bind(q.get());
+        while (q->fetch()) {
+            if (add) d.metaAdds.push_back(q->getText(0));
+            else d.metaRemoves.push_back(q->getText(0));
+        }
+    }
 
-void delta(const json &sourceDbStamp, const json &targetDbStamp, std::ostream& output, const std::string& format){
-    auto delta = getDelta(sourceDbStamp, targetDbStamp);
+public:
+    TreeDelta(Database *sourceDb, Database *targetDb, Delta &d) :
+        sourceDb(sourceDb), targetDb(targetDb),
+        source(sourceDb->getStampTree()), target(targetDb->getStampTree()), d(d) {}
+
+    void folder(const std::string &folder) {
+        if (source->hash(folder) == target->hash(folder)) return;
+
+        const auto s = source->node(folder);
+        const auto t = target->node(folder);
+
+        // Direct children (same rules as the stamp based delta)
+        auto si = s.entries.begin();
+        auto ti = t.entries.begin();
+        while (si != s.entries.end() || ti != t.entries.end()) {
+            if (ti == t.entries.end() || (si != s.entries.end() && si->path < ti->path)) {
+                d.adds.emplace_back(si->path, si->hash);
+                si++;
+            } else if (si == s.entries.end() || ti->path < si->path) {
+                d.removes.emplace_back(ti->path, ti->hash);
+                ti++;
+            } else {
+                if (si->hash != ti->hash) d.adds.emplace_back(si->path, si->hash);
+                if (si->isDirectory() != ti->isDirectory()) d.removes.emplace_back(ti->path, ti->hash);
+                si++;
+                ti++;
+            }
+        }
 
+        // Subfolders
+        auto sf = s.folders.begin();
+        auto tf = t.folders.begin();
+        while (sf != s.folders.end() || tf != t.folders.end()) {
+            if (tf == t.folders.end() || (sf != s.folders.end() && sf->path < tf->path)) {
+                subtree(sourceDb, sf->path, true);
+                sf++;
+            } else if (sf == s.folders.end() || tf->path < sf->path) {
+                subtree(targetDb, tf->path, false);
+                tf++;
+            } else {
+                if (sf->hash != tf->hash) this->folder(sf->path);
+                sf++;
+                tf++;
+            }
+        }
+
+        std::set_difference(s.meta.begin(), s.meta.end(), t.meta.begin(), t.meta.end(),
+                            std::back_inserter(d.metaAdds));
+        std::set_difference(t.meta.begin(), t.meta.end(), s.meta.begin(), s.meta.end(),
+                            std::back_inserter(d.metaRemoves));
+    }
+};
+
+void printDelta(const Delta &delta, std::ostream& output, const std::string& format){
     if (format == "json") {
 
         json j = delta;
@@ -87,91 +163,271 @@ void delta(const json &sourceDbStamp, const json &targetDbStamp, std::ostream& o
     }
 }
 
-Delta getDelta(const json &sourceDbStamp,
-               const json &destinationDbStamp) {
-    std::vector<SimpleEntry> source = parseStampEntries(sourceDbStamp);
-    std::vector<SimpleEntry> destination = parseStampEntries(destinationDbStamp);
-
-    std::vector<RemoveAction> removes;
-    std::vector<AddAction> adds;
+}
 
-    std::vector<std::string> metaAdds;
-    std::vector<std::string> metaRemoves;
+Delta getDelta(Database* sourceDb, Database* targetDb) {
+    if (!sourceDb->getStampTree()->isUpToDate() || !targetDb->getStampTree()->isUpToDate()) {
+        LOGD << "Stamp tree out of date, comparing stamps";
+        return getDelta(sourceDb->getStamp(), targetDb->getStamp());
+    }
 
-    // Sort by path
-    std::sort(source.begin(), source.end(),
-              [](const SimpleEntry& l, const SimpleEntry& r) {
+    Delta d;
+    TreeDelta(sourceDb, targetDb, d).folder("");
+
+    // Meta ids are compared by folder, an id that was moved
+    // shows up on both sides (and is not part of the delta)
+    std::sort(d.metaAdds.begin(), d.metaAdds.end());
+    std::sort(d.metaRemoves.begin(), d.metaRemoves.end());
+    std::vector<std::string> metaAdds, metaRemoves;
+    std::set_difference(d.metaAdds.begin(), d.metaAdds.end(), d.metaRemoves.begin(), d.metaRemoves.end(),
+                        std::back_inserter(metaAdds));
+    std::set_difference(d.metaRemoves.begin(), d.metaRemoves.end(), d.metaAdds.begin(), d.metaAdds.end(),
+                        std::back_inserter(metaRemoves));
+    d.metaAdds = std::move(metaAdds);
+    d.metaRemoves = std::move(metaRemoves);
+
+    std::sort(d.adds.begin(), d.adds.end(),
+              [](const AddAction& l, const AddAction& r) {
                   return l.path < r.path;
               });
-
-    // Sort by path
-    std::sort(destination.begin(), destination.end(),
-              [](const SimpleEntry& l, const SimpleEntry& r) {
-                  return l.path < r.path;
+    std::sort(d.removes.begin(), d.removes.end(),
+              [](const RemoveAction& l, const RemoveAction& r) {
+                  return l.path > r.path;
               });
 
-    for (const SimpleEntry& entry : source) {
-        const auto inDestWithSameHashAndPath =
-            std::find_if(destination.begin(), destination.end(),
-                         [&entry](const SimpleEntry& e) {
-                             return e.hash == entry.hash &&
-                                    e.path == entry.path;
-                         }) != destination.end();
-
-        if (inDestWithSameHashAndPath) {
-            LOGD << "SKIP -> " << entry.toString();
-            continue;
-        }
+    return d;
+}
+
+void delta(Database* sourceDb, Database* targetDb, std::ostream& output, const std::string& format) {
+    printDelta(getDelta(sourceDb, targetDb), output, format);
+}
+
+void delta(const json &sourceDbStamp, const json &targetDbStamp, std::ostream& output, const std::string& format){
+    printDelta(getDelta(sourceDbStamp, targetDbStamp), output, format);
+}
+
+void delta(std::istream &sourceDbStamp, std::istream &targetDbStamp, std::ostream& output, const std::string& format){
+    printDelta(getDelta(sourceDbStamp, targetDbStamp), output, format);
+}
 
-        LOGD << "ADD  -> " << entry.toString();
-        adds.emplace_back(AddAction(entry.path, entry.hash));
+namespace {
+
+// Sequential access to the (sorted) entries of a Stamp,
+// same interface as BinaryStamp::Reader
+class StampReader {
+    const std::vector<SimpleEntry> &entries;
+    size_t i = 0;
+    bool started = false;
+public:
+    StampReader(const Stamp &s) : entries(s.entries) {}
+
+    bool next() {
+        if (started) i++;
+        started = true;
+        return i < entries.size();
     }
 
-    for (const SimpleEntry& entry : destination) {
-        const auto notInSourceWithSamePath = std::find_if(
-            source.begin(), source.end(), [&entry](const SimpleEntry& e) {
-                return e.path == entry.path && e.isDirectory() == entry.isDirectory();
-            });
+    std::string_view path() const { return entries[i].path; }
+    std::string_view hash() const { return entries[i].hash; }
+    bool isDirectory() const { return entries[i].isDirectory(); }
+    const uint8_t *digest() const { return nullptr; }
+};
+
+template <typename S, typename D>
+bool sameHash(S &s, D &d) {
+    if (s.digest() != nullptr && d.digest() != nullptr) return memcmp(s.digest(), d.digest(), 32) == 0;
+    return s.hash() == d.hash();
+}
+
+// Single pass over two lists of entries sorted by path
+template <typename S, typename D>
+Delta mergeDelta(S source, D destination,
+                 const std::vector<std::string> &sourceMeta,
+                 const std::vector<std::string> &destinationMeta) {
+    Delta d;
 
-        if (notInSourceWithSamePath == source.end()) {
-            LOGD << "DEL  -> " << entry.toString();
-            removes.emplace_back(RemoveAction(entry.path, entry.hash));
+    const auto add = [&d](S &e) {
+        LOGD << "ADD  -> " << e.path();
+        d.adds.emplace_back(std::string(e.path()), std::string(e.hash()));
+    };
+    const auto remove = [&d](D &e) {
+        LOGD << "DEL  -> " << e.path();
+        d.removes.emplace_back(std::string(e.path()), std::string(e.hash()));
+    };
+
+    bool hasSource = source.next();
+    bool hasDestination = destination.next();
+    while (hasSource || hasDestination) {
+        if (!hasDestination || (hasSource && source.path() < destination.path())) {
+            add(source);
+            hasSource = source.next();
+        } else if (!hasSource || destination.path() < source.path()) {
+            remove(destination);
+            hasDestination = destination.next();
+        } else {
+            if (!sameHash(source, destination)) add(source);
+            if (source.isDirectory() != destination.isDirectory()) remove(destination);
+
+            hasSource = source.next();
+            hasDestination = destination.next();
         }
     }
 
     // Sort removes by path descending
-    std::sort(removes.begin(), removes.end(),
-              [](const RemoveAction& l, const RemoveAction& r) {
-                  return l.path > r.path;
-              });
+    std::reverse(d.removes.begin(), d.removes.end());
+
+    std::set_difference(sourceMeta.begin(), sourceMeta.end(),
+                        destinationMeta.begin(), destinationMeta.end(),
+                        std::back_inserter(d.metaAdds));
+    std::set_difference(destinationMeta.begin(), destinationMeta.end(),
+                        sourceMeta.begin(), sourceMeta.end(),
+                        std::back_inserter(d.metaRemoves));
+
+    return d;
+}
 
-    // Compute meta adds/removes
-    if (!sourceDbStamp.contains("meta")) throw InvalidArgsException("Stamp meta not found");
-    if (!destinationDbStamp.contains("meta")) throw InvalidArgsException("Stamp meta not found");
+}
 
-    // Find meta IDs in source that are not in destination
-    std::unordered_map<std::string, bool> metaIds;
-    std::vector<std::string> sourceMetaIds = sourceDbStamp["meta"].get<std::vector<std::string>>();
-    std::vector<std::string> destinationMetaIds = destinationDbStamp["meta"].get<std::vector<std::string>>();
+Delta getDelta(const Stamp &source, const Stamp &destination) {
+    return mergeDelta(StampReader(source), StampReader(destination), source.meta, destination.meta);
+}
 
-    for (auto &id: sourceMetaIds) metaIds[id] = true;
-    for (auto &id: destinationMetaIds) metaIds.erase(id);
-    for (auto &it : metaIds) metaAdds.push_back(it.first);
+Delta getDelta(const BinaryStamp &source, const BinaryStamp &destination) {
+    return mergeDelta(source.reader(), destination.reader(), source.meta(), destination.meta());
+}
 
-    metaIds.clear();
+Delta getDelta(const Stamp &source, const BinaryStamp &destination) {
+    return mergeDelta(StampReader(source), destination.reader(), source.meta, destination.meta());
+}
 
-    // Find meta IDs in destination that are not in source
-    for (auto &id: destinationMetaIds) metaIds[id] = true;
-    for (auto &id: sourceMetaIds) metaIds.erase(id);
-    for (auto &it : metaIds) metaRemoves.push_back(it.first);
+Delta getDelta(const BinaryStamp &source, const Stamp &destination) {
+    return mergeDelta(source.reader(), StampReader(destination), source.meta(), destination.meta);
+}
 
-    Delta d;
-    d.removes = removes;
-    d.adds = adds;
-    d.metaAdds = metaAdds;
-    d.metaRemoves = metaRemoves;
+Delta getDelta(const json &sourceDbStamp,
+               const json &destinationDbStamp) {
+    return getDelta(parseStamp(sourceDbStamp), parseStamp(destinationDbStamp));
+}
 
-    return d;
+Delta getDelta(std::istream &sourceDbStamp,
+               std::istream &destinationDbStamp) {
+    return getDelta(readStamp(sourceDbStamp), readStamp(destinationDbStamp));
+}
+
+namespace {
+
+// Stamps generated by getStamp are already sorted
+void sortStamp(Stamp &s) {
+    const auto byPath = [](const SimpleEntry& l, const SimpleEntry& r) {
+        return l.path < r.path;
+    };
+    if (!std::is_sorted(s.entries.begin(), s.entries.end(), byPath)) {
+        std::sort(s.entries.begin(), s.entries.end(), byPath);
+    }
+    s.entries.erase(std::unique(s.entries.begin(), s.entries.end(),
+                                [](const SimpleEntry& l, const SimpleEntry& r) {
+                                    return l.path == r.path;
+                                }), s.entries.end());
+
+    if (!std::is_sorted(s.meta.begin(), s.meta.end())) {
+        std::sort(s.meta.begin(), s.meta.end());
+    }
+    s.meta.erase(std::unique(s.meta.begin(), s.meta.end()), s.meta.end());
+}
+
+// Collects entries, meta ids and checksum of a stamp:
+// {"checksum": "...", "entries": [{"path": "hash"}, ...], "meta": ["id", ...]}
+class JsonStampReader : public nlohmann::json_sax<json> {
+    Stamp &s;
+    int depth = 0;
+    std::string section;
+    std::string path;
+    bool hasEntries = false;
+    bool hasMeta = false;
+public:
+    JsonStampReader(Stamp &s) : s(s) {}
+
+    bool null() override { return true; }
+    bool boolean(bool) override { return true; }
+    bool number_integer(number_integer_t) override { return true; }
+    bool number_unsigned(number_unsigned_t) override { return true; }
+    bool number_float(number_float_t, const string_t&) override { return true; }
+
+    bool string(string_t& val) override {
+        if (depth == 1 && section == "checksum") s.checksum = std::move(val);
+        else if (depth == 2 && section == "meta") s.meta.push_back(std::move(val));
+        else if (depth == 3 && section == "entries") s.entries.emplace_back(std::move(path), std::move(val));
+        return true;
+    }
+
+    bool start_object(std::size_t) override {
+        depth++;
+        return true;
+    }
+
+    bool key(string_t& val) override {
+        if (depth == 1) section = val;
+        else if (depth == 3) path = std::move(val);
+        return true;
+    }
+
+    bool end_object() override {
+        depth--;
+        return true;
+    }
+
+    bool start_array(std::size_t) override {
+        if (depth == 1) {
+            if (section == "entries") hasEntries = true;
+            else if (section == "meta") hasMeta = true;
+        }
+        depth++;
+        return true;
+    }
+
+    bool end_array() override {
+        depth--;
+        return true;
+    }
+
+    bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception& e) override {
+        throw InvalidArgsException(std::string("Invalid stamp: ") + e.what());
+    }
+
+    void validate() const {
+        if (!hasEntries) throw InvalidArgsException("Stamp entries not found");
+        if (!hasMeta) throw InvalidArgsException("Stamp meta not found");
+    }
+};
+
+}
+
+Stamp parseStamp(const json &stamp) {
+    Stamp s;
+    s.entries = parseStampEntries(stamp);
+
+    if (!stamp.contains("meta")) throw InvalidArgsException("Stamp meta not found");
+    s.meta = stamp["meta"].get<std::vector<std::string>>();
+    if (stamp.contains("checksum")) s.checksum = stamp["checksum"];
+
+    sortStamp(s);
+    return s;
+}
+
+Stamp readStamp(std::istream &in) {
+    // Binary stamps start with a magic string, JSON stamps with "{"
+    if (in.peek() == DDB_BINARY_STAMP_MAGIC[0]) {
+        const std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        return BinaryStamp(data.data(), data.size()).toStamp();
+    }
+
+    Stamp s;
+    JsonStampReader reader(s);
+    json::sax_parse(in, &reader);
+    reader.validate();
+
+    sortStamp(s);
+    return s;
 }
 
 std::vector<SimpleEntry> parseStampEntries(const json &stamp){
@@ -179,9 +435,10 @@ std::vector<SimpleEntry> parseStampEntries(const json &stamp){
 
     if (!stamp.contains("entries")) throw InvalidArgsException("Stamp entries not found");
 
+    result.reserve(stamp["entries"].size());
     for (auto &i : stamp["entries"]){
         auto obj = i.begin();
-        result.push_back(SimpleEntry(obj.key(), obj.value()));
+        result.emplace_back(obj.key(), obj.value());
     }
 
     return result;
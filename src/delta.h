@@ -6,6 +6,7 @@
 
 #include <iostream>
 
+#include "binarystamp.h"
 #include "dbops.h"
 #include "ddb_export.h"
 #include "utils.h"
@@ -76,13 +77,36 @@ DDB_DLL void to_json(json& j, const Delta& d);
 
 DDB_DLL void from_json(const json &j, Delta &d);
 
+DDB_DLL Stamp parseStamp(const json &stamp);
+
+// Read a stamp from a stream, either binary or JSON
+// (JSON stamps are read without building a json document)
+DDB_DLL Stamp readStamp(std::istream &in);
+
+// Delta between two stamps in a single pass over their entries
+DDB_DLL Delta getDelta(const Stamp &source, const Stamp &destination);
+DDB_DLL Delta getDelta(const BinaryStamp &source, const BinaryStamp &destination);
+DDB_DLL Delta getDelta(const Stamp &source, const BinaryStamp &destination);
+DDB_DLL Delta getDelta(const BinaryStamp &source, const Stamp &destination);
+
 DDB_DLL Delta getDelta(const json &sourceDbStamp,
                        const json &destinationDbStamp);
-
+DDB_DLL Delta getDelta(std::istream &sourceDbStamp,
+                       std::istream &destinationDbStamp);
+
+// Delta between two indexes, comparing their stamp trees and only
+// descending into folders whose hashes differ. Neither database is
+// written to: trees must be brought up to date beforehand, in a separate
+// step (see StampTree::update). If either tree is out of date, the full
+// stamps are compared instead.
+// Registries don't serve stamp trees, push and pull exchange the flat
+// stamp and use the overloads above.
 DDB_DLL Delta getDelta(Database* sourceDb, Database* targetDb);
 
+// Same as getDelta(Database*, Database*), writing the result to output
 DDB_DLL void delta(Database* sourceDb, Database* targetDb, std::ostream& output, const std::string& format);
 DDB_DLL void delta(const json &sourceDbStamp, const json &targetDbStamp, std::ostream& output, const std::string& format);
+DDB_DLL void delta(std::istream &sourceDbStamp, std::istream &targetDbStamp, std::ostream& output, const std::string& format);
 
 DDB_DLL std::vector<SimpleEntry> parseStampEntries(const json &stamp);
 
@@ -14,8 +14,10 @@
 #pragma clang diagnostic ignored "-Wdisabled-macro-expansion"
 
 DSMService *DSMService::instance = nullptr;
+std::mutex instanceMutex;
 
 DSMService *DSMService::get(){
+    std::lock_guard<std::mutex> guard(instanceMutex);
     if (!instance){
         instance = new DSMService();
     }
@@ -30,6 +32,7 @@ DSMService::~DSMService(){
 }
 
 float DSMService::getAltitude(double latitude, double longitude){
+    std::lock_guard<std::recursive_mutex> guard(cacheMutex);
     Point2D point(longitude, latitude);
 
     // Search cache
@@ -5,6 +5,7 @@
 #ifndef DSMSERVICE_H
 #define DSMSERVICE_H
 
+#include <mutex>
 #include <string>
 #include <vector>
 #include <unordered_map>
@@ -35,6 +36,7 @@ struct DSMCacheEntry{
 
 class DSMService{
     std::unordered_map<std::string, DSMCacheEntry> cache; // filename --> cache entry
+    std::recursive_mutex cacheMutex;
     DSMService();
     ~DSMService();
     static DSMService *instance;
@@ -1,6 +1,7 @@
 /* This Source Code Form is subject to the terms of the Mozilla Public
  * License, v. 2.0. If a copy of the MPL was not distributed with this
  * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+#include <map>
 #include <exiv2/exiv2.hpp>
 #include "dbops.h"
 #include "entry.h"
@@ -8,6 +9,7 @@
 #include <ddb.h>
 
 #include "mio.h"
+#include "parsecontext.h"
 #include "pointcloud.h"
 #include "ply.h"
 #include "ogr_srs_api.h"
@@ -46,9 +48,13 @@ void parseEntry(const fs::path &path, const fs::path &rootDirectory, Entry &entr
             LOGD << "Cannot check " << path.string() << " .ddb presence: " << e.what();
         }
     } else {
-        if (entry.hash == "" && withHash) entry.hash = Hash::fileSHA256(path.string());
+        // Type detection and metadata extraction share the same
+        // open handles (and, for small images, the bytes read for hashing)
+        ParseContext ctx(path);
+
+        if (entry.hash == "" && withHash) entry.hash = ctx.sha256();
         entry.size = p.getSize();
-        entry.type = fingerprint(p.get());
+        entry.type = fingerprint(ctx);
 
         bool pano = entry.type == EntryType::Panorama || entry.type == EntryType::GeoPanorama;
         bool image = entry.type == EntryType::Image || entry.type == EntryType::GeoImage || pano;
@@ -56,11 +62,10 @@ void parseEntry(const fs::path &path, const fs::path &rootDirectory, Entry &entr
 
         if (image || video) {
             try{
-                auto exivImage = Exiv2::ImageFactory::open(path.string());
-                if (!exivImage.get()) throw new IndexException("Cannot open " + path.string());
+                ExifParser *parser = ctx.getExifParser();
+                if (parser == nullptr) throw IndexException("Cannot open " + path.string());
 
-                exivImage->readMetadata();
-                ExifParser e(exivImage.get());
+                ExifParser &e = *parser;
 
                 if (e.hasTags()) {
                     SensorSize sensorSize;
@@ -133,10 +138,11 @@ void parseEntry(const fs::path &path, const fs::path &rootDirectory, Entry &entr
                 }
             }catch(Exiv2::Error&){
                 LOGD << "Cannot read EXIF data: " << path.string();
+            }catch(IndexException &e){
+                LOGD << e.what();
             }
         }else if (entry.type == EntryType::GeoRaster){
-            GDALDatasetH  hDataset;
-            hDataset = GDALOpen( path.string().c_str(), GA_ReadOnly );
+            GDALDatasetH hDataset = ctx.getDataset();
             if (!hDataset)
                 throw GDALException("Cannot open " + path.string() + " for reading");
 
@@ -201,8 +207,6 @@ void parseEntry(const fs::path &path, const fs::path &rootDirectory, Entry &entr
                 b["colorInterp"] = GDALGetColorInterpretationName(GDALGetRasterColorInterpretation(hBand));
                 entry.properties["bands"].push_back(b);
             }
-
-            GDALClose(hDataset);
         }else if (entry.type == EntryType::PointCloud){
             PointCloudInfo info;
             if (getPointCloudInfo(path.string(), info)){
@@ -290,6 +294,99 @@ void calculateFootprint(const SensorSize &sensorSize, const GeoLocation &geo, co
     geom.addPoint(ul.longitude, ul.latitude, groundHeight);
 }
 
+void calculateFootprints(const std::vector<SensorSize> &sensorSizes, const std::vector<GeoLocation> &geos,
+                         const std::vector<Focal> &focals, const std::vector<CameraOrientation> &cameraOris,
+                         const std::vector<double> &relAltitudes, std::vector<BasicPolygonGeometry> &geoms) {
+    const size_t count = geos.size();
+    if (sensorSizes.size() != count || focals.size() != count || cameraOris.size() != count || relAltitudes.size() != count){
+        throw InvalidArgsException("Cannot calculate footprints, the inputs have different sizes");
+    }
+
+    geoms.assign(count, BasicPolygonGeometry());
+
+    // Images of each UTM zone (zone, north)
+    std::map<std::pair<int, bool>, std::vector<size_t>> zones;
+    for (size_t i = 0; i < count; i++){
+        const auto z = getUTMZone(geos[i].latitude, geos[i].longitude);
+        zones[{z.zone, z.north}].push_back(i);
+    }
+
+    for (const auto &z : zones){
+        UTMZone utmZone;
+        utmZone.zone = z.first.first;
+        utmZone.north = z.first.second;
+        const auto &images = z.second;
+        const size_t n = images.size();
+
+        // Inputs, one array per value
+        std::vector<double> centerX(n), centerY(n), width(n), height(n), focal(n),
+                pitch(n), roll(n), yaw(n), relAltitude(n), groundHeight(n);
+        for (size_t j = 0; j < n; j++){
+            const size_t i = images[j];
+            centerX[j] = geos[i].latitude;
+            centerY[j] = geos[i].longitude;
+            width[j] = sensorSizes[i].width;
+            height[j] = sensorSizes[i].height;
+            focal[j] = focals[i].length;
+            roll[j] = cameraOris[i].roll;
+            yaw[j] = cameraOris[i].yaw;
+            relAltitude[j] = relAltitudes[i];
+            groundHeight[j] = geos[i].altitude != 0.0 ? geos[i].altitude - relAltitudes[i] : relAltitudes[i];
+
+            // Cap pitch to 60 degrees
+            pitch[j] = cameraOris[i].pitch;
+            if (pitch[j] > -30){
+                LOGD << "Pitch cap exceeded (" << pitch[j] << ") using nadir";
+                pitch[j] = -90; // set to nadir
+            }
+        }
+
+        toUTM(centerX.data(), centerY.data(), n, utmZone, centerX.data(), centerY.data());
+
+        // Corners (upper left, upper right, lower left, lower right), n values each.
+        // Same operations as calculateFootprint, without branches
+        std::vector<double> x(4 * n), y(4 * n);
+        double *ulX = x.data(), *urX = ulX + n, *llX = urX + n, *lrX = llX + n;
+        double *ulY = y.data(), *urY = ulY + n, *llY = urY + n, *lrY = llY + n;
+
+        for (size_t j = 0; j < n; j++){
+            const double xView = 2.0 * atan(width[j] / (2.0 * focal[j]));
+            const double yView = 2.0 * atan(height[j] / (2.0 * focal[j]));
+
+            const double bottom = relAltitude[j] * tan(utils::deg2rad(90.0 + pitch[j]) - 0.5 * yView);
+            const double top = relAltitude[j] * tan(utils::deg2rad(90.0 + pitch[j]) + 0.5 * yView);
+            const double left = relAltitude[j] * tan(utils::deg2rad(roll[j]) - 0.5 * xView);
+            const double right = relAltitude[j] * tan(utils::deg2rad(roll[j]) + 0.5 * xView);
+
+            const double cx = centerX[j];
+            const double cy = centerY[j];
+            const double radians = utils::deg2rad(-yaw[j]);
+            const double c = cos(radians);
+            const double s = sin(radians);
+
+            const double l = (cx + left) - cx, r = (cx + right) - cx;
+            const double t = (cy + top) - cy, b = (cy + bottom) - cy;
+
+            ulX[j] = c * l - s * t + cx; ulY[j] = s * l + c * t + cy;
+            urX[j] = c * r - s * t + cx; urY[j] = s * r + c * t + cy;
+            llX[j] = c * l - s * b + cx; llY[j] = s * l + c * b + cy;
+            lrX[j] = c * r - s * b + cx; lrY[j] = s * r + c * b + cy;
+        }
+
+        // x, y become latitudes, longitudes
+        fromUTM(x.data(), y.data(), 4 * n, utmZone, x.data(), y.data());
+
+        for (size_t j = 0; j < n; j++){
+            auto &geom = geoms[images[j]];
+            geom.addPoint(ulY[j], ulX[j], groundHeight[j]);
+            geom.addPoint(llY[j], llX[j], groundHeight[j]);
+            geom.addPoint(lrY[j], lrX[j], groundHeight[j]);
+            geom.addPoint(urY[j], urX[j], groundHeight[j]);
+            geom.addPoint(ulY[j], ulX[j], groundHeight[j]);
+        }
+    }
+}
+
 void Entry::toJSON(json &j) const{
     j["path"] = this->path;
     if (this->hash != "") j["hash"] = this->hash;
@@ -392,10 +489,7 @@ void parseDroneDBEntry(const fs::path &ddbPath, Entry &entry){
         const auto db = ddb::open(ddbPath.string(), false);
 
         // The size of the database is the sum of all entries' sizes
-        auto q = db->query("SELECT SUM(size) FROM entries");
-        if (q->fetch()){
-            entry.size = q->getInt64(0);
-        }
+        entry.size = db->getSummary().size;
 
         entry.properties = db->getProperties();
         entry.type = EntryType::DroneDB;
@@ -406,7 +500,13 @@ void parseDroneDBEntry(const fs::path &ddbPath, Entry &entry){
 }
 
 EntryType fingerprint(const fs::path &path){
+    ParseContext ctx(path);
+    return fingerprint(ctx);
+}
+
+EntryType fingerprint(ParseContext &ctx){
     EntryType type = EntryType::Generic;
+    const fs::path &path = ctx.getPath();
     io::Path p(path);
 
     if (p.checkExtension({"md"}))
@@ -434,14 +534,12 @@ EntryType fingerprint(const fs::path &path){
     bool georaster = false;
 
     if (tif){
-        GDALDatasetH  hDataset;
-        hDataset = GDALOpen( p.string().c_str(), GA_ReadOnly );
+        GDALDatasetH hDataset = ctx.getDataset();
         if( hDataset != NULL ){
             const char *proj = GDALGetProjectionRef(hDataset);
             if (proj != NULL){
                 georaster = std::string(proj) != "";
             }
-            GDALClose(hDataset);
         }else{
             LOGD << "Cannot open " << p.string().c_str() << " for georaster test";
         }
@@ -454,15 +552,15 @@ EntryType fingerprint(const fs::path &path){
         type = image ? EntryType::Image : EntryType::Video;
 
         try{
-            auto image = Exiv2::ImageFactory::open(path.string());
-            if (!image.get()) throw new IndexException("Cannot open " + path.string());
+            ExifParser *parser = ctx.getExifParser();
+            if (parser == nullptr) throw IndexException("Cannot open " + path.string());
 
-            image->readMetadata();
-            ExifParser e(image.get());
+            ExifParser &e = *parser;
 
             if (type == EntryType::Image){
                 // Panorama?
-                if (image->pixelWidth() / image->pixelHeight() >= 2) type = EntryType::Panorama;
+                const auto imageSize = e.extractImageSize();
+                if (imageSize.height > 0 && imageSize.width / imageSize.height >= 2) type = EntryType::Panorama;
             }
 
             if (e.hasTags()) {
@@ -479,6 +577,8 @@ EntryType fingerprint(const fs::path &path){
             }
         }catch(Exiv2::Error&){
             LOGD << "Cannot read EXIF data: " << path.string();
+        }catch(IndexException &e){
+            LOGD << e.what();
         }
     }else if (georaster){
         type = EntryType::GeoRaster;
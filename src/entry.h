@@ -4,6 +4,7 @@
 #ifndef ENTRY_H
 #define ENTRY_H
 
+#include <string_view>
 #include "gdal_inc.h"
 #include "entry_types.h"
 #include "logger.h"
@@ -19,6 +20,8 @@
 
 namespace ddb {
 
+class ParseContext;
+
 struct Entry {
     std::string path = "";
     std::string hash = "";
@@ -48,15 +51,16 @@ struct Entry {
         parseFields(path, hash, type, propertiesJson, mtime, size, depth, pointCoordinatesJson, polyCoordinatesJson, metaJson);
     }
 
-    void parseFields(const std::string &path, const std::string &hash,
-                     int type, const std::string &propertiesJson,
+    // Strings are copied, views into statement columns can be passed directly
+    void parseFields(std::string_view path, std::string_view hash,
+                     int type, std::string_view propertiesJson,
                      long long mtime, std::uintmax_t size, int depth,
-                     const std::string &pointCoordinatesJson = "", const std::string &polyCoordinatesJson = "", const std::string &metaJson = ""){
-        this->path = path;
-        this->hash = hash;
+                     std::string_view pointCoordinatesJson = "", std::string_view polyCoordinatesJson = "", std::string_view metaJson = ""){
+        this->path.assign(path);
+        this->hash.assign(hash);
         this->type = static_cast<EntryType>(type);
         try{
-            this->properties = json::parse(propertiesJson, nullptr, false);
+            this->properties = json::parse(propertiesJson.data(), propertiesJson.data() + propertiesJson.size(), nullptr, false);
         }catch(json::exception &e){
             LOGD << "Invalid entry JSON: " << e.what();
         }
@@ -69,13 +73,13 @@ struct Entry {
         this->parseMeta(metaJson);
     }
 
-    void parsePointGeometry(const std::string &coordinatesJson){
+    void parsePointGeometry(std::string_view coordinatesJson){
         point_geom.clear();
         if (coordinatesJson.empty()) return;
 
         json j;
         try{
-            j = json::parse(coordinatesJson);
+            j = json::parse(coordinatesJson.data(), coordinatesJson.data() + coordinatesJson.size());
         }catch(json::exception &e){
             throw JSONException(e.what());
         }
@@ -92,13 +96,13 @@ struct Entry {
         }
     }
 
-    void parsePolygonGeometry(const std::string &coordinatesJson){
+    void parsePolygonGeometry(std::string_view coordinatesJson){
         polygon_geom.clear();
         if (coordinatesJson.empty()) return;
 
         json j;
         try{
-            j = json::parse(coordinatesJson);
+            j = json::parse(coordinatesJson.data(), coordinatesJson.data() + coordinatesJson.size());
         }catch(json::exception &e){
             throw JSONException(e.what());
         }
@@ -118,12 +122,12 @@ struct Entry {
         }
     }
 
-    void parseMeta(const std::string &metaJson){
+    void parseMeta(std::string_view metaJson){
         meta.clear();
         if (metaJson.empty()) return;
 
         try{
-            meta = json::parse(metaJson);
+            meta = json::parse(metaJson.data(), metaJson.data() + metaJson.size());
         }catch(json::exception &){
             LOGD << "Corrupted meta: " << metaJson;
             return;
@@ -140,11 +144,21 @@ struct Entry {
 DDB_DLL void parseEntry(const fs::path &path, const fs::path &rootDirectory, Entry &entry, bool wishHash = true);
 DDB_DLL Geographic2D getRasterCoordinate(OGRCoordinateTransformationH hTransform, double *geotransform, double x, double y);
 DDB_DLL void calculateFootprint(const SensorSize &sensorSize, const GeoLocation &geo, const Focal &focal, const CameraOrientation &cameraOri, double relAltitude, BasicGeometry &geom);
+
+/** Same as calculateFootprint, for many images at once. Each input has one element per image.
+ * Images are grouped by UTM zone, so that each zone's projection is set up once
+ * @param geoms output footprints, in the order of the inputs
+ */
+DDB_DLL void calculateFootprints(const std::vector<SensorSize> &sensorSizes, const std::vector<GeoLocation> &geos,
+                                 const std::vector<Focal> &focals, const std::vector<CameraOrientation> &cameraOris,
+                                 const std::vector<double> &relAltitudes, std::vector<BasicPolygonGeometry> &geoms);
 DDB_DLL void parseDroneDBEntry(const fs::path &ddbPath, Entry &entry);
 
 /** Identify whether a file is an Image, GeoImage, Georaster or something else
  * as quickly as possible. Does not fingerprint for other types. */
 DDB_DLL EntryType fingerprint(const fs::path &path);
+// Same as above, reusing the resources held by a parse context
+DDB_DLL EntryType fingerprint(ParseContext &ctx);
 
 }
 
@@ -0,0 +1,99 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+#include "entrycursor.h"
+#include "exceptions.h"
+
+namespace ddb {
+
+const char *entryCursorColumns = R"<<<(
+        e.path, e.hash, e.type, e.properties, e.mtime, e.size, e.depth,
+        e.point_geom, e.polygon_geom,
+        CASE
+            WHEN NOT EXISTS (SELECT 1 FROM entries_meta WHERE path = e.path) THEN NULL
+            ELSE (
+                SELECT json_group_object(key, meta)
+                FROM (
+                    SELECT key, CASE WHEN substr(key, -1, 1) = 's'
+                                    THEN json_group_array(json_object('id', emi.id, 'data', json(emi.data), 'mtime', emi.mtime))
+                                    ELSE json_object('id', emi.id, 'data', json(emi.data), 'mtime', emi.mtime)
+                                END AS meta
+                    FROM entries_meta emi
+                    WHERE path = e.path
+                    GROUP BY key
+                )
+            )
+        END AS meta
+)<<<";
+
+EntryCursor::EntryCursor(std::unique_ptr<Statement> q, bool pathOnly) : q(std::move(q)), pathOnly(pathOnly) {}
+
+bool EntryCursor::next(Entry &e) {
+    if (!q->fetch()) return false;
+
+    if (pathOnly) {
+        e = Entry();
+        e.path.assign(q->getTextView(0));
+    } else {
+        e.parseFields(q->getTextView(0), q->getTextView(1), q->getInt(2), q->getTextView(3),
+                      q->getInt64(4), q->getInt64(5), q->getInt(6),
+                      "", "", q->getTextView(9));
+
+        // Geometries are decoded from the SpatiaLite blobs
+        e.point_geom.fromBlob(q->getBlob(7), q->getBlobSize(7));
+        e.polygon_geom.fromBlob(q->getBlob(8), q->getBlobSize(8));
+    }
+
+    return true;
+}
+
+bool EntryCursor::next(EntryView &v, EntryArena &arena) {
+    if (!q->fetch()) return false;
+
+    v = EntryView();
+    v.path_ = arena.store(q->getTextView(0));
+    if (pathOnly) return true;
+
+    v.hash_ = arena.store(q->getTextView(1));
+    v.type_ = static_cast<EntryType>(q->getInt(2));
+    v.properties_ = arena.store(q->getTextView(3));
+    v.mtime_ = static_cast<time_t>(q->getInt64(4));
+    v.size_ = q->getInt64(5);
+    v.depth_ = q->getInt(6);
+    v.pointGeom_ = arena.store(std::string_view(static_cast<const char *>(q->getBlob(7)), q->getBlobSize(7)));
+    v.polygonGeom_ = arena.store(std::string_view(static_cast<const char *>(q->getBlob(8)), q->getBlobSize(8)));
+    v.meta_ = arena.store(q->getTextView(9));
+
+    return true;
+}
+
+bool EntryCursor::isPathOnly() const {
+    return pathOnly;
+}
+
+void writeEntries(EntryCursor &cursor, std::ostream &out, const std::string &format) {
+    Entry e;
+
+    if (format == "text") {
+        while (cursor.next(e)) out << e.path << '\n';
+    } else if (format == "json") {
+        if (cursor.isPathOnly()) throw InvalidArgsException("Cannot write JSON from a path only cursor");
+
+        out << "[";
+        bool first = true;
+
+        while (cursor.next(e)) {
+            json j;
+            e.toJSON(j);
+            if (!first) out << ",";
+            out << j.dump();
+            first = false;
+        }
+
+        out << "]";
+    } else {
+        throw InvalidArgsException("Unsupported format '" + format + "'");
+    }
+}
+
+}
@@ -0,0 +1,47 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+#ifndef ENTRYCURSOR_H
+#define ENTRYCURSOR_H
+
+#include <memory>
+#include <ostream>
+#include "entry.h"
+#include "entryview.h"
+#include "statement.h"
+#include "ddb_export.h"
+
+namespace ddb {
+
+// Columns expected by EntryCursor, to be selected
+// from the entries table aliased as "e"
+extern const char *entryCursorColumns;
+
+// Iterates over the results of an entries query one row at a time,
+// so that large result sets never need to be held in memory
+class EntryCursor {
+    std::unique_ptr<Statement> q;
+    bool pathOnly;
+public:
+    // @param q query selecting entryCursorColumns (or only e.path if pathOnly is set)
+    DDB_DLL EntryCursor(std::unique_ptr<Statement> q, bool pathOnly = false);
+
+    // Read the next entry. If the cursor was created with pathOnly
+    // set, only the path field is populated.
+    // @return false when there are no more entries
+    DDB_DLL bool next(Entry &e);
+
+    // Same as next(Entry&), but copy the raw column bytes into arena
+    // and leave JSON fields and geometries undecoded
+    DDB_DLL bool next(EntryView &v, EntryArena &arena);
+
+    DDB_DLL bool isPathOnly() const;
+};
+
+// Write all entries of a cursor to out, as they are read
+// @param format one of "text" or "json"
+DDB_DLL void writeEntries(EntryCursor &cursor, std::ostream &out, const std::string &format);
+
+}
+
+#endif // ENTRYCURSOR_H
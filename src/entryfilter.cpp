@@ -0,0 +1,251 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+#include <cctype>
+#include <cstdio>
+#include "entryfilter.h"
+#include "entry_types.h"
+#include "exceptions.h"
+#include "timezone.h"
+#include "utils.h"
+
+namespace ddb {
+
+namespace {
+
+enum ValueKind { Text, Number, Type, Date, DateSeconds };
+
+struct Field {
+    const char *name;
+    // Must match the expressions of the entries indexes (see database.cpp)
+    const char *expr;
+    ValueKind kind;
+};
+
+const Field fields[] = {
+    { "path", "e.path", Text },
+    { "type", "e.type", Type },
+    { "size", "e.size", Number },
+    { "mtime", "e.mtime", DateSeconds },
+    { "depth", "e.depth", Number },
+    { "captureTime", "json_extract(e.properties, '$.captureTime')", Date },
+    { "make", "json_extract(e.properties, '$.make')", Text },
+    { "model", "json_extract(e.properties, '$.model')", Text },
+    { "width", "json_extract(e.properties, '$.width')", Number },
+    { "height", "json_extract(e.properties, '$.height')", Number },
+    { "focalLength", "json_extract(e.properties, '$.focalLength')", Number },
+};
+
+enum TokenKind { Word, String, Num, Op, LParen, RParen, Comma, End };
+
+struct Token {
+    TokenKind kind;
+    std::string text;
+};
+
+std::vector<Token> tokenize(const std::string &s) {
+    std::vector<Token> tokens;
+    size_t i = 0;
+
+    while (i < s.length()) {
+        const char c = s[i];
+
+        if (std::isspace(static_cast<unsigned char>(c))) {
+            i++;
+        } else if (c == '\'' || c == '"') {
+            const size_t end = s.find(c, i + 1);
+            if (end == std::string::npos) throw InvalidArgsException("Unterminated string in filter: " + s.substr(i));
+            tokens.push_back({ String, s.substr(i + 1, end - i - 1) });
+            i = end + 1;
+        } else if (std::isdigit(static_cast<unsigned char>(c)) || c == '-' || c == '.') {
+            size_t end = i + 1;
+            while (end < s.length() && (std::isalnum(static_cast<unsigned char>(s[end])) || s[end] == '.' ||
+                   ((s[end] == '-' || s[end] == '+') && (s[end - 1] == 'e' || s[end - 1] == 'E')))) end++;
+            tokens.push_back({ Num, s.substr(i, end - i) });
+            i = end;
+        } else if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') {
+            size_t end = i + 1;
+            while (end < s.length() && (std::isalnum(static_cast<unsigned char>(s[end])) || s[end] == '_')) end++;
+            tokens.push_back({ Word, s.substr(i, end - i) });
+            i = end;
+        } else if (c == '(' || c == ')' || c == ',') {
+            tokens.push_back({ c == '(' ? LParen : c == ')' ? RParen : Comma, std::string(1, c) });
+            i++;
+        } else if (c == '=' || c == '<' || c == '>' || c == '!') {
+            std::string op(1, c);
+            if (i + 1 < s.length() && (s[i + 1] == '=' || (c == '<' && s[i + 1] == '>'))) op += s[i + 1];
+            i += op.length();
+
+            if (op == "!") throw InvalidArgsException("Invalid operator in filter: !");
+            if (op == "<>") op = "!=";
+            if (op == "==") op = "=";
+            tokens.push_back({ Op, op });
+        } else {
+            throw InvalidArgsException(std::string("Unexpected character in filter: ") + c);
+        }
+    }
+
+    tokens.push_back({ End, "" });
+    return tokens;
+}
+
+std::string lower(std::string s) {
+    utils::toLower(s);
+    return s;
+}
+
+bool parseNumber(const std::string &s, double &out) {
+    try {
+        size_t pos;
+        out = std::stod(s, &pos);
+        return pos == s.length();
+    } catch (const std::logic_error &) {
+        return false;
+    }
+}
+
+// Parse YYYY-MM-DD[(T| )HH:MM[:SS]] as UTC
+// @return milliseconds since epoch
+bool parseDate(const std::string &s, double &out) {
+    int year, month, day, hour = 0, minute = 0, second = 0;
+    char sep;
+    const int n = sscanf(s.c_str(), "%4d-%2d-%2d%c%2d:%2d:%2d", &year, &month, &day, &sep, &hour, &minute, &second);
+    if (n != 3 && n < 6) return false;
+    if (n > 3 && sep != 'T' && sep != ' ') return false;
+    if (month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60) return false;
+
+    out = Timezone::getUTCEpoch(year, month, day, hour, minute, second, 0.0, cctz::utc_time_zone());
+    return true;
+}
+
+class Parser {
+    std::vector<Token> tokens;
+    size_t pos = 0;
+    EntryFilter &res;
+
+    const Token &peek() const { return tokens[pos]; }
+    const Token &next() { return tokens[pos < tokens.size() - 1 ? pos++ : pos]; }
+
+    bool keyword(const char *kw) {
+        if (peek().kind == Word && lower(peek().text) == kw) {
+            pos++;
+            return true;
+        }
+        return false;
+    }
+
+    void expect(TokenKind kind, const char *what) {
+        if (next().kind != kind) throw InvalidArgsException(std::string("Expected ") + what + " in filter");
+    }
+
+    void value(const Field &f) {
+        const Token &t = next();
+        if (t.kind != String && t.kind != Num && t.kind != Word)
+            throw InvalidArgsException(std::string("Expected a value for ") + f.name + " in filter");
+
+        double d;
+        switch (f.kind) {
+            case Text:
+                res.params.emplace_back(t.text);
+                return;
+            case Type:
+                if (t.kind == Num && parseNumber(t.text, d)) {
+                    res.params.emplace_back(static_cast<long long>(d));
+                    return;
+                }
+                for (int i = EntryType::Undefined; i <= EntryType::GeoPanorama; i++) {
+                    if (lower(typeToHuman(static_cast<EntryType>(i))) == lower(t.text)) {
+                        res.params.emplace_back(static_cast<long long>(i));
+                        return;
+                    }
+                }
+                throw InvalidArgsException("Invalid entry type in filter: " + t.text);
+            case Number:
+            case Date:
+            case DateSeconds:
+                if (t.kind == Num && parseNumber(t.text, d)) {
+                    if (d == static_cast<double>(static_cast<long long>(d))) res.params.emplace_back(static_cast<long long>(d));
+                    else res.params.emplace_back(d);
+                    return;
+                }
+                if (f.kind != Number && t.kind == String && parseDate(t.text, d)) {
+                    if (f.kind == DateSeconds) res.params.emplace_back(static_cast<long long>(d / 1000.0));
+                    else res.params.emplace_back(d);
+                    return;
+                }
+                throw InvalidArgsException(std::string("Invalid value for ") + f.name + " in filter: " + t.text);
+        }
+    }
+
+    void term() {
+        const Token &name = next();
+        if (name.kind != Word) throw InvalidArgsException("Expected a field name in filter");
+
+        const Field *field = nullptr;
+        for (const auto &f : fields) {
+            if (lower(f.name) == lower(name.text)) field = &f;
+        }
+        if (field == nullptr) throw InvalidArgsException("Unknown field in filter: " + name.text);
+
+        const std::string expr(field->expr);
+
+        if (keyword("between")) {
+            res.sql += expr + " BETWEEN ? AND ?";
+            value(*field);
+            if (!keyword("and")) throw InvalidArgsException("Expected AND after BETWEEN in filter");
+            value(*field);
+        } else if (keyword("in")) {
+            expect(LParen, "(");
+            res.sql += expr + " IN (?";
+            value(*field);
+            while (peek().kind == Comma) {
+                next();
+                res.sql += ", ?";
+                value(*field);
+            }
+            expect(RParen, ")");
+            res.sql += ")";
+        } else if (peek().kind == Op) {
+            res.sql += expr + " " + next().text + " ?";
+            value(*field);
+        } else {
+            throw InvalidArgsException("Expected an operator after " + name.text + " in filter");
+        }
+    }
+
+public:
+    Parser(const std::string &filter, EntryFilter &res) : tokens(tokenize(filter)), res(res) {}
+
+    void parse() {
+        if (peek().kind == End) return;
+
+        res.sql += "(";
+        term();
+        while (keyword("and")) {
+            res.sql += " AND ";
+            term();
+        }
+        res.sql += ")";
+
+        if (peek().kind != End) throw InvalidArgsException("Unexpected '" + peek().text + "' in filter");
+    }
+};
+
+}
+
+int EntryFilter::bind(Statement *q, int i) const {
+    for (const auto &p : params) {
+        if (std::holds_alternative<std::string>(p)) q->bind(i++, std::get<std::string>(p));
+        else if (std::holds_alternative<long long>(p)) q->bind(i++, std::get<long long>(p));
+        else q->bind(i++, std::get<double>(p));
+    }
+    return i;
+}
+
+EntryFilter parseEntryFilter(const std::string &filter) {
+    EntryFilter res;
+    Parser(filter, res).parse();
+    return res;
+}
+
+}
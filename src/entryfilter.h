@@ -0,0 +1,38 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+#ifndef ENTRYFILTER_H
+#define ENTRYFILTER_H
+
+#include <string>
+#include <variant>
+#include <vector>
+#include "statement.h"
+#include "ddb_export.h"
+
+namespace ddb {
+
+// Structured filter on entries, for example:
+//   captureTime BETWEEN '2021-06-01' AND '2021-07-01' AND make = 'DJI' AND type IN (geoimage, georaster) AND size > 1000000
+//
+// Fields: path, type, size, mtime, depth, captureTime, make, model, width, height, focalLength
+// Operators: =, !=, <, <=, >, >=, BETWEEN x AND y, IN (x, y, ...)
+// Terms are combined with AND. Strings are quoted ('DJI'), types can be
+// given by name or number, dates ('2021-06-01T10:00:00', UTC) can be used
+// with captureTime and mtime. Every field except mtime is backed by an index.
+struct EntryFilter {
+    // Condition on the entries table aliased as "e"
+    std::string sql;
+    std::vector<std::variant<std::string, long long, double>> params;
+
+    // Bind the parameters starting at index i
+    // @return index of the next parameter
+    DDB_DLL int bind(Statement *q, int i = 1) const;
+};
+
+// @throws InvalidArgsException if the filter is not valid
+DDB_DLL EntryFilter parseEntryFilter(const std::string &filter);
+
+}
+
+#endif // ENTRYFILTER_H
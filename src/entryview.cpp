@@ -0,0 +1,72 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+#include <cstring>
+#include "entryview.h"
+
+namespace ddb {
+
+EntryArena::EntryArena(size_t blockSize) : blockSize(blockSize), used(blockSize) {}
+
+std::string_view EntryArena::store(std::string_view s) {
+    if (s.empty()) return std::string_view();
+
+    // Large values get a block of their own, so that the
+    // rest of the current block is not wasted
+    if (s.size() > blockSize / 4) {
+        blocks.emplace_back(new char[s.size()]);
+        allocated += s.size();
+        char *p = blocks.back().get();
+        memcpy(p, s.data(), s.size());
+
+        // Keep filling the previous block
+        if (blocks.size() > 1 && used < blockSize) std::swap(blocks[blocks.size() - 1], blocks[blocks.size() - 2]);
+        return std::string_view(p, s.size());
+    }
+
+    if (used + s.size() > blockSize) {
+        blocks.emplace_back(new char[blockSize]);
+        allocated += blockSize;
+        used = 0;
+    }
+
+    char *p = blocks.back().get() + used;
+    memcpy(p, s.data(), s.size());
+    used += s.size();
+    return std::string_view(p, s.size());
+}
+
+json EntryView::properties() const {
+    if (properties_.empty()) return json();
+    return json::parse(properties_.data(), properties_.data() + properties_.size(), nullptr, false);
+}
+
+json EntryView::meta() const {
+    Entry e;
+    e.parseMeta(meta_);
+    return e.meta;
+}
+
+BasicPointGeometry EntryView::pointGeometry() const {
+    BasicPointGeometry g;
+    g.fromBlob(pointGeom_.data(), pointGeom_.size());
+    return g;
+}
+
+BasicPolygonGeometry EntryView::polygonGeometry() const {
+    BasicPolygonGeometry g;
+    g.fromBlob(polygonGeom_.data(), polygonGeom_.size());
+    return g;
+}
+
+Entry EntryView::toEntry() const {
+    Entry e;
+    e.parseFields(path_, hash_, type_, properties_, mtime_, size_, depth_, "", "", meta_);
+    e.point_geom.fromBlob(pointGeom_.data(), pointGeom_.size());
+    e.polygon_geom.fromBlob(polygonGeom_.data(), polygonGeom_.size());
+    return e;
+}
+
+EntryViews::EntryViews() : arena_(new EntryArena()) {}
+
+}
@@ -0,0 +1,94 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+#ifndef ENTRYVIEW_H
+#define ENTRYVIEW_H
+
+#include <memory>
+#include <string_view>
+#include <vector>
+#include "entry.h"
+#include "ddb_export.h"
+
+namespace ddb {
+
+class EntryCursor;
+
+// Bump allocator holding the raw column bytes of a query's results.
+// Memory is released all at once when the arena goes away and stored
+// bytes never move, so views into them stay valid until then.
+class EntryArena {
+    std::vector<std::unique_ptr<char[]>> blocks;
+    size_t blockSize;
+    size_t used;
+    size_t allocated = 0;
+public:
+    DDB_DLL explicit EntryArena(size_t blockSize = 64 * 1024);
+
+    // Copy s into the arena
+    // @return a view of the copy
+    DDB_DLL std::string_view store(std::string_view s);
+
+    // Bytes allocated so far
+    size_t size() const { return allocated; }
+};
+
+// Read-only entry backed by bytes stored in an EntryArena. The cheap
+// fields are decoded right away, while properties, meta and geometries
+// are kept as they come from the database and parsed on each access.
+class EntryView {
+    std::string_view path_;
+    std::string_view hash_;
+    std::string_view properties_;
+    std::string_view meta_;
+    std::string_view pointGeom_;
+    std::string_view polygonGeom_;
+    EntryType type_ = EntryType::Undefined;
+    time_t mtime_ = 0;
+    std::uintmax_t size_ = 0;
+    int depth_ = 0;
+
+    friend class EntryCursor;
+public:
+    std::string_view path() const { return path_; }
+    std::string_view hash() const { return hash_; }
+    EntryType type() const { return type_; }
+    time_t mtime() const { return mtime_; }
+    std::uintmax_t size() const { return size_; }
+    int depth() const { return depth_; }
+    bool isDirectory() const { return type_ == EntryType::Directory; }
+
+    // Raw JSON, as stored in the database
+    std::string_view propertiesJson() const { return properties_; }
+    std::string_view metaJson() const { return meta_; }
+
+    DDB_DLL json properties() const;
+    DDB_DLL json meta() const;
+    DDB_DLL BasicPointGeometry pointGeometry() const;
+    DDB_DLL BasicPolygonGeometry polygonGeometry() const;
+
+    // Fully decoded copy of the entry
+    DDB_DLL Entry toEntry() const;
+};
+
+// Entries returned by a bulk query, together with the arena
+// that owns their data
+class EntryViews {
+    std::unique_ptr<EntryArena> arena_;
+    std::vector<EntryView> views;
+public:
+    DDB_DLL EntryViews();
+
+    EntryArena &arena() { return *arena_; }
+    void push_back(const EntryView &v) { views.push_back(v); }
+
+    std::vector<EntryView>::const_iterator begin() const { return views.begin(); }
+    std::vector<EntryView>::const_iterator end() const { return views.end(); }
+    const EntryView &operator[](size_t i) const { return views[i]; }
+    size_t size() const { return views.size(); }
+    bool empty() const { return views.empty(); }
+};
+
+}
+
+#endif // ENTRYVIEW_H
@@ -9,34 +9,59 @@
 
 namespace ddb {
 
-Exiv2::ExifData::const_iterator ExifParser::findExifKey(const std::string &key) {
-    return findExifKey({key});
+namespace {
+
+void fromExif(const Exiv2::Exifdatum &d, ExifValue &v) {
+    switch (d.typeId()) {
+        case Exiv2::unsignedByte:
+        case Exiv2::unsignedShort:
+        case Exiv2::unsignedLong:
+        case Exiv2::signedByte:
+        case Exiv2::signedShort:
+        case Exiv2::signedLong:
+            for (size_t i = 0; i < d.count(); i++) v.addNumber(d.toInt64(i));
+            break;
+        case Exiv2::unsignedRational:
+        case Exiv2::signedRational:
+            v.rational = true;
+            for (size_t i = 0; i < d.count(); i++) {
+                const auto r = d.toRational(i);
+                v.addNumber(r.first, r.second);
+            }
+            break;
+        default:
+            v.setText(d.toString());
+    }
 }
 
-// Find the first available key, or exifData::end() if none exist
-Exiv2::ExifData::const_iterator ExifParser::findExifKey(const std::initializer_list<std::string>& keys) {
-    for (auto &k : keys) {
-        auto it = exifData.findKey(Exiv2::ExifKey(k));
-        if (it != exifData.end()) return it;
+// First of the values that are present, or an empty value if none are
+const ExifValue &first(std::initializer_list<const ExifValue *> values) {
+    static const ExifValue none;
+    for (auto v : values) {
+        if (*v) return *v;
     }
-    return exifData.end();
+    return none;
 }
 
-Exiv2::XmpData::const_iterator ExifParser::findXmpKey(const std::string &key) {
-    return findXmpKey({key});
 }
 
-// Find the first available key, or xmpData::end() if none exist
-Exiv2::XmpData::const_iterator ExifParser::findXmpKey(const std::initializer_list<std::string>& keys) {
-    for (auto &k : keys) {
-        try{
-            auto it = xmpData.findKey(Exiv2::XmpKey(k));
-            if (it != xmpData.end()) return it;
-        }catch(Exiv2::Error&){
-            // Do nothing
-        }
+ExifParser::ExifParser(Exiv2::Image *image) : image(image) {
+    const auto &exifData = image->exifData();
+    const auto &xmpData = image->xmpData();
+
+    tags.imageWidth = image->pixelWidth();
+    tags.imageHeight = image->pixelHeight();
+    tags.hasExif = !exifData.empty();
+    tags.hasXmp = !xmpData.empty();
+
+    // Single pass over the metadata, the first occurrence of a key wins
+    ExifTag tag;
+    for (const auto &d : exifData) {
+        if (findExifTag(d.key(), tag) && !tags[tag]) fromExif(d, tags[tag]);
+    }
+    for (const auto &d : xmpData) {
+        if (findExifTag(d.key(), tag) && !tags[tag]) tags[tag].setText(d.toString(0));
     }
-    return xmpData.end();
 }
 
 ImageSize ExifParser::extractImageSize() {
@@ -47,15 +72,13 @@ ImageSize ExifParser::extractImageSize() {
 //        return ImageSize(static_cast<int>(imgWidth->toInt64()), static_cast<int>(imgHeight->toInt64()));
 //    }
 
-    return ImageSize(image->pixelWidth(), image->pixelHeight());
+    return ImageSize(tags.imageWidth, tags.imageHeight);
 }
 
 ImageSize ExifParser::extractVideoSize() {
-    auto xmpWidth = findXmpKey({"Xmp.video.Width"});
-    auto xmpHeight = findXmpKey({"Xmp.video.Height"});
-    if (xmpWidth != xmpData.end() && xmpHeight != xmpData.end()){
+    if (tags[XmpVideoWidth] && tags[XmpVideoHeight]){
         try{
-            return ImageSize(std::stoi(xmpWidth->toString()), std::stoi(xmpHeight->toString()));
+            return ImageSize(std::stoi(tags[XmpVideoWidth].toString()), std::stoi(tags[XmpVideoHeight].toString()));
         }catch(const std::invalid_argument& ia){
             LOGD << "Cannot parse XMP video width/height";
             return ImageSize(0, 0);
@@ -66,20 +89,20 @@ ImageSize ExifParser::extractVideoSize() {
 }
 
 std::string ExifParser::extractMake() {
-    auto k = findExifKey({"Exif.Photo.LensMake", "Exif.Image.Make"});
+    const auto &k = first({&tags[ExifLensMake], &tags[ExifMake]});
 
-    if (k != exifData.end()) {
-        return k->toString();
+    if (k) {
+        return k.toString();
     } else {
         return "unknown";
     }
 }
 
 std::string ExifParser::extractModel() {
-    auto k = findExifKey({"Exif.Image.Model", "Exif.Photo.LensModel"});
+    const auto &k = first({&tags[ExifModel], &tags[ExifLensModel]});
 
-    if (k != exifData.end()) {
-        return k->toString();
+    if (k) {
+        return k.toString();
     } else {
         return "unknown";
     }
@@ -112,14 +135,14 @@ bool ExifParser::computeFocal(Focal &f) {
 
     if (extractSensorSize(r)) {
         double sensorWidth = r.width;
-        auto focal35 = findExifKey("Exif.Photo.FocalLengthIn35mmFilm");
-        auto focal = findExifKey("Exif.Photo.FocalLength");
+        const auto &focal35 = tags[ExifFocalLengthIn35mmFilm];
+        const auto &focal = tags[ExifFocalLength];
 
-        if (focal35 != exifData.end() && focal35->toFloat() > 0) {
-            f.length35 = static_cast<double>(focal35->toFloat());
+        if (focal35 && focal35.toFloat() > 0) {
+            f.length35 = static_cast<double>(focal35.toFloat());
             f.length = (f.length35 / 36.0) * sensorWidth;
-        } else if (focal != exifData.end() && focal->toFloat() > 0) {
-            f.length = static_cast<double>(focal->toFloat());
+        } else if (focal && focal.toFloat() > 0) {
+            f.length = static_cast<double>(focal.toFloat());
             f.length35 = (36.0 * f.length) / sensorWidth;
         }
 
@@ -131,20 +154,20 @@ bool ExifParser::computeFocal(Focal &f) {
 
 // Extracts sensor sizes (in mm). Returns 0 on failure
 bool ExifParser::extractSensorSize(SensorSize &r) {
-    auto fUnit = findExifKey("Exif.Photo.FocalPlaneResolutionUnit");
-    auto fXRes = findExifKey("Exif.Photo.FocalPlaneXResolution");
-    auto fYRes = findExifKey("Exif.Photo.FocalPlaneYResolution");
+    const auto &fUnit = tags[ExifFocalPlaneResolutionUnit];
+    const auto &fXRes = tags[ExifFocalPlaneXResolution];
+    const auto &fYRes = tags[ExifFocalPlaneYResolution];
 
-    if (fUnit != exifData.end() && fXRes != exifData.end() && fYRes != exifData.end()) {
-        long resolutionUnit = fUnit->toInt64();
+    if (fUnit && fXRes && fYRes) {
+        long resolutionUnit = static_cast<long>(fUnit.toInt64());
         double mmPerUnit = getMmPerUnit(resolutionUnit);
         if (mmPerUnit != 0.0) {
             auto imsize = extractImageSize();
 
-            double xUnitsPerPixel = 1.0 / static_cast<double>(fXRes->toFloat());
+            double xUnitsPerPixel = 1.0 / static_cast<double>(fXRes.toFloat());
             r.width = imsize.width * xUnitsPerPixel * mmPerUnit;
 
-            double yUnitsPerPixel = 1.0 / static_cast<double>(fYRes->toFloat());
+            double yUnitsPerPixel = 1.0 / static_cast<double>(fYRes.toFloat());
             r.height = imsize.height * yUnitsPerPixel * mmPerUnit;
 
             return true; // Good, exit here
@@ -184,50 +207,39 @@ inline double ExifParser::getMmPerUnit(long resolutionUnit) {
 
 // Extract geolocation information
 bool ExifParser::extractGeo(GeoLocation &geo) {
-    auto latitude = findExifKey({"Exif.GPSInfo.GPSLatitude"});
-    auto latitudeRef = findExifKey({"Exif.GPSInfo.GPSLatitudeRef"});
-    auto longitude = findExifKey({"Exif.GPSInfo.GPSLongitude"});
-    auto longitudeRef = findExifKey({"Exif.GPSInfo.GPSLongitudeRef"});
-
-    if (latitude != exifData.end() && longitude != exifData.end()){
-        geo.latitude = geoToDecimal(latitude, latitudeRef);
-        geo.longitude = geoToDecimal(longitude, longitudeRef);
-
-        auto altitude = findExifKey({"Exif.GPSInfo.GPSAltitude"});
-        if (altitude != exifData.end()) {
-            geo.altitude = evalFrac(altitude->toRational());
-
-            auto altitudeRef = findExifKey({"Exif.GPSInfo.GPSAltitudeRef"});
-            if (altitudeRef != exifData.end()) {
-                geo.altitude *= altitudeRef->toInt64() == 1 ? -1 : 1;
+    if (tags[ExifGPSLatitude] && tags[ExifGPSLongitude]){
+        geo.latitude = geoToDecimal(tags[ExifGPSLatitude], tags[ExifGPSLatitudeRef]);
+        geo.longitude = geoToDecimal(tags[ExifGPSLongitude], tags[ExifGPSLongitudeRef]);
+
+        if (tags[ExifGPSAltitude]) {
+            geo.altitude = evalFrac(tags[ExifGPSAltitude].toRational());
+
+            if (tags[ExifGPSAltitudeRef]) {
+                geo.altitude *= tags[ExifGPSAltitudeRef].toInt64() == 1 ? -1 : 1;
             }
         }
 
-        auto xmpAltitude = findXmpKey({"Xmp.drone-dji.AbsoluteAltitude"});
-        if (xmpAltitude != xmpData.end()) {
-            geo.altitude = evalFrac(xmpAltitude->toRational());
+        if (tags[XmpDjiAbsoluteAltitude]) {
+            geo.altitude = evalFrac(tags[XmpDjiAbsoluteAltitude].toRational());
         }
 
         // Use DJI's XMP tags for lat/lon, if available
         // certain models (e.g. Mavic Air) do not have sufficient
         // precision in the EXIF coordinates
-        auto xmpLatitude = findXmpKey({"Xmp.drone-dji.Latitude"});
-        if (xmpLatitude != xmpData.end()) {
-            geo.latitude = xmpLatitude->toFloat();
+        if (tags[XmpDjiLatitude]) {
+            geo.latitude = tags[XmpDjiLatitude].toFloat();
         }
-        auto xmpLongitude = findXmpKey({"Xmp.drone-dji.Longitude"});
-        if (xmpLongitude != xmpData.end()) {
-            geo.longitude = xmpLongitude->toFloat();
+        if (tags[XmpDjiLongitude]) {
+            geo.longitude = tags[XmpDjiLongitude].toFloat();
         }
 
         return true;
     }
 
-    auto gpsCoordinates = findXmpKey({"Xmp.video.GPSCoordinates"});
-    if (gpsCoordinates != xmpData.end()){
+    if (tags[XmpVideoGPSCoordinates]){
         // Xmp.video.GPSCoordinates +46.839139-91.999828+25.700
         // [+-]lat[+-]lon[+-]alt
-        std::string gps = gpsCoordinates->toString();
+        std::string gps = tags[XmpVideoGPSCoordinates].toString();
         if (gps.length() < 1){
             LOGD << "Invalid GPS coordinates (empty)";
             return false;
@@ -277,9 +289,8 @@ bool ExifParser::extractGeo(GeoLocation &geo) {
 
 bool ExifParser::extractRelAltitude(double &relAltitude) {
     // Some drones have a value for relative altitude
-    auto k = findXmpKey("Xmp.drone-dji.RelativeAltitude");
-    if (k != xmpData.end()){
-        relAltitude = static_cast<double>(k->toFloat());
+    if (tags[XmpDjiRelativeAltitude]){
+        relAltitude = static_cast<double>(tags[XmpDjiRelativeAltitude].toFloat());
         return true;
     }
 
@@ -295,13 +306,13 @@ bool ExifParser::extractRelAltitude(double &relAltitude) {
 }
 
 // Converts a geotag location to decimal degrees
-inline double ExifParser::geoToDecimal(const Exiv2::ExifData::const_iterator &geoTag, const Exiv2::ExifData::const_iterator &geoRefTag) {
-    if (geoTag == exifData.end()) return 0.0;
+inline double ExifParser::geoToDecimal(const ExifValue &geoTag, const ExifValue &geoRefTag) {
+    if (!geoTag) return 0.0;
 
     // N/S, W/E
     double sign = 1.0;
-    if (geoRefTag != exifData.end()) {
-        std::string ref = geoRefTag->toString();
+    if (geoRefTag) {
+        std::string ref = geoRefTag.toString();
         utils::toUpper(ref);
         if (ref == "S" || ref == "W") sign = -1.0;
     }
@@ -310,27 +321,27 @@ inline double ExifParser::geoToDecimal(const Exiv2::ExifData::const_iterator &ge
 //         << geoTag->toRational(1).first << "/" << geoTag->toRational(1).second << " "
 //         << geoTag->toRational(2).first << "/" << geoTag->toRational(2).second;
 
-    double degrees = evalFrac(geoTag->toRational(0));
-    double minutes = evalFrac(geoTag->toRational(1));
-    double seconds = evalFrac(geoTag->toRational(2));
+    double degrees = evalFrac(geoTag.toRational(0));
+    double minutes = evalFrac(geoTag.toRational(1));
+    double seconds = evalFrac(geoTag.toRational(2));
 
     return sign * (degrees + minutes / 60.0 + seconds / 3600.0);
 }
 
 // Evaluates a rational
-double ExifParser::evalFrac(const Exiv2::Rational &rational) {
+double ExifParser::evalFrac(const std::pair<int32_t, int32_t> &rational) {
     if (rational.second == 0) return 0.0;
     return static_cast<double>(rational.first) / static_cast<double>(rational.second);
 }
 
 // Extracts timestamp (seconds from Jan 1st 1970)
 double ExifParser::extractCaptureTime() {
-    auto xmpDate = findXmpKey({"Xmp.video.DateUTC", "Xmp.video.MediaCreateDate"});
-    if (xmpDate != xmpData.end()){
+    const auto &xmpDate = first({&tags[XmpVideoDateUTC], &tags[XmpVideoMediaCreateDate]});
+    if (xmpDate){
         try{
             // Number of seconds between Jan 1st 1904 and Jan 1st 1970
             const long TO_UNIX_EPOCH = 2082844800;
-            const long d = xmpDate->toInt64();
+            const long d = static_cast<long>(xmpDate.toInt64());
             double captureTime = (d - TO_UNIX_EPOCH) * 1000.0;
             if (captureTime > 0){
                 return captureTime;
@@ -338,25 +349,25 @@ double ExifParser::extractCaptureTime() {
                 LOGD << "Cannot use XMP capture time (negative?)";
             }
         }catch(const std::invalid_argument& ia){
-            LOGD << "Cannot parse XMP capture time " << xmpDate->toString();
+            LOGD << "Cannot parse XMP capture time " << xmpDate.toString();
         }
     }
 
-    auto time = findExifKey({"Exif.Photo.DateTimeOriginal",
-                             "Exif.Photo.DateTimeDigitized",
-                             "Exif.Image.DateTime"});
-    if (time == exifData.end()) return 0.0;
+    const auto &time = first({&tags[ExifDateTimeOriginal],
+                              &tags[ExifDateTimeDigitized],
+                              &tags[ExifDateTime]});
+    if (!time) return 0.0;
 
     int year, month, day, hour, minute, second;
 
-    if (sscanf(time->toString().c_str(),"%d:%d:%d %d:%d:%d", &year,&month,&day,&hour,&minute,&second) == 6) {
+    if (sscanf(time.toString().c_str(),"%d:%d:%d %d:%d:%d", &year,&month,&day,&hour,&minute,&second) == 6) {
         double msecs = 0.0;
-        auto subsec = findExifKey({"Exif.Photo.SubSecTimeOriginal",
-                                 "Exif.Photo.SubSecTimeDigitized",
-                                 "Exif.Photo.SubSecTime"});
-        if (subsec != exifData.end() && subsec->count() > 0){
-            double ss = static_cast<double>(subsec->toInt64());
-            size_t numDigits = subsec->toString().length();
+        const auto &subsec = first({&tags[ExifSubSecTimeOriginal],
+                                    &tags[ExifSubSecTimeDigitized],
+                                    &tags[ExifSubSecTime]});
+        if (subsec && subsec.count() > 0){
+            double ss = static_cast<double>(subsec.toInt64());
+            size_t numDigits = subsec.toString().length();
 
             // ."1" --> "100"
             // ."12" --> "120"
@@ -383,34 +394,33 @@ double ExifParser::extractCaptureTime() {
 
         return Timezone::getUTCEpoch(year, month, day, hour, minute, second, msecs, tz);
     }else{
-        LOGD << "Invalid date/time format: " << time->toString();
+        LOGD << "Invalid date/time format: " << time.toString();
         return 0.0;
     }
 }
 
 int ExifParser::extractImageOrientation() {
-    auto k = findExifKey({"Exif.Image.Orientation"});
-    if (k != exifData.end()) {
-        return static_cast<int>(k->toInt64());
+    if (tags[ExifOrientation]) {
+        return static_cast<int>(tags[ExifOrientation].toInt64());
     }
 
     return 1;
 }
 
 bool ExifParser::extractCameraOrientation(CameraOrientation &cameraOri) {
-    auto pk = findXmpKey({"Xmp.drone-dji.GimbalPitchDegree", "Xmp.Camera.Pitch"});
-    auto yk = findXmpKey({"Xmp.drone-dji.GimbalYawDegree", "Xmp.drone-dji.FlightYawDegree", "Xmp.Camera.Yaw"});
-    auto rk = findXmpKey({"Xmp.drone-dji.GimbalRollDegree", "Xmp.Camera.Roll"});
+    const auto &pk = first({&tags[XmpDjiGimbalPitchDegree], &tags[XmpCameraPitch]});
+    const auto &yk = first({&tags[XmpDjiGimbalYawDegree], &tags[XmpDjiFlightYawDegree], &tags[XmpCameraYaw]});
+    const auto &rk = first({&tags[XmpDjiGimbalRollDegree], &tags[XmpCameraRoll]});
 
-    if (pk == xmpData.end() || yk == xmpData.end() || rk == xmpData.end()){
+    if (!pk || !yk || !rk){
         cameraOri.pitch = -90;
         cameraOri.yaw = 0;
         cameraOri.roll = 0;
         return false;
     }
-    cameraOri.pitch = static_cast<double>(pk->toFloat());
-    cameraOri.yaw = static_cast<double>(yk->toFloat());
-    cameraOri.roll = static_cast<double>(rk->toFloat());
+    cameraOri.pitch = static_cast<double>(pk.toFloat());
+    cameraOri.yaw = static_cast<double>(yk.toFloat());
+    cameraOri.roll = static_cast<double>(rk.toFloat());
 
     // TODO: JSON orientation database
     if (extractMake() == "senseFly"){
@@ -434,30 +444,26 @@ bool ExifParser::extractPanoramaInfo(PanoramaInfo &info){
     info.posePitch = 0.0f;
     info.poseRoll = 0.0f;
 
-    auto projectionType = findXmpKey({"Xmp.GPano.ProjectionType"});
-    auto croppedWidth = findXmpKey({"Xmp.GPano.CroppedAreaImageWidthPixels"});
-    auto croppedHeight = findXmpKey({"Xmp.GPano.CroppedAreaImageHeightPixels"});
-    auto croppedX = findXmpKey({"Xmp.GPano.CroppedAreaLeftPixels"});
-    auto croppedY = findXmpKey({"Xmp.GPano.CroppedAreaTopPixels"});
-    auto poseHeading = findXmpKey({"Xmp.GPano.PoseHeadingDegrees"});
-    auto posePitch = findXmpKey({"Xmp.GPano.PosePitchDegrees"});
-    auto poseRoll = findXmpKey({"Xmp.GPano.PoseRollDegrees"});
-
-    if (projectionType != xmpData.end()) info.projectionType = projectionType->toString();
-    if (croppedWidth != xmpData.end() && croppedHeight != xmpData.end()){
-        info.croppedWidth = croppedWidth->toInt64();
-        info.croppedHeight = croppedHeight->toInt64();
+    if (tags[XmpGPanoProjectionType]) info.projectionType = tags[XmpGPanoProjectionType].toString();
+    if (tags[XmpGPanoCroppedAreaImageWidthPixels] && tags[XmpGPanoCroppedAreaImageHeightPixels]){
+        info.croppedWidth = static_cast<int>(tags[XmpGPanoCroppedAreaImageWidthPixels].toInt64());
+        info.croppedHeight = static_cast<int>(tags[XmpGPanoCroppedAreaImageHeightPixels].toInt64());
     }
-    if (croppedX != xmpData.end()) info.croppedX = croppedX->toInt64();
-    if (croppedY != xmpData.end()) info.croppedY = croppedY->toInt64();
-    if (poseHeading != xmpData.end()) info.poseHeading = poseHeading->toFloat();
-    if (posePitch != xmpData.end()) info.posePitch = posePitch->toFloat();
-    if (poseRoll != xmpData.end()) info.poseRoll = poseRoll->toFloat();
+    if (tags[XmpGPanoCroppedAreaLeftPixels]) info.croppedX = static_cast<int>(tags[XmpGPanoCroppedAreaLeftPixels].toInt64());
+    if (tags[XmpGPanoCroppedAreaTopPixels]) info.croppedY = static_cast<int>(tags[XmpGPanoCroppedAreaTopPixels].toInt64());
+    if (tags[XmpGPanoPoseHeadingDegrees]) info.poseHeading = tags[XmpGPanoPoseHeadingDegrees].toFloat();
+    if (tags[XmpGPanoPosePitchDegrees]) info.posePitch = tags[XmpGPanoPosePitchDegrees].toFloat();
+    if (tags[XmpGPanoPoseRollDegrees]) info.poseRoll = tags[XmpGPanoPoseRollDegrees].toFloat();
 
     return true;
 }
 
+// Print the metadata read by Exiv2 (if the parser was created from an image)
 void ExifParser::printAllTags() {
+    if (image == nullptr) return;
+    const auto &exifData = image->exifData();
+    const auto &xmpData = image->xmpData();
+
     Exiv2::ExifData::const_iterator end = exifData.end();
     for (Exiv2::ExifData::const_iterator i = exifData.begin(); i != end; ++i) {
         const char* tn = i->typeName();
@@ -477,11 +483,11 @@ void ExifParser::printAllTags() {
 }
 
 bool ExifParser::hasExif() {
-    return !exifData.empty();
+    return tags.hasExif;
 }
 
 bool ExifParser::hasXmp() {
-    return !xmpData.empty();
+    return tags.hasXmp;
 }
 
 bool ExifParser::hasTags(){
@@ -7,6 +7,7 @@
 #include <exiv2/exiv2.hpp>
 #include <stdio.h>
 #include "utils.h"
+#include "exifreader.h"
 #include "sensor_data.h"
 #include "ddb_export.h"
 
@@ -68,17 +69,18 @@ inline std::ostream& operator<<(std::ostream& os, const CameraOrientation& c)
 
 
 
+// Extracts image properties from the metadata of an image or video
 class ExifParser {
-    Exiv2::Image *image;
-    Exiv2::ExifData exifData;
-    Exiv2::XmpData xmpData;
+    ExifTags tags;
+    Exiv2::Image *image = nullptr;
   public:
-    DDB_DLL ExifParser(Exiv2::Image *image) : image(image), exifData(image->exifData()), xmpData(image->xmpData()) {};
+    // Read the tags from the metadata parsed by Exiv2
+    DDB_DLL ExifParser(Exiv2::Image *image);
 
-    DDB_DLL Exiv2::ExifData::const_iterator findExifKey(const std::string &key);
-    DDB_DLL Exiv2::ExifData::const_iterator findExifKey(const std::initializer_list<std::string>& keys);
-    DDB_DLL Exiv2::XmpData::const_iterator findXmpKey(const std::string &key);
-    DDB_DLL Exiv2::XmpData::const_iterator findXmpKey(const std::initializer_list<std::string>& keys);
+    // Use tags read with readJpegTags
+    DDB_DLL ExifParser(const ExifTags &tags) : tags(tags) {};
+
+    const ExifTags &getTags() const { return tags; }
 
     DDB_DLL ImageSize extractImageSize();
     DDB_DLL ImageSize extractVideoSize();
@@ -91,8 +93,8 @@ class ExifParser {
 
     DDB_DLL  bool extractGeo(GeoLocation &geo);
     DDB_DLL bool extractRelAltitude(double &relAltitude);
-    DDB_DLL inline double geoToDecimal(const Exiv2::ExifData::const_iterator &geoTag, const Exiv2::ExifData::const_iterator &geoRefTag);
-    DDB_DLL inline double evalFrac(const Exiv2::Rational &rational);
+    DDB_DLL inline double geoToDecimal(const ExifValue &geoTag, const ExifValue &geoRefTag);
+    DDB_DLL inline double evalFrac(const std::pair<int32_t, int32_t> &rational);
 
     DDB_DLL double extractCaptureTime();
     DDB_DLL int extractImageOrientation();
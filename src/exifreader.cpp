@@ -0,0 +1,730 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <sstream>
+#include <string_view>
+#include <unordered_map>
+#include "exifreader.h"
+
+#ifdef WIN32
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ddb {
+
+namespace {
+
+// Same as Exiv2's stringTo: the whole string must be consumed
+template <typename T>
+bool stringTo(const std::string &s, T &out) {
+    std::istringstream is(s);
+    if (!(is >> out)) return false;
+    std::string rest;
+    is >> std::skipws >> rest;
+    return rest.empty();
+}
+
+bool stringToRational(const std::string &s, std::pair<int32_t, int32_t> &out) {
+    std::istringstream is(s);
+    int32_t num, den;
+    char c = 0;
+    if (!(is >> num >> c >> den) || c != '/') return false;
+    std::string rest;
+    is >> std::skipws >> rest;
+    if (!rest.empty()) return false;
+    out = {num, den};
+    return true;
+}
+
+bool stringToBool(const std::string &s, bool &out) {
+    if (s == "true") out = true;
+    else if (s == "false") out = false;
+    else return false;
+    return true;
+}
+
+// Exiv2's floatToRationalCast
+std::pair<int32_t, int32_t> floatToRational(float f) {
+    const double d = f;
+    if (!(d >= std::numeric_limits<int32_t>::min() + 1.0 && d <= std::numeric_limits<int32_t>::max()))
+        return {d > 0 ? 1 : -1, 0};
+
+    int32_t den = 1000000;
+    const long long dl = std::llabs(static_cast<long long>(d));
+    if (dl > 2147) den = 10000;
+    if (dl > 214748) den = 100;
+    if (dl > 21474836) den = 1;
+    const auto nom = static_cast<int32_t>(std::round(d * den));
+    const int32_t g = std::gcd(nom, den);
+    return {nom / g, den / g};
+}
+
+}
+
+size_t ExifValue::count() const {
+    return numbers.empty() ? text.size() : numbers.size();
+}
+
+std::string ExifValue::toString() const {
+    if (numbers.empty()) return text;
+
+    std::string s;
+    for (const auto &n : numbers) {
+        if (!s.empty()) s += " ";
+        s += std::to_string(n.first);
+        if (rational) s += "/" + std::to_string(n.second);
+    }
+    return s;
+}
+
+int64_t ExifValue::toInt64(size_t n) const {
+    if (!numbers.empty()) {
+        if (n >= numbers.size() || numbers[n].second <= 0) return 0;
+        return numbers[n].first / numbers[n].second;
+    }
+
+    int64_t i;
+    if (stringTo(text, i)) return i;
+    float f;
+    if (stringTo(text, f)) return static_cast<int64_t>(f);
+    std::pair<int32_t, int32_t> r;
+    if (stringToRational(text, r) && r.second != 0) return r.first / r.second;
+    bool b;
+    if (stringToBool(text, b)) return b ? 1 : 0;
+    return 0;
+}
+
+float ExifValue::toFloat(size_t n) const {
+    if (!numbers.empty()) {
+        if (n >= numbers.size() || numbers[n].second == 0) return 0.0f;
+        return static_cast<float>(numbers[n].first) / static_cast<float>(numbers[n].second);
+    }
+
+    float f;
+    if (stringTo(text, f)) return f;
+    std::pair<int32_t, int32_t> r;
+    if (stringToRational(text, r) && r.second != 0) return static_cast<float>(r.first) / static_cast<float>(r.second);
+    bool b;
+    if (stringToBool(text, b)) return b ? 1.0f : 0.0f;
+    return 0.0f;
+}
+
+std::pair<int32_t, int32_t> ExifValue::toRational(size_t n) const {
+    if (!numbers.empty()) {
+        if (n >= numbers.size()) return {0, 0};
+        return {static_cast<int32_t>(numbers[n].first), static_cast<int32_t>(numbers[n].second)};
+    }
+
+    std::pair<int32_t, int32_t> r;
+    if (stringToRational(text, r)) return r;
+    float f;
+    if (stringTo(text, f)) return floatToRational(f);
+    bool b;
+    if (stringToBool(text, b)) return {b ? 1 : 0, 1};
+    return {0, 0};
+}
+
+void ExifValue::setText(std::string t) {
+    present = true;
+    text = std::move(t);
+    numbers.clear();
+}
+
+void ExifValue::addNumber(int64_t num, int64_t den) {
+    present = true;
+    numbers.emplace_back(num, den);
+}
+
+namespace {
+
+// Directory of an EXIF tag in the TIFF structure
+enum ExifIfd { IfdImage, IfdPhoto, IfdGPSInfo, IfdNone };
+
+struct ExifTagKey {
+    ExifTag slot;
+    const char *key;
+    ExifIfd ifd;
+    uint16_t tag; // EXIF tag number
+};
+
+constexpr ExifTagKey exifTagKeys[] = {
+    {ExifMake, "Exif.Image.Make", IfdImage, 0x010F},
+    {ExifModel, "Exif.Image.Model", IfdImage, 0x0110},
+    {ExifOrientation, "Exif.Image.Orientation", IfdImage, 0x0112},
+    {ExifDateTime, "Exif.Image.DateTime", IfdImage, 0x0132},
+
+    {ExifLensMake, "Exif.Photo.LensMake", IfdPhoto, 0xA433},
+    {ExifLensModel, "Exif.Photo.LensModel", IfdPhoto, 0xA434},
+    {ExifFocalLength, "Exif.Photo.FocalLength", IfdPhoto, 0x920A},
+    {ExifFocalLengthIn35mmFilm, "Exif.Photo.FocalLengthIn35mmFilm", IfdPhoto, 0xA405},
+    {ExifFocalPlaneXResolution, "Exif.Photo.FocalPlaneXResolution", IfdPhoto, 0xA20E},
+    {ExifFocalPlaneYResolution, "Exif.Photo.FocalPlaneYResolution", IfdPhoto, 0xA20F},
+    {ExifFocalPlaneResolutionUnit, "Exif.Photo.FocalPlaneResolutionUnit", IfdPhoto, 0xA210},
+    {ExifDateTimeOriginal, "Exif.Photo.DateTimeOriginal", IfdPhoto, 0x9003},
+    {ExifDateTimeDigitized, "Exif.Photo.DateTimeDigitized", IfdPhoto, 0x9004},
+    {ExifSubSecTime, "Exif.Photo.SubSecTime", IfdPhoto, 0x9290},
+    {ExifSubSecTimeOriginal, "Exif.Photo.SubSecTimeOriginal", IfdPhoto, 0x9291},
+    {ExifSubSecTimeDigitized, "Exif.Photo.SubSecTimeDigitized", IfdPhoto, 0x9292},
+
+    {ExifGPSLatitude, "Exif.GPSInfo.GPSLatitude", IfdGPSInfo, 0x0002},
+    {ExifGPSLatitudeRef, "Exif.GPSInfo.GPSLatitudeRef", IfdGPSInfo, 0x0001},
+    {ExifGPSLongitude, "Exif.GPSInfo.GPSLongitude", IfdGPSInfo, 0x0004},
+    {ExifGPSLongitudeRef, "Exif.GPSInfo.GPSLongitudeRef", IfdGPSInfo, 0x0003},
+    {ExifGPSAltitude, "Exif.GPSInfo.GPSAltitude", IfdGPSInfo, 0x0006},
+    {ExifGPSAltitudeRef, "Exif.GPSInfo.GPSAltitudeRef", IfdGPSInfo, 0x0005},
+
+    {XmpDjiAbsoluteAltitude, "Xmp.drone-dji.AbsoluteAltitude", IfdNone, 0},
+    {XmpDjiRelativeAltitude, "Xmp.drone-dji.RelativeAltitude", IfdNone, 0},
+    {XmpDjiLatitude, "Xmp.drone-dji.Latitude", IfdNone, 0},
+    {XmpDjiLongitude, "Xmp.drone-dji.Longitude", IfdNone, 0},
+    {XmpDjiGimbalPitchDegree, "Xmp.drone-dji.GimbalPitchDegree", IfdNone, 0},
+    {XmpDjiGimbalYawDegree, "Xmp.drone-dji.GimbalYawDegree", IfdNone, 0},
+    {XmpDjiGimbalRollDegree, "Xmp.drone-dji.GimbalRollDegree", IfdNone, 0},
+    {XmpDjiFlightYawDegree, "Xmp.drone-dji.FlightYawDegree", IfdNone, 0},
+
+    {XmpCameraPitch, "Xmp.Camera.Pitch", IfdNone, 0},
+    {XmpCameraYaw, "Xmp.Camera.Yaw", IfdNone, 0},
+    {XmpCameraRoll, "Xmp.Camera.Roll", IfdNone, 0},
+
+    {XmpGPanoProjectionType, "Xmp.GPano.ProjectionType", IfdNone, 0},
+    {XmpGPanoCroppedAreaImageWidthPixels, "Xmp.GPano.CroppedAreaImageWidthPixels", IfdNone, 0},
+    {XmpGPanoCroppedAreaImageHeightPixels, "Xmp.GPano.CroppedAreaImageHeightPixels", IfdNone, 0},
+    {XmpGPanoCroppedAreaLeftPixels, "Xmp.GPano.CroppedAreaLeftPixels", IfdNone, 0},
+    {XmpGPanoCroppedAreaTopPixels, "Xmp.GPano.CroppedAreaTopPixels", IfdNone, 0},
+    {XmpGPanoPoseHeadingDegrees, "Xmp.GPano.PoseHeadingDegrees", IfdNone, 0},
+    {XmpGPanoPosePitchDegrees, "Xmp.GPano.PosePitchDegrees", IfdNone, 0},
+    {XmpGPanoPoseRollDegrees, "Xmp.GPano.PoseRollDegrees", IfdNone, 0},
+
+    {XmpVideoWidth, "Xmp.video.Width", IfdNone, 0},
+    {XmpVideoHeight, "Xmp.video.Height", IfdNone, 0},
+    {XmpVideoDateUTC, "Xmp.video.DateUTC", IfdNone, 0},
+    {XmpVideoMediaCreateDate, "Xmp.video.MediaCreateDate", IfdNone, 0},
+    {XmpVideoGPSCoordinates, "Xmp.video.GPSCoordinates", IfdNone, 0},
+};
+
+constexpr bool tagKeysInOrder() {
+    size_t i = 0;
+    for (const auto &k : exifTagKeys) {
+        if (k.slot != static_cast<ExifTag>(i++)) return false;
+    }
+    return i == ExifTagCount;
+}
+static_assert(tagKeysInOrder(), "exifTagKeys must list every ExifTag, in order");
+
+}
+
+bool findExifTag(std::string_view key, ExifTag &tag) {
+    static const auto slots = [] {
+        std::unordered_map<std::string_view, ExifTag> m;
+        for (const auto &k : exifTagKeys) m.emplace(k.key, k.slot);
+        return m;
+    }();
+
+    const auto it = slots.find(key);
+    if (it == slots.end()) return false;
+    tag = it->second;
+    return true;
+}
+
+const char *exifTagKey(ExifTag tag) {
+    return exifTagKeys[tag].key;
+}
+
+namespace {
+
+// Bytes of a file, or of a memory buffer, accessed by offset
+class ByteSource {
+    const uint8_t *data = nullptr;
+    uint64_t size = 0;
+
+    std::vector<uint8_t> head;
+    std::vector<uint8_t> scratch;
+#ifdef WIN32
+    std::ifstream file;
+#else
+    int fd = -1;
+#endif
+
+    bool readAt(uint64_t offset, uint8_t *buf, size_t len) {
+#ifdef WIN32
+        file.clear();
+        file.seekg(static_cast<std::streamoff>(offset));
+        file.read(reinterpret_cast<char *>(buf), static_cast<std::streamsize>(len));
+        return static_cast<size_t>(file.gcount()) == len;
+#else
+        size_t done = 0;
+        while (done < len) {
+            const auto r = pread(fd, buf + done, len - done, static_cast<off_t>(offset + done));
+            if (r <= 0) return false;
+            done += static_cast<size_t>(r);
+        }
+        return true;
+#endif
+    }
+
+public:
+    ByteSource(const uint8_t *data, size_t size) : data(data), size(size) {}
+
+    ByteSource(const fs::path &path) {
+#ifdef WIN32
+        file.open(path, std::ios::binary);
+        if (!file.is_open()) return;
+        file.seekg(0, std::ios::end);
+        size = static_cast<uint64_t>(file.tellg());
+#else
+        fd = ::open(path.string().c_str(), O_RDONLY);
+        if (fd == -1) return;
+        struct stat st;
+        if (fstat(fd, &st) != 0) return;
+        size = static_cast<uint64_t>(st.st_size);
+#endif
+        head.resize(static_cast<size_t>(std::min<uint64_t>(size, DDB_JPEG_HEADER_READ_SIZE)));
+        if (!readAt(0, head.data(), head.size())) {
+            head.clear();
+            size = 0;
+        }
+        data = head.data();
+    }
+
+    ~ByteSource() {
+#ifndef WIN32
+        if (fd != -1) close(fd);
+#endif
+    }
+
+    ByteSource(const ByteSource &) = delete;
+    ByteSource &operator=(const ByteSource &) = delete;
+
+    // @return len bytes at offset (valid until the next call), or nullptr if
+    // they are past the end of the data
+    const uint8_t *get(uint64_t offset, size_t len) {
+        if (offset > size || len > size - offset) return nullptr;
+
+        // Everything is in memory, or in the head of the file
+        if (head.empty() || offset + len <= head.size()) return data + offset;
+
+        scratch.resize(len);
+        if (!readAt(offset, scratch.data(), len)) return nullptr;
+        return scratch.data();
+    }
+};
+
+const uint16_t ExifIfdPointer = 0x8769;
+const uint16_t GpsIfdPointer = 0x8825;
+
+// Reads the IFDs of the TIFF structure in an EXIF segment
+class TiffReader {
+    const uint8_t *d;
+    size_t size;
+    bool le = true;
+
+    uint16_t u16(size_t off) const {
+        return le ? static_cast<uint16_t>(d[off] | d[off + 1] << 8) :
+                    static_cast<uint16_t>(d[off] << 8 | d[off + 1]);
+    }
+
+    uint32_t u32(size_t off) const {
+        return le ? static_cast<uint32_t>(d[off]) | static_cast<uint32_t>(d[off + 1]) << 8 |
+                        static_cast<uint32_t>(d[off + 2]) << 16 | static_cast<uint32_t>(d[off + 3]) << 24 :
+                    static_cast<uint32_t>(d[off]) << 24 | static_cast<uint32_t>(d[off + 1]) << 16 |
+                        static_cast<uint32_t>(d[off + 2]) << 8 | static_cast<uint32_t>(d[off + 3]);
+    }
+
+    static size_t typeSize(uint16_t type) {
+        switch (type) {
+            case 1: case 2: case 6: case 7: return 1;  // BYTE, ASCII, SBYTE, UNDEFINED
+            case 3: case 8: return 2;                  // SHORT, SSHORT
+            case 4: case 9: case 11: case 13: return 4; // LONG, SLONG, FLOAT, IFD
+            case 5: case 10: case 12: return 8;         // RATIONAL, SRATIONAL, DOUBLE
+            default: return 0;
+        }
+    }
+
+    // @return false if the value cannot be decoded
+    bool decode(uint16_t type, uint32_t count, size_t off, ExifValue &v) const {
+        switch (type) {
+            case 2: {
+                // Like Exiv2, text ends at the first NUL
+                const char *s = reinterpret_cast<const char *>(d + off);
+                v.setText(std::string(s, strnlen(s, count)));
+                return true;
+            }
+            case 1: case 3: case 4: case 6: case 8: case 9:
+                for (uint32_t i = 0; i < count; i++) {
+                    switch (type) {
+                        case 1: v.addNumber(d[off + i]); break;
+                        case 3: v.addNumber(u16(off + i * 2)); break;
+                        case 4: v.addNumber(u32(off + i * 4)); break;
+                        case 6: v.addNumber(static_cast<int8_t>(d[off + i])); break;
+                        case 8: v.addNumber(static_cast<int16_t>(u16(off + i * 2))); break;
+                        case 9: v.addNumber(static_cast<int32_t>(u32(off + i * 4))); break;
+                    }
+                }
+                return true;
+            case 5: case 10:
+                v.rational = true;
+                for (uint32_t i = 0; i < count; i++) {
+                    const uint32_t num = u32(off + i * 8);
+                    const uint32_t den = u32(off + i * 8 + 4);
+                    if (type == 5) v.addNumber(num, den);
+                    else v.addNumber(static_cast<int32_t>(num), static_cast<int32_t>(den));
+                }
+                return true;
+            default:
+                return false;
+        }
+    }
+
+public:
+    TiffReader(const uint8_t *d, size_t size) : d(d), size(size) {}
+
+    // @return the offset of IFD0, 0 if this is not a TIFF header
+    uint32_t header() {
+        if (size < 8) return 0;
+        if (d[0] == 'I' && d[1] == 'I') le = true;
+        else if (d[0] == 'M' && d[1] == 'M') le = false;
+        else return 0;
+        if (u16(2) != 42) return 0;
+        return u32(4);
+    }
+
+    // Decode the tags of an IFD that have a slot in tags
+    // @param entries set to the number of entries of the IFD
+    // @param pointers set to the values of the sub IFD pointers (if any)
+    // @return false if the IFD is malformed or one of the tags cannot be decoded
+    bool readIfd(uint32_t offset, ExifIfd ifd, ExifTags &tags,
+                 size_t &entries, uint32_t *exifPointer = nullptr, uint32_t *gpsPointer = nullptr) {
+        if (offset < 8 || offset > size - 2) return false;
+        entries = u16(offset);
+        if (entries * 12 > size - offset - 2) return false;
+
+        for (size_t i = 0; i < entries; i++) {
+            const size_t e = offset + 2 + i * 12;
+            const uint16_t tag = u16(e);
+            const uint16_t type = u16(e + 2);
+            const uint32_t count = u32(e + 4);
+
+            if (tag == ExifIfdPointer && exifPointer != nullptr) *exifPointer = u32(e + 8);
+            else if (tag == GpsIfdPointer && gpsPointer != nullptr) *gpsPointer = u32(e + 8);
+
+            for (const auto &k : exifTagKeys) {
+                if (k.ifd != ifd || k.tag != tag) continue;
+
+                // Like Exiv2's findKey, the first occurrence wins
+                ExifValue &v = tags[k.slot];
+                if (v) break;
+
+                const size_t ts = typeSize(type);
+                if (ts == 0 || count > size / ts) return false;
+                const size_t len = ts * count;
+                const size_t valueOffset = len <= 4 ? e + 8 : u32(e + 8);
+                if (valueOffset > size || len > size - valueOffset) return false;
+
+                if (!decode(type, count, valueOffset, v)) return false;
+                break;
+            }
+        }
+
+        return true;
+    }
+};
+
+bool readExif(const uint8_t *d, size_t size, ExifTags &tags) {
+    TiffReader r(d, size);
+    const uint32_t ifd0 = r.header();
+    if (ifd0 == 0) return false;
+
+    size_t entries = 0;
+    uint32_t exifPointer = 0, gpsPointer = 0;
+    if (!r.readIfd(ifd0, IfdImage, tags, entries, &exifPointer, &gpsPointer)) return false;
+    tags.hasExif = entries > 0;
+
+    if (exifPointer != 0 && !r.readIfd(exifPointer, IfdPhoto, tags, entries)) return false;
+    if (gpsPointer != 0 && !r.readIfd(gpsPointer, IfdGPSInfo, tags, entries)) return false;
+
+    return true;
+}
+
+bool isNameChar(char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '-' || c == '_' || c == ':' || c == '.';
+}
+
+bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+std::string unescapeXml(std::string_view s) {
+    std::string r;
+    r.reserve(s.size());
+    for (size_t i = 0; i < s.size(); i++) {
+        if (s[i] == '&') {
+            static const std::pair<const char *, char> entities[] = {
+                {"&amp;", '&'}, {"&lt;", '<'}, {"&gt;", '>'}, {"&quot;", '"'}, {"&apos;", '\''}};
+            bool found = false;
+            for (const auto &e : entities) {
+                const size_t len = strlen(e.first);
+                if (s.compare(i, len, e.first) == 0) {
+                    r.push_back(e.second);
+                    i += len - 1;
+                    found = true;
+                    break;
+                }
+            }
+            if (found) continue;
+        }
+        r.push_back(s[i]);
+    }
+    return r;
+}
+
+// Find a simple property in an XMP packet, written either as an
+// attribute (prefix:Name="value") or as an element (<prefix:Name>value</prefix:Name>)
+// @return false if the property is written in a form that is not supported
+bool findXmpProperty(std::string_view xmp, std::string_view name, ExifValue &v) {
+    for (size_t pos = xmp.find(name); pos != std::string_view::npos; pos = xmp.find(name, pos + 1)) {
+        if (pos == 0) continue;
+        const char before = xmp[pos - 1];
+        size_t i = pos + name.size();
+        if (i >= xmp.size() || isNameChar(xmp[i])) continue;
+
+        if (before == '<') {
+            // Element
+            while (i < xmp.size() && isSpace(xmp[i])) i++;
+            if (i >= xmp.size()) return false;
+            if (xmp[i] != '>') return false; // attributes or empty element
+            const size_t end = xmp.find('<', ++i);
+            if (end == std::string_view::npos) return false;
+            const auto value = xmp.substr(i, end - i);
+
+            // Arrays and structures
+            if (xmp.compare(end, name.size() + 2, "</" + std::string(name)) != 0) return false;
+
+            v.setText(unescapeXml(value));
+            return true;
+        } else if (isSpace(before)) {
+            // Attribute
+            while (i < xmp.size() && isSpace(xmp[i])) i++;
+            if (i >= xmp.size() || xmp[i] != '=') continue;
+            i++;
+            while (i < xmp.size() && isSpace(xmp[i])) i++;
+            if (i >= xmp.size() || (xmp[i] != '"' && xmp[i] != '\'')) return false;
+            const char quote = xmp[i++];
+            const size_t end = xmp.find(quote, i);
+            if (end == std::string_view::npos) return false;
+
+            v.setText(unescapeXml(xmp.substr(i, end - i)));
+            return true;
+        }
+    }
+
+    return true;
+}
+
+// Name of a property in an XMP packet ("Xmp.GPano.ProjectionType" --> "GPano:ProjectionType")
+std::string xmpPropertyName(const char *key) {
+    std::string name(key + 4);
+    name[name.find('.')] = ':';
+    return name;
+}
+
+// Namespaces of the XMP properties that are read, keyed by the prefix Exiv2 uses for them
+const std::pair<std::string_view, std::string_view> xmpNamespaces[] = {
+    {"drone-dji", "http://www.dji.com/drone-dji/1.0/"},
+    {"Camera", "http://pix4d.com/camera/1.0/"},
+    {"GPano", "http://ns.google.com/photos/1.0/panorama/"},
+    {"video", "http://www.video/"}};
+
+constexpr size_t XMP_NAMESPACES = sizeof(xmpNamespaces) / sizeof(xmpNamespaces[0]);
+
+// Namespace declarations (xmlns:prefix="uri") in an XMP packet,
+// the default namespace (xmlns="uri") has an empty prefix
+std::vector<std::pair<std::string_view, std::string_view>> xmpDeclarations(std::string_view xmp) {
+    std::vector<std::pair<std::string_view, std::string_view>> decls;
+    for (size_t pos = xmp.find("xmlns"); pos != std::string_view::npos; pos = xmp.find("xmlns", pos + 1)) {
+        if (pos == 0 || !isSpace(xmp[pos - 1])) continue;
+        size_t i = pos + 5;
+        size_t prefixStart = i;
+        if (i < xmp.size() && xmp[i] == ':') {
+            prefixStart = ++i;
+            while (i < xmp.size() && isNameChar(xmp[i])) i++;
+        }
+        const auto prefix = xmp.substr(prefixStart, i - prefixStart);
+        while (i < xmp.size() && isSpace(xmp[i])) i++;
+        if (i >= xmp.size() || xmp[i] != '=') continue;
+        i++;
+        while (i < xmp.size() && isSpace(xmp[i])) i++;
+        if (i >= xmp.size() || (xmp[i] != '"' && xmp[i] != '\'')) continue;
+        const char quote = xmp[i++];
+        const size_t end = xmp.find(quote, i);
+        if (end == std::string_view::npos) break;
+
+        decls.emplace_back(prefix, xmp.substr(i, end - i));
+    }
+    return decls;
+}
+
+// Prefix bound to a namespace in an XMP packet (empty if the namespace is not used)
+// @return false if the binding can't be resolved without a full XML parser
+// (several prefixes for the namespace, prefixes rebound in nested elements,
+// default namespace or properties used without a declaration)
+bool resolveXmpPrefix(std::string_view xmp, const std::vector<std::pair<std::string_view, std::string_view>> &decls,
+                      const std::pair<std::string_view, std::string_view> &ns, std::string_view &prefix) {
+    prefix = {};
+    bool exiv2PrefixDeclared = false;
+    for (const auto &d : decls) {
+        if (d.second == ns.second) {
+            if (d.first.empty()) return false;
+            if (!prefix.empty() && prefix != d.first) return false;
+            prefix = d.first;
+        }
+        if (d.first == ns.first) exiv2PrefixDeclared = true;
+    }
+
+    if (prefix.empty()) {
+        // Not declared but used anyway
+        return exiv2PrefixDeclared || xmp.find(std::string(ns.first) + ":") == std::string_view::npos;
+    }
+
+    for (const auto &d : decls) {
+        if (d.first == prefix && d.second != ns.second) return false;
+    }
+
+    return true;
+}
+
+bool readXmp(std::string_view xmp, ExifTags &tags) {
+    struct Property {
+        ExifTag slot;
+        size_t ns;
+        std::string name; // without prefix
+    };
+    static const auto properties = [] {
+        std::vector<Property> p;
+        for (const auto &k : exifTagKeys) {
+            if (k.ifd != IfdNone) continue;
+            const auto name = xmpPropertyName(k.key);
+            const auto colon = name.find(':');
+            size_t ns = 0;
+            while (ns < XMP_NAMESPACES && xmpNamespaces[ns].first != std::string_view(name).substr(0, colon)) ns++;
+            p.push_back({k.slot, ns, name.substr(colon + 1)});
+        }
+        return p;
+    }();
+
+    tags.hasXmp = xmp.find('<') != std::string_view::npos;
+    if (!tags.hasXmp) return true;
+
+    // Properties are matched by the prefix the packet binds to their
+    // namespace, which isn't necessarily the one Exiv2 reports them under
+    const auto decls = xmpDeclarations(xmp);
+    std::string_view prefixes[XMP_NAMESPACES];
+    for (size_t i = 0; i < XMP_NAMESPACES; i++) {
+        if (!resolveXmpPrefix(xmp, decls, xmpNamespaces[i], prefixes[i])) return false;
+    }
+
+    std::string name;
+    for (const auto &p : properties) {
+        if (p.ns == XMP_NAMESPACES) return false; // namespace unknown here, left to Exiv2
+        if (prefixes[p.ns].empty()) continue;
+        name.assign(prefixes[p.ns]).append(1, ':').append(p.name);
+        if (!findXmpProperty(xmp, name, tags[p.slot])) return false;
+    }
+
+    return true;
+}
+
+bool isSof(uint8_t marker) {
+    return marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC;
+}
+
+uint16_t be16(const uint8_t *p) {
+    return static_cast<uint16_t>(p[0] << 8 | p[1]);
+}
+
+const char ExifId[] = "Exif\0\0";
+const char XmpId[] = "http://ns.adobe.com/xap/1.0/";
+
+bool readJpeg(ByteSource &src, ExifTags &tags) {
+    tags = ExifTags();
+
+    const uint8_t *p = src.get(0, 2);
+    if (p == nullptr || p[0] != 0xFF || p[1] != 0xD8) return false;
+
+    bool exifRead = false, xmpRead = false, sofRead = false;
+    uint64_t pos = 2;
+
+    while (true) {
+        p = src.get(pos, 2);
+        if (p == nullptr || p[0] != 0xFF) return false;
+        uint8_t marker = p[1];
+        pos += 2;
+
+        // Fill bytes
+        while (marker == 0xFF) {
+            p = src.get(pos++, 1);
+            if (p == nullptr) return false;
+            marker = *p;
+        }
+
+        // Start of scan, end of image: there's no more metadata
+        if (marker == 0xDA || marker == 0xD9) break;
+
+        // Markers without a segment
+        if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) continue;
+
+        p = src.get(pos, 2);
+        if (p == nullptr) return false;
+        const uint16_t len = be16(p);
+        if (len < 2) return false;
+        const uint64_t payload = pos + 2;
+        const size_t payloadSize = len - 2u;
+
+        if (marker == 0xE1 && (!exifRead || !xmpRead)) {
+            p = src.get(payload, payloadSize);
+            if (p == nullptr) return false;
+
+            if (!exifRead && payloadSize >= 6 && memcmp(p, ExifId, 6) == 0) {
+                exifRead = true;
+                if (!readExif(p + 6, payloadSize - 6, tags)) return false;
+            } else if (!xmpRead && payloadSize >= sizeof(XmpId) && memcmp(p, XmpId, sizeof(XmpId)) == 0) {
+                xmpRead = true;
+                if (!readXmp(std::string_view(reinterpret_cast<const char *>(p) + sizeof(XmpId),
+                                              payloadSize - sizeof(XmpId)), tags)) return false;
+            }
+        } else if (isSof(marker) && !sofRead) {
+            p = src.get(payload, 5);
+            if (p == nullptr) return false;
+            tags.imageHeight = be16(p + 1);
+            tags.imageWidth = be16(p + 3);
+            sofRead = true;
+        }
+
+        pos = payload + payloadSize;
+    }
+
+    return sofRead;
+}
+
+}
+
+bool readJpegTags(const uint8_t *data, size_t size, ExifTags &tags) {
+    ByteSource src(data, size);
+    return readJpeg(src, tags);
+}
+
+bool readJpegTags(const fs::path &path, ExifTags &tags) {
+    ByteSource src(path);
+    return readJpeg(src, tags);
+}
+
+}
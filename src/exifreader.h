@@ -0,0 +1,108 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+#ifndef EXIFREADER_H
+#define EXIFREADER_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "fs.h"
+#include "ddb_export.h"
+
+namespace ddb {
+
+// Value of an EXIF or XMP tag. Conversions follow the
+// rules of the corresponding Exiv2 value types.
+struct ExifValue {
+    bool present = false;
+
+    // ASCII (EXIF) and text (XMP) values
+    std::string text;
+
+    // Numeric (EXIF) values, integers have a denominator of 1
+    std::vector<std::pair<int64_t, int64_t>> numbers;
+    bool rational = false;
+
+    explicit operator bool() const { return present; }
+
+    DDB_DLL size_t count() const;
+    DDB_DLL std::string toString() const;
+    DDB_DLL int64_t toInt64(size_t n = 0) const;
+    DDB_DLL float toFloat(size_t n = 0) const;
+    DDB_DLL std::pair<int32_t, int32_t> toRational(size_t n = 0) const;
+
+    DDB_DLL void setText(std::string t);
+    DDB_DLL void addNumber(int64_t num, int64_t den = 1);
+};
+
+// Tags used by ExifParser, each has a slot in ExifTags
+enum ExifTag {
+    // Exif.Image
+    ExifMake, ExifModel, ExifOrientation, ExifDateTime,
+
+    // Exif.Photo
+    ExifLensMake, ExifLensModel, ExifFocalLength, ExifFocalLengthIn35mmFilm,
+    ExifFocalPlaneXResolution, ExifFocalPlaneYResolution, ExifFocalPlaneResolutionUnit,
+    ExifDateTimeOriginal, ExifDateTimeDigitized,
+    ExifSubSecTime, ExifSubSecTimeOriginal, ExifSubSecTimeDigitized,
+
+    // Exif.GPSInfo
+    ExifGPSLatitude, ExifGPSLatitudeRef, ExifGPSLongitude, ExifGPSLongitudeRef,
+    ExifGPSAltitude, ExifGPSAltitudeRef,
+
+    // Xmp.drone-dji
+    XmpDjiAbsoluteAltitude, XmpDjiRelativeAltitude, XmpDjiLatitude, XmpDjiLongitude,
+    XmpDjiGimbalPitchDegree, XmpDjiGimbalYawDegree, XmpDjiGimbalRollDegree, XmpDjiFlightYawDegree,
+
+    // Xmp.Camera
+    XmpCameraPitch, XmpCameraYaw, XmpCameraRoll,
+
+    // Xmp.GPano
+    XmpGPanoProjectionType, XmpGPanoCroppedAreaImageWidthPixels, XmpGPanoCroppedAreaImageHeightPixels,
+    XmpGPanoCroppedAreaLeftPixels, XmpGPanoCroppedAreaTopPixels,
+    XmpGPanoPoseHeadingDegrees, XmpGPanoPosePitchDegrees, XmpGPanoPoseRollDegrees,
+
+    // Xmp.video
+    XmpVideoWidth, XmpVideoHeight, XmpVideoDateUTC, XmpVideoMediaCreateDate, XmpVideoGPSCoordinates,
+
+    ExifTagCount
+};
+
+// Find the tag of an Exiv2 key (e.g. "Exif.Image.Make")
+// @return false if the key is not used by ExifParser
+DDB_DLL bool findExifTag(std::string_view key, ExifTag &tag);
+
+// @return the Exiv2 key of a tag
+DDB_DLL const char *exifTagKey(ExifTag tag);
+
+// The tags used by ExifParser, decoded from an image
+struct ExifTags {
+    int imageWidth = 0;
+    int imageHeight = 0;
+    bool hasExif = false;
+    bool hasXmp = false;
+
+    std::array<ExifValue, ExifTagCount> values;
+
+    const ExifValue &operator[](ExifTag tag) const { return values[tag]; }
+    ExifValue &operator[](ExifTag tag) { return values[tag]; }
+};
+
+// Number of bytes read at once from the start of a file. The metadata
+// segments of a JPEG are usually all within this range.
+#define DDB_JPEG_HEADER_READ_SIZE (256 * 1024)
+
+// Read the tags of a JPEG directly from its APP1 (EXIF and XMP) and
+// SOF segments, without parsing the rest of the metadata.
+// @return false if the data is not a JPEG or uses encodings that are not
+// supported, in which case the image should be read with Exiv2 instead
+DDB_DLL bool readJpegTags(const uint8_t *data, size_t size, ExifTags &tags);
+DDB_DLL bool readJpegTags(const fs::path &path, ExifTags &tags);
+
+}
+
+#endif // EXIFREADER_H
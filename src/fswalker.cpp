@@ -0,0 +1,297 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <vector>
+#include "fswalker.h"
+#include "ddb.h"
+#include "exceptions.h"
+#include "logger.h"
+#include "threadpool.h"
+
+// Directory listings read ahead per walker thread
+#define WALK_READ_AHEAD 8
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#include <cerrno>
+#endif
+
+namespace ddb {
+
+namespace {
+
+struct DirEntry {
+    fs::path path;
+    bool directory;
+    bool link;
+    int depth;
+};
+
+// Lists the contents of a directory. On POSIX the entry type
+// comes from the directory listing itself and entries are only
+// stat'ed when the file system does not report it (or for symlinks)
+void readDirectory(const fs::path &dir, int depth, bool skipHidden, std::vector<DirEntry> &out) {
+#ifdef WIN32
+    try {
+        for (const auto &de : fs::directory_iterator(dir)) {
+            if (skipHidden) {
+                const DWORD attrs = GetFileAttributesW(de.path().wstring().c_str());
+                if (attrs & FILE_ATTRIBUTE_HIDDEN || attrs & FILE_ATTRIBUTE_SYSTEM) continue;
+            }
+
+            out.push_back({de.path(), de.is_directory(), de.is_symlink(), depth});
+        }
+    } catch (const fs::filesystem_error &e) {
+        throw FSException(e.what());
+    }
+#else
+    (void)skipHidden;
+
+    DIR *d = opendir(dir.c_str());
+    if (d == nullptr) {
+        throw FSException("Cannot open directory " + dir.string() + ": " + strerror(errno));
+    }
+
+    struct dirent *de;
+    while ((de = readdir(d)) != nullptr) {
+        const char *name = de->d_name;
+        if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) continue;
+
+        DirEntry e{dir / name, false, false, depth};
+        struct stat st;
+
+        switch (de->d_type) {
+            case DT_DIR:
+                e.directory = true;
+                break;
+            case DT_REG:
+                break;
+            case DT_LNK:
+                e.link = true;
+                e.directory = stat(e.path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+                break;
+            default:
+                // DT_UNKNOWN or special files
+                if (lstat(e.path.c_str(), &st) == 0) {
+                    if (S_ISLNK(st.st_mode)) {
+                        e.link = true;
+                        e.directory = stat(e.path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+                    } else {
+                        e.directory = S_ISDIR(st.st_mode);
+                    }
+                }
+                break;
+        }
+
+        out.push_back(std::move(e));
+    }
+
+    closedir(d);
+#endif
+}
+
+struct WalkOptions {
+    int maxDepth;
+    bool skipHidden;
+
+    bool descend(const DirEntry &e) const {
+        return e.directory && !e.link && e.path.filename() != DDB_FOLDER &&
+               (maxDepth <= 0 || e.depth + 1 < maxDepth);
+    }
+};
+
+// Sort the entries of a directory by name, so that
+// walks report them in the same order every time
+void sortEntries(std::vector<DirEntry> &entries) {
+    std::sort(entries.begin(), entries.end(), [](const DirEntry &a, const DirEntry &b) {
+        return a.path < b.path;
+    });
+}
+
+// Directory to be reported by a parallel walk,
+// possibly read ahead by one of the workers
+struct Listing {
+    fs::path dir;
+    int depth;
+    bool scheduled = false;
+
+    std::vector<DirEntry> entries;
+    bool ready = false;
+    std::exception_ptr error;
+
+    Listing(const fs::path &dir, int depth) : dir(dir), depth(depth) {}
+};
+
+// Shared between the workers of a parallel walk
+struct WalkState {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::atomic<bool> stop{false};
+};
+
+void scanDirectory(WalkState &s, const WalkOptions &opts, const std::shared_ptr<Listing> &listing) {
+    std::vector<DirEntry> entries;
+    std::exception_ptr error;
+
+    if (!s.stop) {
+        try {
+            readDirectory(listing->dir, listing->depth, opts.skipHidden, entries);
+            sortEntries(entries);
+        } catch (...) {
+            error = std::current_exception();
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(s.mutex);
+        listing->entries = std::move(entries);
+        listing->error = error;
+        listing->ready = true;
+    }
+    s.cv.notify_all();
+}
+
+}
+
+bool walkDirectory(const fs::path &root, const WalkCallback &cb, int maxDepth,
+                   int threads, bool skipHidden) {
+    const WalkOptions opts{maxDepth, skipHidden};
+
+    // Read the top level on this thread; small walks
+    // never need to start any worker
+    std::vector<DirEntry> entries;
+    readDirectory(root, 0, skipHidden, entries);
+    sortEntries(entries);
+
+    std::vector<const DirEntry *> subdirs;
+    for (const auto &e : entries) {
+        if (!cb(e.path, e.directory, e.depth)) return false;
+        if (opts.descend(e)) subdirs.push_back(&e);
+    }
+
+    if (subdirs.empty()) return true;
+
+    if (threads <= 0) threads = static_cast<int>(ThreadPool::defaultThreadCount());
+
+    if (threads == 1) {
+        std::vector<std::pair<fs::path, int>> stack;
+        for (auto it = subdirs.rbegin(); it != subdirs.rend(); it++) {
+            stack.emplace_back((*it)->path, (*it)->depth + 1);
+        }
+
+        while (!stack.empty()) {
+            const auto [dir, depth] = stack.back();
+            stack.pop_back();
+
+            entries.clear();
+            readDirectory(dir, depth, skipHidden, entries);
+            sortEntries(entries);
+
+            for (auto it = entries.rbegin(); it != entries.rend(); it++) {
+                if (opts.descend(*it)) stack.emplace_back(it->path, it->depth + 1);
+            }
+            for (const auto &e : entries) {
+                if (!cb(e.path, e.directory, e.depth)) return false;
+            }
+        }
+
+        return true;
+    }
+
+    // Workers read the next directories in walk order ahead of this thread,
+    // which reports them in the same depth-first order as the single threaded walk.
+    // Only WALK_READ_AHEAD listings per thread are held in memory at any time;
+    // directories further down the stack are just paths until they are scheduled.
+    // The pool is destroyed (and its workers joined) before the state
+    WalkState s;
+    ThreadPool pool(static_cast<size_t>(threads));
+    const size_t maxReadAhead = WALK_READ_AHEAD * static_cast<size_t>(threads);
+    size_t readAhead = 0;
+
+    std::vector<std::shared_ptr<Listing>> stack;
+    for (auto it = subdirs.rbegin(); it != subdirs.rend(); it++) {
+        stack.push_back(std::make_shared<Listing>((*it)->path, (*it)->depth + 1));
+    }
+
+    // Schedule the top of the stack (the listings reported next)
+    const auto scheduleNext = [&]() {
+        for (auto it = stack.rbegin(); it != stack.rend() && readAhead < maxReadAhead &&
+                                       it - stack.rbegin() < static_cast<std::ptrdiff_t>(maxReadAhead); it++) {
+            if ((*it)->scheduled) continue;
+
+            (*it)->scheduled = true;
+            readAhead++;
+            pool.submit([&s, &opts, l = *it]() {
+                scanDirectory(s, opts, l);
+            });
+        }
+    };
+
+    try {
+        while (!stack.empty()) {
+            scheduleNext();
+
+            const auto listing = std::move(stack.back());
+            stack.pop_back();
+
+            if (listing->scheduled) {
+                std::unique_lock<std::mutex> lock(s.mutex);
+                s.cv.wait(lock, [&listing] { return listing->ready; });
+                readAhead--;
+            } else {
+                // Every slot is taken by listings reported later
+                scanDirectory(s, opts, listing);
+            }
+            if (listing->error) std::rethrow_exception(listing->error);
+
+            for (auto it = listing->entries.rbegin(); it != listing->entries.rend(); it++) {
+                if (opts.descend(*it)) stack.push_back(std::make_shared<Listing>(it->path, it->depth + 1));
+            }
+            for (const auto &e : listing->entries) {
+                if (!cb(e.path, e.directory, e.depth)) {
+                    s.stop = true;
+                    return false;
+                }
+            }
+        }
+    } catch (...) {
+        s.stop = true;
+        throw;
+    }
+
+    return true;
+}
+
+bool PathTrie::insert(const fs::path &p) {
+    Node *n = &root;
+    for (const auto &c : p) {
+        auto &child = n->children[c.string()];
+        if (!child) child = std::make_unique<Node>();
+        n = child.get();
+    }
+
+    if (n->member) return false;
+    n->member = true;
+    return true;
+}
+
+bool PathTrie::contains(const fs::path &p) const {
+    const Node *n = &root;
+    for (const auto &c : p) {
+        const auto it = n->children.find(c.string());
+        if (it == n->children.end()) return false;
+        n = it->second.get();
+    }
+
+    return n->member;
+}
+
+}
@@ -0,0 +1,52 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+#ifndef FSWALKER_H
+#define FSWALKER_H
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include "fs.h"
+#include "ddb_export.h"
+
+namespace ddb {
+
+// Called for each path found while walking a directory.
+// depth is 0 for the direct children of the walked directory.
+// @return false to stop walking
+typedef std::function<bool(const fs::path &path, bool isDirectory, int depth)> WalkCallback;
+
+// Recursively walks a directory, reporting files and folders to the callback.
+// Entry types are taken from the directory listing (d_type) whenever the file
+// system provides them, so most entries are never stat'ed. Subdirectories are
+// read ahead in parallel (a bounded number at a time, so memory does not grow
+// with the size of the tree), but the callback is always invoked from the calling thread.
+// Symlinks to directories and .ddb folders are reported, but not descended into.
+// The contents of a directory are reported sorted by name, followed depth first
+// by those of its subdirectories. The order does not depend on the number of threads.
+// @param maxDepth number of levels to report (0 = unlimited)
+// @param threads number of threads used to read directories (0 = one per core)
+// @param skipHidden skip hidden and system files (Windows only)
+// @return false if the walk was stopped by the callback
+DDB_DLL bool walkDirectory(const fs::path &root, const WalkCallback &cb, int maxDepth = 0,
+                           int threads = 0, bool skipHidden = false);
+
+// Set of paths, stored as a tree of path components
+// so that paths sharing a parent share storage
+class PathTrie {
+    struct Node {
+        std::unordered_map<std::string, std::unique_ptr<Node>> children;
+        bool member = false;
+    };
+    Node root;
+public:
+    // @return true if the path was not already in the set
+    DDB_DLL bool insert(const fs::path &p);
+    DDB_DLL bool contains(const fs::path &p) const;
+};
+
+}
+
+#endif // FSWALKER_H
@@ -3,7 +3,9 @@
  * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
 #include "gdal_inc.h"
 
+#include <algorithm>
 #include <sstream>
+#include <vector>
 #include "geo.h"
 
 namespace ddb {
@@ -68,30 +70,69 @@ std::string getProjForUTM(const UTMZone &zone){
     return ss.str();
 }
 
-Projected2D toUTM(double latitude, double longitude, const UTMZone &zone) {
-    Projected2D result;
+namespace {
+
+// Transformation from WGS84 to a UTM zone, or from the zone to WGS84
+class UTMTransform {
+    OGRSpatialReferenceH hSrs;
+    OGRSpatialReferenceH hWgs84;
+    OGRCoordinateTransformationH hTransform = nullptr;
+
+public:
+    UTMTransform(const UTMZone &zone, bool inverse) {
+        hSrs = OSRNewSpatialReference(nullptr);
+        hWgs84 = OSRNewSpatialReference(nullptr);
+
+        std::string proj = getProjForUTM(zone);
+        if (OSRImportFromProj4(hSrs, proj.c_str()) != OGRERR_NONE){
+            OSRDestroySpatialReference(hWgs84);
+            OSRDestroySpatialReference(hSrs);
+            throw GDALException("Cannot import spatial reference system " + proj + ". Is PROJ available?");
+        }
+        OSRImportFromEPSG(hWgs84, 4326);
+        hTransform = inverse ? OCTNewCoordinateTransformation(hSrs, hWgs84) :
+                               OCTNewCoordinateTransformation(hWgs84, hSrs);
+    }
 
-    OGRSpatialReferenceH hSrs = OSRNewSpatialReference(nullptr);
-    OGRSpatialReferenceH hWgs84 = OSRNewSpatialReference(nullptr);
+    ~UTMTransform() {
+        if (hTransform) OCTDestroyCoordinateTransformation(hTransform);
+        OSRDestroySpatialReference(hWgs84);
+        OSRDestroySpatialReference(hSrs);
+    }
+
+    UTMTransform(const UTMTransform &) = delete;
+    UTMTransform &operator=(const UTMTransform &) = delete;
 
-    std::string proj = getProjForUTM(zone);
-    if (OSRImportFromProj4(hSrs, proj.c_str()) != OGRERR_NONE){
-        throw GDALException("Cannot import spatial reference system " + proj + ". Is PROJ available?");
+    // Transform points in place (x is latitude for WGS84 coordinates)
+    // @return true if all points were transformed
+    bool transform(size_t count, double *x, double *y) {
+        if (!hTransform) return false;
+        std::vector<int> success(count, 0);
+        OCTTransformEx(hTransform, static_cast<int>(count), x, y, nullptr, success.data());
+        return std::all_of(success.begin(), success.end(), [](int s){ return s != 0; });
     }
-    OSRImportFromEPSG(hWgs84, 4326);
-    OGRCoordinateTransformationH hTransform = OCTNewCoordinateTransformation(hWgs84, hSrs);
+};
+
+}
 
+Projected2D toUTM(double latitude, double longitude, const UTMZone &zone) {
     double geoX = latitude;
     double geoY = longitude;
-    if (OCTTransform(hTransform, 1, &geoX, &geoY, nullptr)){
-        OCTDestroyCoordinateTransformation(hTransform);
-        OSRDestroySpatialReference(hWgs84);
-        OSRDestroySpatialReference(hSrs);
-
-        return Projected2D(geoX, geoY);
-    }else{
+    if (!UTMTransform(zone, false).transform(1, &geoX, &geoY)){
         throw GDALException("Cannot transform coordinates to UTM " + std::to_string(latitude) + "," + std::to_string(longitude));
     }
+
+    return Projected2D(geoX, geoY);
+}
+
+void toUTM(const double *latitudes, const double *longitudes, size_t count, const UTMZone &zone, double *x, double *y) {
+    if (count == 0) return;
+    if (x != latitudes) std::copy(latitudes, latitudes + count, x);
+    if (y != longitudes) std::copy(longitudes, longitudes + count, y);
+
+    if (!UTMTransform(zone, false).transform(count, x, y)){
+        throw GDALException("Cannot transform " + std::to_string(count) + " coordinates to UTM");
+    }
 }
 
 Geographic2D fromUTM(const Projected2D &p, const UTMZone &zone) {
@@ -99,27 +140,23 @@ Geographic2D fromUTM(const Projected2D &p, const UTMZone &zone) {
 }
 
 Geographic2D fromUTM(double x, double y, const UTMZone &zone) {
-    OGRSpatialReferenceH hSrs = OSRNewSpatialReference(nullptr);
-    OGRSpatialReferenceH hWgs84 = OSRNewSpatialReference(nullptr);
-
-    std::string proj = getProjForUTM(zone);
-    if (OSRImportFromProj4(hSrs, proj.c_str()) != OGRERR_NONE){
-        throw GDALException("Cannot import spatial reference system " + proj + ". Is PROJ available?");
-    }
-    OSRImportFromEPSG(hWgs84, 4326);
-    OGRCoordinateTransformationH hTransform = OCTNewCoordinateTransformation(hSrs, hWgs84);
-
     double geoX = x;
     double geoY = y;
-    if (OCTTransform(hTransform, 1, &geoX, &geoY, nullptr)){
-        OCTDestroyCoordinateTransformation(hTransform);
-        OSRDestroySpatialReference(hWgs84);
-        OSRDestroySpatialReference(hSrs);
-
-        return Geographic2D(geoY, geoX);
-    }else{
+    if (!UTMTransform(zone, true).transform(1, &geoX, &geoY)){
         throw GDALException("Cannot transform coordinates to UTM " + std::to_string(x) + "," + std::to_string(y));
     }
+
+    return Geographic2D(geoY, geoX);
+}
+
+void fromUTM(const double *x, const double *y, size_t count, const UTMZone &zone, double *latitudes, double *longitudes) {
+    if (count == 0) return;
+    if (latitudes != x) std::copy(x, x + count, latitudes);
+    if (longitudes != y) std::copy(y, y + count, longitudes);
+
+    if (!UTMTransform(zone, true).transform(count, latitudes, longitudes)){
+        throw GDALException("Cannot transform " + std::to_string(count) + " coordinates from UTM");
+    }
 }
 
 }
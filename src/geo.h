@@ -102,6 +102,11 @@ DDB_DLL Projected2D toUTM(double latitude, double longitude, const UTMZone &zone
 DDB_DLL Geographic2D fromUTM(const Projected2D &p, const UTMZone &zone);
 DDB_DLL Geographic2D fromUTM(double x, double y, const UTMZone &zone);
 
+// Convert many coordinates at once, with a single transformation.
+// The output arrays can be the same as the input arrays
+DDB_DLL void toUTM(const double *latitudes, const double *longitudes, size_t count, const UTMZone &zone, double *x, double *y);
+DDB_DLL void fromUTM(const double *x, const double *y, size_t count, const UTMZone &zone, double *latitudes, double *longitudes);
+
 
 }
 
@@ -2,39 +2,337 @@
  * License, v. 2.0. If a copy of the MPL was not distributed with this
  * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
 #include <sstream>
+#include <memory>
+#include <cstring>
+#include <cerrno>
 #include "hash.h"
 #include "exceptions.h"
+#include "threadpool.h"
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define DDB_HAVE_SHA_NI
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
 
 using namespace ddb;
 
+namespace{
+
+const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+// Process a number of 64 byte blocks
+typedef void (*CompressFn)(uint32_t state[8], const uint8_t *data, size_t blocks);
+
+inline uint32_t rotr(uint32_t x, int n){
+    return (x >> n) | (x << (32 - n));
+}
+
+void compressPortable(uint32_t state[8], const uint8_t *data, size_t blocks){
+    uint32_t w[64];
+
+    while (blocks--){
+        for (int i = 0; i < 16; i++){
+            w[i] = (uint32_t(data[i * 4]) << 24) | (uint32_t(data[i * 4 + 1]) << 16) |
+                   (uint32_t(data[i * 4 + 2]) << 8) | uint32_t(data[i * 4 + 3]);
+        }
+        for (int i = 16; i < 64; i++){
+            const uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            const uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3],
+                 e = state[4], f = state[5], g = state[6], h = state[7];
+
+        for (int i = 0; i < 64; i++){
+            const uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) +
+                                ((e & f) ^ (~e & g)) + K[i] + w[i];
+            const uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) +
+                                ((a & b) ^ (a & c) ^ (b & c));
+            h = g; g = f; f = e; e = d + t1;
+            d = c; c = b; b = a; a = t1 + t2;
+        }
+
+        state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+        state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+
+        data += 64;
+    }
+}
+
+#ifdef DDB_HAVE_SHA_NI
+
+// Intel SHA extensions kernel, 4 rounds per iteration
+__attribute__((target("sha,sse4.1,ssse3")))
+void compressShaNi(uint32_t state[8], const uint8_t *data, size_t blocks){
+    const __m128i MASK = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+    // Load state as ABEF / CDGH
+    __m128i tmp = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&state[0]));
+    __m128i state1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&state[4]));
+    tmp = _mm_shuffle_epi32(tmp, 0xB1);
+    state1 = _mm_shuffle_epi32(state1, 0x1B);
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+
+    __m128i w[4];
+
+    while (blocks--){
+        const __m128i abefSave = state0;
+        const __m128i cdghSave = state1;
+
+        for (int i = 0; i < 16; i++){
+            __m128i m;
+            if (i < 4){
+                m = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i * 16)), MASK);
+            }else{
+                // w[i & 3] = W(i-4), w[(i+1) & 3] = W(i-3), w[(i+2) & 3] = W(i-2), w[(i+3) & 3] = W(i-1)
+                m = _mm_sha256msg1_epu32(w[i & 3], w[(i + 1) & 3]);
+                m = _mm_add_epi32(m, _mm_alignr_epi8(w[(i + 3) & 3], w[(i + 2) & 3], 4));
+                m = _mm_sha256msg2_epu32(m, w[(i + 3) & 3]);
+            }
+            w[i & 3] = m;
+
+            __m128i msg = _mm_add_epi32(m, _mm_loadu_si128(reinterpret_cast<const __m128i *>(&K[i * 4])));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+            msg = _mm_shuffle_epi32(msg, 0x0E);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+        }
+
+        state0 = _mm_add_epi32(state0, abefSave);
+        state1 = _mm_add_epi32(state1, cdghSave);
+
+        data += 64;
+    }
+
+    // Store back as ABCD / EFGH
+    tmp = _mm_shuffle_epi32(state0, 0x1B);
+    state1 = _mm_shuffle_epi32(state1, 0xB1);
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0);
+    state1 = _mm_alignr_epi8(state1, tmp, 8);
+
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(&state[0]), state0);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(&state[4]), state1);
+}
+
+bool cpuHasShaNi(){
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return false;
+    const bool ssse3 = (ecx & (1u << 9)) != 0;
+    const bool sse41 = (ecx & (1u << 19)) != 0;
+
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) return false;
+    const bool sha = (ebx & (1u << 29)) != 0;
+
+    return ssse3 && sse41 && sha;
+}
+
+#endif
+
+struct Kernel{
+    CompressFn compress;
+    const char *name;
+};
+
+const Kernel &selectKernel(){
+    static const Kernel kernel = [](){
+#ifdef DDB_HAVE_SHA_NI
+        if (cpuHasShaNi()) return Kernel{compressShaNi, "sha-ni"};
+#endif
+        return Kernel{compressPortable, "portable"};
+    }();
+    return kernel;
+}
+
+// Streaming SHA256 context using the best kernel
+// available on this CPU. Produces the same digests as the
+// vendor SHA256 class.
+class Sha256{
+    uint32_t state[8];
+    uint8_t buffer[64];
+    size_t bufferLen;
+    uint64_t totalBytes;
+    CompressFn compress;
+public:
+    Sha256() : state{0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                     0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19},
+               bufferLen(0), totalBytes(0), compress(selectKernel().compress){}
+
+    void add(const void *data, size_t numBytes){
+        const uint8_t *p = static_cast<const uint8_t *>(data);
+        totalBytes += numBytes;
+
+        if (bufferLen > 0){
+            const size_t n = std::min(numBytes, sizeof(buffer) - bufferLen);
+            memcpy(buffer + bufferLen, p, n);
+            bufferLen += n;
+            p += n;
+            numBytes -= n;
+
+            if (bufferLen < sizeof(buffer)) return;
+            compress(state, buffer, 1);
+            bufferLen = 0;
+        }
+
+        const size_t blocks = numBytes / 64;
+        if (blocks > 0){
+            compress(state, p, blocks);
+            p += blocks * 64;
+            numBytes -= blocks * 64;
+        }
+
+        if (numBytes > 0){
+            memcpy(buffer, p, numBytes);
+            bufferLen = numBytes;
+        }
+    }
+
+    std::string getHash(){
+        const uint64_t bits = totalBytes * 8;
+
+        uint8_t padding[128] = {0x80};
+        const size_t padLen = (bufferLen < 56 ? 56 : 120) - bufferLen;
+        for (int i = 0; i < 8; i++){
+            padding[padLen + i] = uint8_t(bits >> (56 - i * 8));
+        }
+        add(padding, padLen + 8);
+
+        static const char hexDigits[] = "0123456789abcdef";
+        std::string result(64, '0');
+        for (int i = 0; i < 8; i++){
+            for (int j = 0; j < 8; j++){
+                result[i * 8 + j] = hexDigits[(state[i] >> (28 - j * 4)) & 0xf];
+            }
+        }
+        return result;
+    }
+};
+
+}
+
 std::string Hash::fileSHA256(const std::string &path) {
+    const size_t BufferSize = 4 * 1024 * 1024;
+    Sha256 digestSha2;
+
+#ifndef WIN32
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        throw FSException("Cannot open " + path + " for hashing");
+    }
+
+    // Small files don't need a large buffer
+    size_t bufSize = BufferSize;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size >= 0){
+        bufSize = std::max<size_t>(std::min<size_t>(static_cast<size_t>(st.st_size) + 1, BufferSize), 4096);
+    }
+
+#if defined(POSIX_FADV_SEQUENTIAL)
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#elif defined(F_RDAHEAD)
+    fcntl(fd, F_RDAHEAD, 1);
+#endif
+
+    std::unique_ptr<uint8_t[]> buffer(new uint8_t[bufSize]);
+    off_t offset = 0;
+
+    while (true) {
+        const ssize_t numBytesRead = pread(fd, buffer.get(), bufSize, offset);
+        if (numBytesRead < 0) {
+            if (errno == EINTR) continue;
+            close(fd);
+            throw FSException("Cannot read " + path + " for hashing");
+        }
+        if (numBytesRead == 0) break;
+
+        offset += numBytesRead;
+
+#if defined(POSIX_FADV_WILLNEED)
+        // Start fetching the next block while we hash this one
+        posix_fadvise(fd, offset, static_cast<off_t>(bufSize), POSIX_FADV_WILLNEED);
+#endif
+
+        digestSha2.add(buffer.get(), static_cast<size_t>(numBytesRead));
+    }
+
+    close(fd);
+#else
     std::ifstream f(path, std::ios::binary);
     if (!f.is_open()) {
         throw FSException("Cannot open " + path + " for hashing");
     }
 
-    const size_t BufferSize = 144*7*1024;
-    char* buffer = new char[BufferSize];
-    SHA256 digestSha2;
+    std::unique_ptr<char[]> buffer(new char[BufferSize]);
 
     while (f) {
-        f.read(buffer, BufferSize);
+        f.read(buffer.get(), BufferSize);
         size_t numBytesRead = size_t(f.gcount());
-        digestSha2.add(buffer, numBytesRead);
+        digestSha2.add(buffer.get(), numBytesRead);
     }
 
     f.close();
-    delete[] buffer;
+#endif
 
     return digestSha2.getHash();
 }
 
+std::vector<std::string> Hash::filesSHA256(const std::vector<std::string> &paths, int threads){
+    std::vector<std::string> result;
+    result.reserve(paths.size());
+
+    size_t numThreads = threads <= 0 ? ThreadPool::defaultThreadCount() : static_cast<size_t>(threads);
+    numThreads = std::min(numThreads, paths.size());
+
+    if (numThreads <= 1){
+        for (const auto &p : paths) result.push_back(Hash::fileSHA256(p));
+        return result;
+    }
+
+    ThreadPool pool(numThreads);
+    std::vector<std::future<std::string>> futures;
+    futures.reserve(paths.size());
+
+    for (const auto &p : paths){
+        futures.push_back(pool.submit([&p](){ return Hash::fileSHA256(p); }));
+    }
+
+    for (auto &f : futures) result.push_back(f.get());
+
+    return result;
+}
+
+std::string Hash::sha256Implementation(){
+    return selectKernel().name;
+}
+
 std::string Hash::strSHA256(const std::string &str){
-    SHA256 digestSha2;
+    Sha256 digestSha2;
     digestSha2.add(str.c_str(), str.length());
     return digestSha2.getHash();
 }
 
+std::string Hash::dataSHA256(const void *data, size_t size){
+    Sha256 digestSha2;
+    digestSha2.add(data, size);
+    return digestSha2.getHash();
+}
+
 std::string Hash::strCRC64(const std::string &str){
     return Hash::strCRC64(str.c_str(), str.length());
 }
@@ -53,5 +351,3 @@ std::string Hash::strCRC64(const char *str, uint64_t size){
 
     return os.str();
 }
-
-
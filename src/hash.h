@@ -7,6 +7,7 @@
 
 #include <string>
 #include <fstream>
+#include <vector>
 #include "ddb_export.h"
 #include "../vendor/hash-library/sha256.h"
 
@@ -144,7 +145,15 @@ static const uint64_t crc64_table[256] = {
 class Hash{
 public:
     DDB_DLL static std::string fileSHA256(const std::string &path);
+
+    // Hash multiple files in parallel. Digests are returned in the same
+    // order as paths. @param threads number of threads (0 = one per core)
+    DDB_DLL static std::vector<std::string> filesSHA256(const std::vector<std::string> &paths, int threads = 0);
+
+    // Name of the SHA256 kernel selected for this CPU (e.g. "sha-ni", "portable")
+    DDB_DLL static std::string sha256Implementation();
     DDB_DLL static std::string strSHA256(const std::string &str);
+    DDB_DLL static std::string dataSHA256(const void *data, size_t size);
 
     DDB_DLL static std::string strCRC64(const std::string &str);
     DDB_DLL static std::string strCRC64(const char *str, uint64_t size);
@@ -0,0 +1,130 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+#include <sys/stat.h>
+#include "hashcache.h"
+#include "database.h"
+#include "hash.h"
+#include "logger.h"
+
+namespace ddb {
+
+bool FileStamp::of(const fs::path &p, FileStamp &stamp){
+#ifdef WIN32
+    // No inodes in the standard library, use the
+    // absolute path in their place
+    std::error_code ec;
+    const auto size = fs::file_size(p, ec);
+    if (ec) return false;
+    const auto mtime = fs::last_write_time(p, ec);
+    if (ec) return false;
+
+    stamp.dev = 0;
+    stamp.inode = static_cast<long long>(std::hash<std::string>{}(fs::absolute(p).string()));
+    stamp.size = static_cast<long long>(size);
+    stamp.mtimeNs = static_cast<long long>(mtime.time_since_epoch().count());
+#else
+    struct stat st;
+    if (stat(p.string().c_str(), &st) != 0) return false;
+
+    stamp.dev = static_cast<long long>(st.st_dev);
+    stamp.inode = static_cast<long long>(st.st_ino);
+    stamp.size = static_cast<long long>(st.st_size);
+#ifdef __APPLE__
+    stamp.mtimeNs = static_cast<long long>(st.st_mtimespec.tv_sec) * 1000000000LL + st.st_mtimespec.tv_nsec;
+#else
+    stamp.mtimeNs = static_cast<long long>(st.st_mtim.tv_sec) * 1000000000LL + st.st_mtim.tv_nsec;
+#endif
+#endif
+    return true;
+}
+
+std::string HashCache::fileSHA256(const fs::path &p, bool update){
+    // Stat before hashing: if the file is modified while we read it,
+    // the stored stamp will not match on the next lookup
+    FileStamp stamp;
+    if (!FileStamp::of(p, stamp)) return Hash::fileSHA256(p.string());
+
+    std::string hash;
+    if (lookup(stamp, hash)) return hash;
+
+    hash = Hash::fileSHA256(p.string());
+    if (update) store(stamp, hash);
+    return hash;
+}
+
+bool HashCache::lookup(const FileStamp &stamp, std::string &hash){
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+
+        auto q = db->query("SELECT size, mtime_ns, hash FROM hash_cache WHERE dev = ? AND inode = ?");
+        q->bind(1, stamp.dev);
+        q->bind(2, stamp.inode);
+
+        if (q->fetch() && q->getInt64(0) == stamp.size &&
+                          q->getInt64(1) == stamp.mtimeNs){
+            hash = q->getText(2);
+            cacheHits++;
+            return true;
+        }
+    }
+
+    cacheMisses++;
+    return false;
+}
+
+void HashCache::store(const FileStamp &stamp, const std::string &hash){
+    std::lock_guard<std::mutex> guard(mutex);
+
+    // Replaced rows get a new rowid, which keeps
+    // rowids in the order entries were last stored
+    auto q = db->query("INSERT OR REPLACE INTO hash_cache (dev, inode, size, mtime_ns, hash) VALUES (?, ?, ?, ?, ?)");
+    q->bind(1, stamp.dev);
+    q->bind(2, stamp.inode);
+    q->bind(3, stamp.size);
+    q->bind(4, stamp.mtimeNs);
+    q->bind(5, hash);
+    q->execute();
+}
+
+void HashCache::clear(){
+    std::lock_guard<std::mutex> guard(mutex);
+    db->exec("DELETE FROM hash_cache");
+    LOGD << "Cleared hash cache";
+}
+
+void HashCache::prune(unsigned long long maxEntries){
+    std::lock_guard<std::mutex> guard(mutex);
+
+    if (maxEntries == 0){
+        db->exec("DELETE FROM hash_cache");
+        return;
+    }
+
+    auto q = db->query("DELETE FROM hash_cache WHERE rowid < "
+                       "(SELECT rowid FROM hash_cache ORDER BY rowid DESC LIMIT 1 OFFSET ?)");
+    q->bind(1, static_cast<long long>(maxEntries - 1));
+    q->execute();
+
+    const auto pruned = db->changes();
+    if (pruned > 0) LOGD << "Pruned " << pruned << " hash cache entries";
+}
+
+void HashCache::prune(){
+    prune(static_cast<unsigned long long>(db->getSummary().entries) + HASH_CACHE_EXTRA_ENTRIES);
+}
+
+unsigned long long HashCache::hits() const{
+    return cacheHits;
+}
+
+unsigned long long HashCache::misses() const{
+    return cacheMisses;
+}
+
+void HashCache::resetCounters(){
+    cacheHits = 0;
+    cacheMisses = 0;
+}
+
+}
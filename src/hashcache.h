@@ -0,0 +1,70 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+#ifndef HASHCACHE_H
+#define HASHCACHE_H
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include "fs.h"
+#include "ddb_export.h"
+
+#define HASH_CACHE_EXTRA_ENTRIES 10000
+
+namespace ddb {
+
+class Database;
+
+// Identity of a file on disk. If any of these
+// values change, the file content might have changed.
+struct FileStamp {
+    long long dev = 0;
+    long long inode = 0;
+    long long size = 0;
+    long long mtimeNs = 0;
+
+    // Stat a file, returns false if it cannot be stat'ed
+    DDB_DLL static bool of(const fs::path &p, FileStamp &stamp);
+};
+
+// Persistent cache of SHA256 hashes, stored in the index
+// and keyed by file identity (device, inode, size, mtime)
+// so that files which have not changed are never read again.
+// ctime is not part of the key: renames update it, and moving
+// a file within the same device should not trigger a rehash.
+// Safe to use from multiple threads.
+class HashCache {
+    Database *db;
+    std::mutex mutex;
+
+    std::atomic<unsigned long long> cacheHits;
+    std::atomic<unsigned long long> cacheMisses;
+public:
+    HashCache(Database *db) : db(db), cacheHits(0), cacheMisses(0) {}
+
+    // SHA256 of a file, read from the cache if the file has not changed.
+    // When update is false, newly computed hashes are not stored
+    // (for read only operations such as status)
+    DDB_DLL std::string fileSHA256(const fs::path &p, bool update = true);
+
+    DDB_DLL bool lookup(const FileStamp &stamp, std::string &hash);
+    DDB_DLL void store(const FileStamp &stamp, const std::string &hash);
+    DDB_DLL void clear();
+
+    // Evict the least recently stored entries so that
+    // at most maxEntries are left
+    DDB_DLL void prune(unsigned long long maxEntries);
+
+    // Evict entries beyond what the index can use
+    // (one per entry plus some room for files not yet added)
+    DDB_DLL void prune();
+
+    DDB_DLL unsigned long long hits() const;
+    DDB_DLL unsigned long long misses() const;
+    DDB_DLL void resetCounters();
+};
+
+}
+
+#endif // HASHCACHE_H
@@ -0,0 +1,115 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+#include <fstream>
+#include "parsecontext.h"
+#include "exceptions.h"
+#include "hash.h"
+#include "logger.h"
+#include "mio.h"
+
+namespace ddb {
+
+ParseContext::ParseContext(const fs::path &path) : path(path) {}
+
+ParseContext::~ParseContext() {
+    if (dataset != nullptr) {
+        GDALClose(dataset);
+        dataset = nullptr;
+    }
+}
+
+const fs::path &ParseContext::getPath() const {
+    return path;
+}
+
+// Read the file in memory if it's a (small) file we will parse with Exiv2
+// @return true if the contents are available
+bool ParseContext::loadContents() {
+    if (contentsLoaded) return !contents.empty();
+    contentsLoaded = true;
+
+    io::Path p(path);
+    if (!p.checkExtension({"jpg", "jpeg", "dng", "tif", "tiff", "png", "gif", "mp4", "mov"})) return false;
+
+    std::error_code ec;
+    const auto size = fs::file_size(path, ec);
+    if (ec || size == 0 || size > DDB_PARSE_BUFFER_MAX_SIZE) return false;
+
+    std::ifstream f(path, std::ios::binary);
+    if (!f.is_open()) return false;
+
+    contents.resize(static_cast<size_t>(size));
+    f.read(reinterpret_cast<char *>(contents.data()), static_cast<std::streamsize>(size));
+    if (static_cast<uintmax_t>(f.gcount()) != size) {
+        LOGD << "Short read on " << path.string() << ", file changed while reading?";
+        contents.clear();
+        contents.shrink_to_fit();
+        return false;
+    }
+
+    return true;
+}
+
+std::string ParseContext::sha256() {
+    if (loadContents()) return Hash::dataSHA256(contents.data(), contents.size());
+    return Hash::fileSHA256(path.string());
+}
+
+Exiv2::Image *ParseContext::getImage() {
+    if (imageOpened) return image.get();
+    imageOpened = true;
+
+    try {
+        auto img = contentsLoaded && !contents.empty() ?
+                       Exiv2::ImageFactory::open(contents.data(), static_cast<long>(contents.size())) :
+                       Exiv2::ImageFactory::open(path.string());
+        if (!img.get()) {
+            LOGD << "Cannot open " << path.string();
+            return nullptr;
+        }
+
+        img->readMetadata();
+        image.reset(img.release());
+    } catch (Exiv2::Error &) {
+        LOGD << "Cannot read EXIF data: " << path.string();
+        image.reset();
+    }
+
+    return image.get();
+}
+
+ExifParser *ParseContext::getExifParser() {
+    if (exifParsed) return exifParser.get();
+    exifParsed = true;
+
+    if (io::Path(path).checkExtension({"jpg", "jpeg"})) {
+        ExifTags tags;
+        const bool read = contentsLoaded && !contents.empty() ?
+                              readJpegTags(contents.data(), contents.size(), tags) :
+                              readJpegTags(path, tags);
+        if (read) {
+            exifParser = std::make_unique<ExifParser>(tags);
+            return exifParser.get();
+        }
+
+        LOGD << "Falling back to Exiv2 for " << path.string();
+    }
+
+    Exiv2::Image *img = getImage();
+    if (img != nullptr) exifParser = std::make_unique<ExifParser>(img);
+
+    return exifParser.get();
+}
+
+GDALDatasetH ParseContext::getDataset() {
+    if (datasetOpened) return dataset;
+    datasetOpened = true;
+
+    dataset = GDALOpen(path.string().c_str(), GA_ReadOnly);
+    if (dataset == nullptr) LOGD << "Cannot open " << path.string() << " with GDAL";
+
+    return dataset;
+}
+
+}
@@ -0,0 +1,70 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+#ifndef PARSECONTEXT_H
+#define PARSECONTEXT_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <exiv2/exiv2.hpp>
+#include "gdal_inc.h"
+#include "exif.h"
+#include "fs.h"
+#include "ddb_export.h"
+
+namespace ddb {
+
+// Files up to this size are read into memory once
+// and shared between hashing and metadata extraction
+#define DDB_PARSE_BUFFER_MAX_SIZE (64 * 1024 * 1024)
+
+// Holds the resources opened while parsing a file (Exiv2 image,
+// GDAL dataset, file contents), so that fingerprint() and parseEntry()
+// open each file only once. Resources are opened lazily on first use.
+class ParseContext {
+    fs::path path;
+
+    std::vector<uint8_t> contents;
+    bool contentsLoaded = false;
+
+    std::unique_ptr<Exiv2::Image> image;
+    bool imageOpened = false;
+
+    std::unique_ptr<ExifParser> exifParser;
+    bool exifParsed = false;
+
+    GDALDatasetH dataset = nullptr;
+    bool datasetOpened = false;
+
+    bool loadContents();
+public:
+    DDB_DLL ParseContext(const fs::path &path);
+    DDB_DLL ~ParseContext();
+
+    ParseContext(const ParseContext &) = delete;
+    ParseContext &operator=(const ParseContext &) = delete;
+
+    DDB_DLL const fs::path &getPath() const;
+
+    // SHA256 of the file. Small image/video files are read into memory
+    // and the same bytes are later used to parse their metadata.
+    DDB_DLL std::string sha256();
+
+    // Exiv2 image with metadata already read, or nullptr if the file
+    // cannot be read by Exiv2
+    DDB_DLL Exiv2::Image *getImage();
+
+    // Metadata of the image or video, or nullptr if the file cannot be read.
+    // JPEGs are read with readJpegTags, other files (and JPEGs it
+    // cannot read) with Exiv2.
+    DDB_DLL ExifParser *getExifParser();
+
+    // GDAL dataset opened read-only, or nullptr if the
+    // file cannot be opened by GDAL
+    DDB_DLL GDALDatasetH getDataset();
+};
+
+}
+
+#endif // PARSECONTEXT_H
@@ -0,0 +1,80 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+#include "pathquery.h"
+#include "utils.h"
+
+namespace ddb {
+
+int PathCondition::bind(Statement *q, int i) const {
+    for (const auto &p : params) q->bind(i++, p);
+    return i;
+}
+
+std::string sanitize_query_param(const std::string &str) {
+    std::string res(str);
+
+    // TAKES INTO ACCOUNT PATHS THAT CONTAINS EVERY SORT OF STUFF
+    utils::stringReplace(res, "/", "//");
+    utils::stringReplace(res, "%", "/%");
+    //utils::stringReplace(res, "_", "/_");
+    utils::stringReplace(res, "*", "%");
+
+    return res;
+}
+
+std::string prefixUpperBound(const std::string &prefix) {
+    std::string res(prefix);
+
+    // Strings are compared bytewise (BINARY collation)
+    while (!res.empty()) {
+        auto &c = reinterpret_cast<unsigned char &>(res.back());
+        if (c < 0xFF) {
+            c++;
+            return res;
+        }
+        res.pop_back();
+    }
+
+    return res;
+}
+
+PathCondition folderCondition(const std::string &folder, const std::string &column) {
+    // '0' is the character that follows '/'
+    return { "(" + column + " >= ? AND " + column + " < ?)", { folder + "/", folder + "0" } };
+}
+
+PathCondition patternCondition(const std::string &pattern, const std::string &column) {
+    auto sanitized = sanitize_query_param(pattern);
+    if (sanitized.length() == 0) sanitized = "%";
+
+    // Literal part of the pattern, up to the first wildcard.
+    // LIKE folds ASCII only, same as SQLite's lower()
+    std::string prefix;
+    bool exact = true;
+    for (const char c : pattern) {
+        if (c == '*' || c == '_') {
+            exact = false;
+            break;
+        }
+        prefix += (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+    }
+
+    if (prefix.empty()) return { column + " LIKE ? ESCAPE '/'", { sanitized } };
+    if (exact) return { "(lower(" + column + ") = ? AND " + column + " LIKE ? ESCAPE '/')", { prefix, sanitized } };
+
+    PathCondition cond{ "(lower(" + column + ") >= ?", { prefix } };
+
+    const auto upper = prefixUpperBound(prefix);
+    if (!upper.empty()) {
+        cond.sql += " AND lower(" + column + ") < ?";
+        cond.params.push_back(upper);
+    }
+
+    cond.sql += " AND " + column + " LIKE ? ESCAPE '/')";
+    cond.params.push_back(sanitized);
+
+    return cond;
+}
+
+}
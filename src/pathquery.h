@@ -0,0 +1,44 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+#ifndef PATHQUERY_H
+#define PATHQUERY_H
+
+#include <string>
+#include <vector>
+#include "statement.h"
+#include "ddb_export.h"
+
+namespace ddb {
+
+// SQL condition on entry paths, along with its parameters.
+// Conditions are written so that SQLite can answer them with a range
+// scan on an index instead of scanning the whole entries table.
+struct PathCondition {
+    std::string sql;
+    std::vector<std::string> params;
+
+    // Bind the parameters starting at index i
+    // @return index of the next parameter
+    DDB_DLL int bind(Statement *q, int i = 1) const;
+};
+
+// Escape a user pattern for use with LIKE ... ESCAPE '/' ("*" is the wildcard)
+DDB_DLL std::string sanitize_query_param(const std::string &str);
+
+// Smallest string that sorts after every string starting with prefix,
+// or an empty string if there's no such string
+DDB_DLL std::string prefixUpperBound(const std::string &prefix);
+
+// Entries inside folder, at any depth (folder itself excluded).
+// folder is an exact path and is matched case sensitively
+DDB_DLL PathCondition folderCondition(const std::string &folder, const std::string &column = "path");
+
+// Entries matching a user pattern. Matching follows the rules of LIKE
+// (ASCII case insensitive), but the literal prefix of the pattern is
+// looked up through the lower(path) index
+DDB_DLL PathCondition patternCondition(const std::string &pattern, const std::string &column = "path");
+
+}
+
+#endif // PATHQUERY_H
@@ -506,7 +506,7 @@ void Registry::pull(const std::string &path, const MergeStrategy mergeStrategy,
 
     // Perform local diff using delta method using last stamp
     SyncManager sm(db.get());
-    const auto delta = getDelta(remoteStamp, sm.getLastStamp(tagInfo.registryUrl));
+    const auto delta = getDelta(parseStamp(remoteStamp), sm.getLastBinaryStamp(tagInfo.registryUrl));
 
     if (!delta.empty()){
         out << "Delta: files (+" << delta.adds.size() << ",-" << delta.removes.size() << "), meta (+"
@@ -606,8 +606,8 @@ std::unordered_map<std::string, bool> computeDeltaLocals(Delta d, Database *db,
             if (p.getModifiedTime() == eMtime){
                 valid = true;
             }else{
-                // Actually compute hash
-                valid = Hash::fileSHA256(p.get().string()) == add.hash;
+                // Actually compute hash (without writing to the index)
+                valid = db->getHashCache()->fileSHA256(p.get(), false) == add.hash;
             }
 
             if (valid){
@@ -665,8 +665,7 @@ void Registry::push(const std::string &path, std::ostream &out) {
 
     std::string registryStampChecksum = "";
     try{
-        const auto regStamp = syncManager.getLastStamp(tagInfo.registryUrl);
-        registryStampChecksum = regStamp["checksum"];
+        registryStampChecksum = syncManager.getLastBinaryStamp(tagInfo.registryUrl).checksum();
     }catch(const NoStampException &){
         // Nothing, this is the first time we push
     }
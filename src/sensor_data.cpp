@@ -1,70 +1,64 @@
 /* This Source Code Form is subject to the terms of the Mozilla Public
  * License, v. 2.0. If a copy of the MPL was not distributed with this
  * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
-#include <mutex>
+#include <algorithm>
 #include "sensor_data.h"
+#include "sqlite_database.h"
 #include "logger.h"
 #include "exceptions.h"
 #include "mio.h"
 
 namespace ddb{
 
-std::mutex dbInitMutex;
-SqliteDatabase* SensorData::db = nullptr;
-std::map<std::string, double> SensorData::cacheHits;
-std::map<std::string, bool> SensorData::cacheMiss;
-
-void SensorData::checkDbInit(){
-    std::lock_guard<std::mutex> guard(dbInitMutex);
-
-    if (db == nullptr){
-        db = new SqliteDatabase();
-        LOGD << "Initializing sensor database";
+const std::vector<SensorData::Sensor> &SensorData::sensors(){
+    // Initialized once, even with concurrent callers. If loading
+    // fails, the next call tries again
+    static const std::vector<Sensor> table = []{
+        LOGD << "Loading sensor database";
 
         fs::path dbPath = io::getDataPath("sensor_data.sqlite");
         if (dbPath.empty()) throw DBException("Cannot find sensor database sensor_data.sqlite");
 
-        db->open(dbPath.string());
-    }
-}
+        SqliteDatabase db;
+        db.open(dbPath.string());
 
-bool SensorData::contains(const std::string &sensor){
-    if (cacheHits.count(sensor) > 0) return true;
-    if (cacheMiss.count(sensor) > 0) return false;
+        std::vector<Sensor> t;
+        {
+            auto q = db.query("SELECT id, focal FROM sensors");
+            while (q->fetch()){
+                t.push_back({q->getText(0), q->getDouble(1)});
+            }
+        }
+
+        // Sorted here, SQLite's collation might not match std::string's
+        std::sort(t.begin(), t.end(), [](const Sensor &a, const Sensor &b){
+            return a.id < b.id;
+        });
 
-    checkDbInit();
-    auto q = db->query("SELECT focal FROM sensors WHERE id = ?");
-    q->bind(1, sensor);
-    if (q->fetch()){
-        // Store in cache
-        cacheHits[sensor] = q->getDouble(0);
-        return true;
-    }else{
-        cacheMiss[sensor] = true;
-        return false;
-    }
+        LOGD << "Loaded " << t.size() << " sensors";
+        return t;
+    }();
+
+    return table;
 }
 
-double SensorData::getFocal(const std::string &sensor){
-    if (cacheHits.count(sensor) > 0) return cacheHits.at(sensor);
-    if (cacheMiss.count(sensor) > 0) throw DBException("Cannot get focal value for " + sensor + ", no entry found");
+const SensorData::Sensor *SensorData::find(const std::string &sensor){
+    const auto &table = sensors();
+    auto it = std::lower_bound(table.begin(), table.end(), sensor, [](const Sensor &s, const std::string &id){
+        return s.id < id;
+    });
+    if (it != table.end() && it->id == sensor) return &(*it);
+    return nullptr;
+}
 
-    checkDbInit();
-    auto q = db->query("SELECT focal FROM sensors WHERE id = ?");
-    q->bind(1, sensor);
-    if (q->fetch()){
-        // Store in cache
-        cacheHits[sensor] = q->getDouble(0);
-        return cacheHits[sensor];
-    }else{
-        cacheMiss[sensor] = true;
-        throw DBException("Cannot get focal value for " + sensor + ", no entry found");
-    }
+bool SensorData::contains(const std::string &sensor){
+    return find(sensor) != nullptr;
 }
 
-void SensorData::clearCache(){
-    cacheHits.clear();
-    cacheMiss.clear();
+double SensorData::getFocal(const std::string &sensor){
+    const Sensor *s = find(sensor);
+    if (s == nullptr) throw DBException("Cannot get focal value for " + sensor + ", no entry found");
+    return s->focal;
 }
 
 }
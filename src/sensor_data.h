@@ -4,22 +4,27 @@
 #ifndef SENSORDATA_H
 #define SENSORDATA_H
 
-#include <map>
-#include "sqlite_database.h"
+#include <string>
+#include <vector>
 #include "ddb_export.h"
 
 namespace ddb{
 
+// Sensor database lookups. The sensor table is read once and never
+// modified afterwards, so lookups can run from any number of threads
 class SensorData{
-    static SqliteDatabase *db;
-    static std::map<std::string, double> cacheHits;
-    static std::map<std::string, bool> cacheMiss;
+    struct Sensor {
+        std::string id;
+        double focal;
+    };
+
+    // Sensors sorted by id, loaded on first use
+    static const std::vector<Sensor> &sensors();
+    static const Sensor *find(const std::string &sensor);
 
 public:
-    DDB_DLL static void checkDbInit();
     DDB_DLL static bool contains(const std::string &sensor);
     DDB_DLL static double getFocal(const std::string &sensor);
-    DDB_DLL static void clearCache();
 };
 
 }
@@ -20,6 +20,7 @@ SqliteDatabase &SqliteDatabase::open(const std::string &file) {
     if( sqlite3_open(file.c_str(), &db) != SQLITE_OK ) throw DBException("Can't open database: " + file);
 
     this->openFile = file;
+    this->statementCache = std::make_shared<StatementCache>();
     this->afterOpen();
 
     return *this;
@@ -29,9 +30,27 @@ void SqliteDatabase::afterOpen(){
     // Nothing
 }
 
+bool SqliteDatabase::loadExtensions() const{
+    return false;
+}
+
+namespace{
+
+bool isMissingFunctionError(sqlite3 *db){
+    const std::string error = sqlite3_errmsg(db);
+    return error.rfind("no such function", 0) == 0 || error.rfind("no such module", 0) == 0;
+}
+
+}
+
 SqliteDatabase &SqliteDatabase::close() {
     if (db != nullptr) {
         LOGD << "Closing connection to " << openFile;
+
+        // Statements still in use will be finalized instead
+        // of being handed back to the cache
+        statementCache.reset();
+
         sqlite3_close(db);
         db = nullptr;
     }
@@ -47,11 +66,29 @@ SqliteDatabase &SqliteDatabase::reopen(){
 SqliteDatabase &SqliteDatabase::exec(const std::string &sql) {
     if (db == nullptr) throw DBException("Can't execute SQL: " + sql + ", db is not open");
 
-    char *errMsg;
-    if (sqlite3_exec(db, sql.c_str(), nullptr, nullptr, &errMsg) != SQLITE_OK ) {
-        const std::string error(errMsg);
-        sqlite3_free(errMsg);
-        throw SQLException(error);
+    // Same as sqlite3_exec, except that statements are prepared one at a
+    // time, so that one can be retried after loading a missing extension
+    // without running the ones before it twice
+    const char *tail = sql.c_str();
+    while (*tail != '\0'){
+        sqlite3_stmt *stmt = nullptr;
+        const char *next = nullptr;
+        int rc = sqlite3_prepare_v2(db, tail, -1, &stmt, &next);
+        if (rc != SQLITE_OK && isMissingFunctionError(db) && this->loadExtensions()){
+            rc = sqlite3_prepare_v2(db, tail, -1, &stmt, &next);
+        }
+        if (rc != SQLITE_OK) throw SQLException(sqlite3_errmsg(db));
+        tail = next;
+
+        if (stmt == nullptr) continue; // Whitespace or comment
+
+        while ((rc = sqlite3_step(stmt)) == SQLITE_ROW){}
+        if (rc != SQLITE_DONE){
+            const std::string error(sqlite3_errmsg(db));
+            sqlite3_finalize(stmt);
+            throw SQLException(error);
+        }
+        sqlite3_finalize(stmt);
     }
 
     return *this;
@@ -82,6 +119,15 @@ void SqliteDatabase::setJournalMode(const std::string &mode){
     this->exec("PRAGMA journal_mode=" + mode + ";");
 }
 
+int SqliteDatabase::getUserVersion(){
+    auto q = this->query("PRAGMA user_version");
+    return q->fetch() ? q->getInt(0) : 0;
+}
+
+void SqliteDatabase::setUserVersion(int version){
+    this->exec("PRAGMA user_version = " + std::to_string(version));
+}
+
 void SqliteDatabase::setWritableSchema(bool enabled){
     this->exec(std::string("PRAGMA writable_schema=") + (enabled ? "on" : "off") + ";");
 }
@@ -112,7 +158,17 @@ bool SqliteDatabase::renameColumnIfExists(const std::string &table, const std::s
 }
 
 std::unique_ptr<Statement> SqliteDatabase::query(const std::string &query) const{
-    return std::make_unique<Statement>(db, query);
+    try{
+        return std::make_unique<Statement>(db, query, statementCache);
+    }catch(const SQLException &){
+        if (!isMissingFunctionError(db) || !this->loadExtensions()) throw;
+    }
+
+    return std::make_unique<Statement>(db, query, statementCache);
+}
+
+StatementCache *SqliteDatabase::getStatementCache() const{
+    return statementCache.get();
 }
 
 SqliteDatabase::~SqliteDatabase() {
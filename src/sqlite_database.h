@@ -14,6 +14,7 @@
 #include <memory>
 
 #include "statement.h"
+#include "statementcache.h"
 #include "fs.h"
 #include "ddb_export.h"
 
@@ -23,6 +24,12 @@ class SqliteDatabase {
   protected:
     sqlite3 *db;
     std::string openFile;
+    std::shared_ptr<StatementCache> statementCache;
+
+    // Called when a statement cannot be prepared because of a missing
+    // function or module, so that extensions can be loaded on demand
+    // @return true if something was loaded and the statement should be retried
+    DDB_DLL virtual bool loadExtensions() const;
   public:
     DDB_DLL SqliteDatabase();
     DDB_DLL SqliteDatabase &open(const std::string &file);
@@ -35,9 +42,13 @@ class SqliteDatabase {
     DDB_DLL int changes();
     DDB_DLL void setJournalMode(const std::string &mode);
     DDB_DLL void setWritableSchema(bool enabled);
+    DDB_DLL int getUserVersion();
+    DDB_DLL void setUserVersion(int version);
     DDB_DLL bool renameColumnIfExists(const std::string &table, const std::string &columnDefBefore, const std::string &columnDefAfter);
 
+    // Statements are prepared once and reused through the statement cache
     DDB_DLL std::unique_ptr<Statement> query(const std::string &query) const;
+    DDB_DLL StatementCache* getStatementCache() const;
 
     DDB_DLL ~SqliteDatabase();
 };
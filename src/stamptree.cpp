@@ -0,0 +1,175 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+#include <algorithm>
+#include <set>
+#include "stamptree.h"
+#include "database.h"
+#include "exceptions.h"
+#include "hash.h"
+#include "logger.h"
+#include "pathquery.h"
+
+namespace ddb {
+
+namespace {
+
+// Number of path components ("" = 0, "a" = 1, "a/b" = 2)
+int folderDepth(const std::string &folder) {
+    if (folder.empty()) return 0;
+    return static_cast<int>(std::count(folder.begin(), folder.end(), '/')) + 1;
+}
+
+std::string parentFolder(const std::string &folder) {
+    const auto pos = folder.rfind('/');
+    if (pos == std::string::npos) return "";
+    return folder.substr(0, pos);
+}
+
+Statement *bindFolder(Statement *q, const std::string &folder, int depth) {
+    q->bind(1, depth);
+    if (!folder.empty()) folderCondition(folder).bind(q, 2);
+    return q;
+}
+
+std::string hashNode(const StampTree::Node &n) {
+    SHA256 h;
+    const auto add = [&h](char tag, const std::string &s) {
+        h.add(&tag, 1);
+        h.add(s.c_str(), s.length() + 1);
+    };
+
+    for (const auto &e : n.entries) {
+        add('E', e.path);
+        add('H', e.hash);
+    }
+    for (const auto &f : n.folders) {
+        add('F', f.path);
+        add('H', f.hash);
+    }
+    for (const auto &id : n.meta) add('M', id);
+
+    return h.getHash();
+}
+
+}
+
+void StampTree::update() {
+    // Build the tree the first time (or after a rebuild)
+    {
+        auto q = db->query("SELECT 1 FROM stamp_tree WHERE folder = ''");
+        if (!q->fetch()) {
+            q.reset();
+            LOGD << "Building stamp tree";
+            db->exec(R"<<<(
+                INSERT OR IGNORE INTO stamp_dirty (folder) VALUES ('');
+                INSERT OR IGNORE INTO stamp_dirty (folder)
+                    SELECT DISTINCT rtrim(rtrim(path, replace(path, '/', '')), '/') FROM entries;
+                INSERT OR IGNORE INTO stamp_dirty (folder)
+                    SELECT DISTINCT rtrim(rtrim(path, replace(path, '/', '')), '/') FROM entries_meta;
+            )<<<");
+        }
+    }
+
+    // Changed folders and all of their ancestors
+    std::set<std::string> changed;
+    {
+        auto q = db->query("SELECT folder FROM stamp_dirty");
+        while (q->fetch()) {
+            std::string f = q->getText(0);
+            while (changed.insert(f).second && !f.empty()) f = parentFolder(f);
+        }
+    }
+    if (changed.empty()) return;
+
+    // Children before parents
+    std::vector<std::pair<int, std::string>> folders;
+    folders.reserve(changed.size());
+    for (const auto &f : changed) folders.emplace_back(folderDepth(f), f);
+    std::sort(folders.begin(), folders.end(), std::greater<>());
+
+    db->exec("SAVEPOINT stamp_tree");
+    try {
+        auto upsert = db->query("INSERT OR REPLACE INTO stamp_tree (folder, depth, hash) VALUES (?, ?, ?)");
+        auto remove = db->query("DELETE FROM stamp_tree WHERE folder = ?");
+
+        for (const auto &[depth, folder] : folders) {
+            const auto n = readNode(folder);
+
+            if (n.entries.empty() && n.folders.empty() && n.meta.empty() && !folder.empty()) {
+                remove->bind(1, folder);
+                remove->execute();
+            } else {
+                upsert->bind(1, folder);
+                upsert->bind(2, depth);
+                upsert->bind(3, hashNode(n));
+                upsert->execute();
+            }
+        }
+
+        upsert.reset();
+        remove.reset();
+        db->exec("DELETE FROM stamp_dirty; RELEASE stamp_tree");
+    } catch (const AppException &) {
+        db->exec("ROLLBACK TO stamp_tree; RELEASE stamp_tree");
+        throw;
+    }
+
+    LOGD << "Updated " << folders.size() << " stamp tree nodes";
+}
+
+bool StampTree::isUpToDate() {
+    auto q = db->query("SELECT 1 FROM stamp_tree WHERE folder = ''");
+    if (!q->fetch()) return false;
+
+    q = db->query("SELECT 1 FROM stamp_dirty LIMIT 1");
+    return !q->fetch();
+}
+
+std::string StampTree::hash(const std::string &folder) {
+    auto q = db->query("SELECT hash FROM stamp_tree WHERE folder = ?");
+    q->bind(1, folder);
+    if (q->fetch()) return q->getText(0);
+    return "";
+}
+
+StampTree::Node StampTree::node(const std::string &folder) {
+    return readNode(folder);
+}
+
+StampTree::Node StampTree::readNode(const std::string &folder) {
+    Node n;
+    const int depth = folderDepth(folder);
+
+    // entries.depth counts separators, so direct children of
+    // a folder at depth d have depth d
+    auto q = db->query(folder.empty() ?
+                       "SELECT path, hash FROM entries WHERE depth = ? ORDER BY path" :
+                       "SELECT path, hash FROM entries WHERE depth = ? AND (path >= ? AND path < ?) ORDER BY path");
+    bindFolder(q.get(), folder, depth);
+    while (q->fetch()) n.entries.emplace_back(q->getText(0), q->getText(1));
+
+    q = db->query(folder.empty() ?
+                  "SELECT folder, hash FROM stamp_tree WHERE depth = ? ORDER BY folder" :
+                  "SELECT folder, hash FROM stamp_tree WHERE depth = ? AND (folder >= ? AND folder < ?) ORDER BY folder");
+    bindFolder(q.get(), folder, depth + 1);
+    while (q->fetch()) n.folders.emplace_back(q->getText(0), q->getText(1));
+
+    if (folder.empty()) {
+        q = db->query("SELECT id FROM entries_meta WHERE instr(path, '/') = 0 ORDER BY id");
+    } else {
+        q = db->query("SELECT id FROM entries_meta WHERE path >= ? AND path < ? AND instr(substr(path, length(?) + 2), '/') = 0 ORDER BY id");
+        const int i = folderCondition(folder).bind(q.get());
+        q->bind(i, folder);
+    }
+    while (q->fetch()) n.meta.push_back(q->getText(0));
+
+    return n;
+}
+
+void StampTree::rebuild() {
+    db->exec("DELETE FROM stamp_tree");
+    update();
+}
+
+}
@@ -0,0 +1,69 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+#ifndef STAMPTREE_H
+#define STAMPTREE_H
+
+#include <string>
+#include <vector>
+#include "simpleentry.h"
+#include "ddb_export.h"
+
+namespace ddb {
+
+class Database;
+
+// Merkle tree of the index, stored in the stamp_tree table.
+// There's one node per folder ("" is the root) and its hash covers
+// the paths and hashes of the folder's direct children, the ids of the
+// meta attached to them and the hashes of its subfolder nodes.
+// Two indexes with the same root hash have the same stamp.
+//
+// Triggers on entries and entries_meta record the parent folder
+// of every row that changes; update() recomputes those nodes (and their
+// ancestors), so adding, removing or moving entries only costs the nodes
+// along the affected paths. Reading the tree never writes to the database:
+// nodes read before update() reflect the index as of the last update.
+class StampTree {
+public:
+    struct Node {
+        // Direct children of the folder (path, hash)
+        std::vector<SimpleEntry> entries;
+
+        // Subfolder nodes (path, node hash)
+        std::vector<SimpleEntry> folders;
+
+        // Meta ids attached to the folder's direct children, sorted
+        std::vector<std::string> meta;
+    };
+
+private:
+    Database *db;
+
+    Node readNode(const std::string &folder);
+public:
+    StampTree(Database *db) : db(db) {}
+
+    // Recompute the nodes that changed since the last update,
+    // writing them to stamp_tree and clearing stamp_dirty
+    DDB_DLL void update();
+
+    // @return true if the tree has been built and
+    // no entries or meta changed since the last update
+    DDB_DLL bool isUpToDate();
+
+    // Hash of a folder node ("" is the root), as of the last update
+    // @return empty string if there's nothing in the folder
+    DDB_DLL std::string hash(const std::string &folder = "");
+
+    // Contents of a folder node, as covered by its hash
+    // (subfolder hashes are as of the last update)
+    DDB_DLL Node node(const std::string &folder);
+
+    // Drop and recompute every node
+    DDB_DLL void rebuild();
+};
+
+}
+
+#endif // STAMPTREE_H
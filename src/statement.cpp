@@ -4,16 +4,26 @@
 #include <assert.h>
 #include "statement.h"
 #include "exceptions.h"
+#include "statementcache.h"
 
 using namespace ddb;
 
 Statement::Statement(sqlite3 *db, const std::string &query)
-    : db(db), query(query), hasRow(false), done(false) {
+    : db(db), query(query), hasRow(false), done(false), stmt(nullptr) {
     if (sqlite3_prepare_v2(db, query.c_str(), static_cast<int>(query.length()), &stmt, nullptr) != SQLITE_OK) {
         throw SQLException("Cannot prepare SQL statement: " + query + ": " + std::string(sqlite3_errmsg(db)));
     }
 }
 
+Statement::Statement(sqlite3 *db, const std::string &query, const std::shared_ptr<StatementCache> &cache)
+    : db(db), query(query), cache(cache), hasRow(false), done(false), stmt(nullptr) {
+    if (cache != nullptr) stmt = cache->acquire(query);
+
+    if (stmt == nullptr && sqlite3_prepare_v2(db, query.c_str(), static_cast<int>(query.length()), &stmt, nullptr) != SQLITE_OK) {
+        throw SQLException("Cannot prepare SQL statement: " + query + ": " + std::string(sqlite3_errmsg(db)));
+    }
+}
+
 void Statement::bindCheck(int ret) {
     if (ret != SQLITE_OK) {
         throw SQLException("Failed binding values for " + query + " (error code: " + std::to_string(ret) + ")");
@@ -22,7 +32,15 @@ void Statement::bindCheck(int ret) {
 
 Statement::~Statement() {
     if (stmt != nullptr) {
-        sqlite3_finalize(stmt);
+        const auto c = cache.lock();
+        if (c != nullptr) {
+            // Errors from the last step are reported again by reset, ignore them
+            sqlite3_reset(stmt);
+            sqlite3_clear_bindings(stmt);
+            c->release(query, stmt);
+        } else {
+            sqlite3_finalize(stmt);
+        }
         stmt = nullptr;
     }
 }
@@ -33,6 +51,30 @@ Statement &Statement::bind(int paramNum, const std::string &value) {
     return *this;
 }
 
+Statement &Statement::bind(int paramNum, const char *value) {
+    assert(stmt != nullptr && db != nullptr);
+    bindCheck(sqlite3_bind_text(stmt, paramNum, value, -1, SQLITE_TRANSIENT));
+    return *this;
+}
+
+Statement &Statement::bind(int paramNum, std::string_view value) {
+    assert(stmt != nullptr && db != nullptr);
+    bindCheck(sqlite3_bind_text(stmt, paramNum, value.data(), static_cast<int>(value.length()), SQLITE_STATIC));
+    return *this;
+}
+
+Statement &Statement::bindBlob(int paramNum, const void *data, size_t size) {
+    assert(stmt != nullptr && db != nullptr);
+    bindCheck(sqlite3_bind_blob(stmt, paramNum, data, static_cast<int>(size), SQLITE_STATIC));
+    return *this;
+}
+
+Statement &Statement::bindNull(int paramNum) {
+    assert(stmt != nullptr && db != nullptr);
+    bindCheck(sqlite3_bind_null(stmt, paramNum));
+    return *this;
+}
+
 Statement &Statement::bind(int paramNum, int value) {
     assert(stmt != nullptr && db != nullptr);
     bindCheck(sqlite3_bind_int(stmt, paramNum, value));
@@ -45,6 +87,12 @@ Statement &Statement::bind(int paramNum, long long value) {
     return *this;
 }
 
+Statement &Statement::bind(int paramNum, double value) {
+    assert(stmt != nullptr && db != nullptr);
+    bindCheck(sqlite3_bind_double(stmt, paramNum, value));
+    return *this;
+}
+
 Statement &Statement::step() {
     assert(stmt != nullptr);
 
@@ -84,10 +132,15 @@ long long Statement::getInt64(int columnId) {
 }
 
 std::string Statement::getText(int columnId) {
+    return std::string(getTextView(columnId));
+}
+
+std::string_view Statement::getTextView(int columnId) {
     assert(stmt != nullptr);
     const auto res = reinterpret_cast<const char*>(sqlite3_column_text(stmt, columnId));
 	// If the column is NULL this would go KabOOM without checking for nullptr
-    return res == nullptr ? std::string() : std::string(res);
+    if (res == nullptr) return std::string_view();
+    return std::string_view(res, static_cast<size_t>(sqlite3_column_bytes(stmt, columnId)));
 }
 
 const void* Statement::getBlob(int columnId){
@@ -95,6 +148,16 @@ const void* Statement::getBlob(int columnId){
     return sqlite3_column_blob(stmt, columnId);
 }
 
+int Statement::getBlobSize(int columnId){
+    assert(stmt != nullptr);
+    return sqlite3_column_bytes(stmt, columnId);
+}
+
+bool Statement::isNull(int columnId){
+    assert(stmt != nullptr);
+    return sqlite3_column_type(stmt, columnId) == SQLITE_NULL;
+}
+
 double Statement::getDouble(int columnId){
     assert(stmt != nullptr);
     return sqlite3_column_double(stmt, columnId);
@@ -6,14 +6,23 @@
 #define STATEMENT_H
 
 #include <sqlite3.h>
+#include <memory>
 #include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
 #include "logger.h"
 #include "ddb_export.h"
 
+namespace ddb { class StatementCache; }
+
 class Statement {
     sqlite3 *db;
     std::string query;
 
+    // Where to hand back the statement when done (if any)
+    std::weak_ptr<ddb::StatementCache> cache;
+
     bool hasRow;
     bool done;
 
@@ -23,11 +32,23 @@ class Statement {
     Statement &step();
   public:
     DDB_DLL Statement(sqlite3 *db, const std::string &query);
+
+    // Take the prepared statement from cache when available,
+    // and give it back to the cache once destroyed
+    DDB_DLL Statement(sqlite3 *db, const std::string &query, const std::shared_ptr<ddb::StatementCache> &cache);
     DDB_DLL ~Statement();
 
     DDB_DLL Statement &bind(int paramNum, const std::string &value);
+    DDB_DLL Statement &bind(int paramNum, const char *value);
     DDB_DLL Statement &bind(int paramNum, int value);
     DDB_DLL Statement &bind(int paramNum, long long value);
+    DDB_DLL Statement &bind(int paramNum, double value);
+    DDB_DLL Statement &bindNull(int paramNum);
+
+    // The data is not copied: it must stay valid until the
+    // statement is executed (or reset)
+    DDB_DLL Statement &bind(int paramNum, std::string_view value);
+    DDB_DLL Statement &bindBlob(int paramNum, const void *data, size_t size);
 
     DDB_DLL bool fetch();
 
@@ -36,6 +57,22 @@ class Statement {
     DDB_DLL std::string getText(int columnId);
     DDB_DLL double getDouble(int columnId);
     DDB_DLL const void *getBlob(int columnId);
+    DDB_DLL int getBlobSize(int columnId);
+    DDB_DLL bool isNull(int columnId);
+
+    // Text of a column without copying it (empty if NULL),
+    // valid until the next call to fetch, reset or execute
+    DDB_DLL std::string_view getTextView(int columnId);
+
+    // Typed column access (int, long long, double, bool,
+    // std::string, std::string_view)
+    template <typename T> T get(int columnId);
+
+    // Decode the current row, one column per type:
+    // const auto [path, size] = q->getRow<std::string, long long>();
+    template <typename... T> std::tuple<T...> getRow() {
+        return getRow<T...>(std::index_sequence_for<T...>{});
+    }
 
     DDB_DLL int getColumnsCount() const;
     // TODO: more
@@ -44,6 +81,18 @@ class Statement {
     DDB_DLL void execute();
 
     DDB_DLL std::string getQuery() const;
+
+  private:
+    template <typename... T, size_t... I> std::tuple<T...> getRow(std::index_sequence<I...>) {
+        return std::tuple<T...>(get<T>(static_cast<int>(I))...);
+    }
 };
 
+template <> inline int Statement::get<int>(int columnId) { return getInt(columnId); }
+template <> inline long long Statement::get<long long>(int columnId) { return getInt64(columnId); }
+template <> inline double Statement::get<double>(int columnId) { return getDouble(columnId); }
+template <> inline bool Statement::get<bool>(int columnId) { return getInt(columnId) != 0; }
+template <> inline std::string Statement::get<std::string>(int columnId) { return getText(columnId); }
+template <> inline std::string_view Statement::get<std::string_view>(int columnId) { return getTextView(columnId); }
+
 #endif // STATEMENT_H
@@ -0,0 +1,92 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+#include "statementcache.h"
+
+namespace ddb {
+
+StatementCache::StatementCache(size_t capacity) : capacity(capacity), hitCount(0), missCount(0) {}
+
+StatementCache::~StatementCache() {
+    clear();
+}
+
+sqlite3_stmt *StatementCache::acquire(const std::string &sql) {
+    std::lock_guard<std::mutex> guard(mutex);
+
+    const auto it = index.find(sql);
+    if (it == index.end()) {
+        missCount++;
+        return nullptr;
+    }
+
+    sqlite3_stmt *stmt = it->second->second;
+    lru.erase(it->second);
+    index.erase(it);
+
+    hitCount++;
+    return stmt;
+}
+
+void StatementCache::release(const std::string &sql, sqlite3_stmt *stmt) {
+    std::lock_guard<std::mutex> guard(mutex);
+
+    lru.emplace_front(sql, stmt);
+    index.emplace(sql, lru.begin());
+
+    evict();
+}
+
+// Finalize the least recently used statements until we are within capacity.
+// Must be called with the mutex held
+void StatementCache::evict() {
+    while (lru.size() > capacity) {
+        const auto &last = lru.back();
+
+        auto range = index.equal_range(last.first);
+        for (auto it = range.first; it != range.second; it++) {
+            if (it->second == std::prev(lru.end())) {
+                index.erase(it);
+                break;
+            }
+        }
+
+        sqlite3_finalize(last.second);
+        lru.pop_back();
+    }
+}
+
+void StatementCache::clear() {
+    std::lock_guard<std::mutex> guard(mutex);
+
+    for (auto &p : lru) sqlite3_finalize(p.second);
+    lru.clear();
+    index.clear();
+}
+
+void StatementCache::setCapacity(size_t capacity) {
+    std::lock_guard<std::mutex> guard(mutex);
+
+    this->capacity = capacity;
+    evict();
+}
+
+size_t StatementCache::size() {
+    std::lock_guard<std::mutex> guard(mutex);
+    return lru.size();
+}
+
+size_t StatementCache::hits() const {
+    return hitCount;
+}
+
+size_t StatementCache::misses() const {
+    return missCount;
+}
+
+void StatementCache::resetCounters() {
+    hitCount = 0;
+    missCount = 0;
+}
+
+}
@@ -0,0 +1,58 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+#ifndef STATEMENTCACHE_H
+#define STATEMENTCACHE_H
+
+#include <sqlite3.h>
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "ddb_export.h"
+
+namespace ddb {
+
+#define DDB_STATEMENT_CACHE_SIZE 64
+
+// LRU cache of prepared statements, keyed by SQL text.
+// A statement is removed from the cache while in use and is
+// handed back (reset) when its Statement is destroyed, so the
+// same sqlite3_stmt is never shared between two users.
+class StatementCache {
+    typedef std::list<std::pair<std::string, sqlite3_stmt *>> LruList;
+
+    size_t capacity;
+    LruList lru;
+    std::unordered_multimap<std::string, LruList::iterator> index;
+    std::mutex mutex;
+
+    std::atomic<size_t> hitCount;
+    std::atomic<size_t> missCount;
+
+    void evict();
+public:
+    DDB_DLL StatementCache(size_t capacity = DDB_STATEMENT_CACHE_SIZE);
+    DDB_DLL ~StatementCache();
+
+    // @return a prepared statement for sql, or nullptr if there's none available
+    DDB_DLL sqlite3_stmt *acquire(const std::string &sql);
+
+    // Give back a statement that has been reset
+    DDB_DLL void release(const std::string &sql, sqlite3_stmt *stmt);
+
+    // Finalize all idle statements
+    DDB_DLL void clear();
+
+    DDB_DLL void setCapacity(size_t capacity);
+    DDB_DLL size_t size();
+
+    DDB_DLL size_t hits() const;
+    DDB_DLL size_t misses() const;
+    DDB_DLL void resetCounters();
+};
+
+}
+
+#endif // STATEMENTCACHE_H
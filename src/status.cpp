@@ -33,7 +33,7 @@ namespace ddb
 
 			checkedPaths.insert(path);
 
-        	const auto status = checkUpdate(e, p, q->getInt64(1), q->getText(2));
+        	const auto status = checkUpdate(e, p, q->getInt64(1), q->getText(2), db->getHashCache(), false);
 
         	cb(status, relPath.generic());
 		}
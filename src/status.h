@@ -17,7 +17,8 @@ namespace ddb {
                 NotModified
         };
 
-	DDB_DLL FileStatus checkUpdate(Entry &e, const fs::path &p, long long dbMtime, const std::string &dbHash);
+	// When updateCache is false, hashCache is only read (see HashCache::fileSHA256)
+	DDB_DLL FileStatus checkUpdate(Entry &e, const fs::path &p, long long dbMtime, const std::string &dbHash, HashCache *hashCache = nullptr, bool updateCache = true);
 	
 	typedef std::function<void(const FileStatus status, const std::string& file)> FileStatusCallback;
 
@@ -8,21 +8,16 @@
 #include <mio.h>
 
 #include "dbops.h"
+#include "delta.h"
 #include "exceptions.h"
+#include "hash.h"
 #include "registryutils.h"
 
 namespace ddb {
 
-json SyncManager::getLastStamp(const std::string &registry) {
-    const auto path = this->db->ddbDirectory() / SYNCFILE;
-
-    LOGD << "Path = " << path;
-    LOGD << "Registry = " << registry;
-
-    if (registry.length() == 0) 
-        throw InvalidArgsException("Registry cannot be null");
-
+namespace {
 
+json readSyncFile(const fs::path &path) {
     if (!exists(path)) {
         LOGD << "Path does not exist, creating empty file";
         std::ofstream out(path, std::ios_base::out);
@@ -34,14 +29,43 @@ json SyncManager::getLastStamp(const std::string &registry) {
     json j;
     i >> j;
 
-    //if (!j.contains(registry)) throw NoStampException("Tried to get last stamp for registry " + registry + " but found none");
-    if (!j.contains(registry)){
+    if (j.contains("version") && j["version"].is_number_integer() &&
+        j["version"].get<int>() > SYNC_FORMAT_VERSION)
+        throw AppException(path.string() + " was written by a newer version of DroneDB");
+
+    return j;
+}
+
+}
+
+json SyncManager::getLastStamp(const std::string &registry) {
+    return getLastBinaryStamp(registry).toJSON();
+}
+
+BinaryStamp SyncManager::getLastBinaryStamp(const std::string &registry) {
+    const auto path = this->db->ddbDirectory() / SYNCFILE;
+
+    LOGD << "Path = " << path;
+    LOGD << "Registry = " << registry;
+
+    if (registry.length() == 0) 
+        throw InvalidArgsException("Registry cannot be null");
+
+    const json j = readSyncFile(path);
+
+    if (j.contains(registry) && j[registry].is_object()){
+        // Stamps are stored inline by older versions, which might
+        // have synced after the stamp file was written
+        LOGD << "Converting last stamp of " << registry << " to binary";
+        setLastStamp(registry, j[registry]);
+    }else if (!j.contains(SYNC_STAMP_FILES) || !j[SYNC_STAMP_FILES].contains(registry)){
         // Initialize
         setLastStamp(registry, this->db);
-        return getLastStamp(registry);
     }else{
-        return j[registry];
+        return BinaryStamp::open(this->db->ddbDirectory() / j[SYNC_STAMP_FILES][registry].get<std::string>());
     }
+
+    return getLastBinaryStamp(registry);
 }
 
 void SyncManager::setLastStamp(const std::string& registry, Database *sourceDb) {
@@ -61,22 +85,51 @@ void SyncManager::setLastStamp(const std::string &registry, const json &stamp){
     if (registry.length() == 0)
         throw InvalidArgsException("Registry cannot be null");
 
-    if (!exists(path)) {
-        std::ofstream out(path, std::ios_base::out);
-        out << "{}";
-        out.close();
+    json j = readSyncFile(path);
+
+    // Stamp files are named after their contents and never overwritten:
+    // the previous stamp might still be memory mapped, and mapped files
+    // cannot be replaced on Windows
+    const auto data = encodeBinaryStamp(parseStamp(stamp));
+    const auto prefix = Hash::strSHA256(registry).substr(0, 16) + "-";
+    const auto stampName = prefix + Hash::dataSHA256(data.data(), data.size()).substr(0, 16) + ".stamp";
+    const auto stampsPath = this->db->ddbDirectory() / SYNC_STAMPS_FOLDER;
+    const auto stampPath = stampsPath / stampName;
+    io::createDirectories(stampsPath);
+
+    if (!exists(stampPath)){
+        // Write to a temporary file first, so that
+        // stamp files are always complete
+        const auto tmpPath = fs::path(stampPath.string() + ".tmp");
+        {
+            std::ofstream out(tmpPath, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+            out.write(data.data(), static_cast<std::streamsize>(data.size()));
+            out.close();
+            if (out.fail()) throw FSException("Cannot write " + tmpPath.string());
+        }
+        io::rename(tmpPath, stampPath);
     }
 
-    std::ifstream i(path);
-    json j;
-    i >> j;
-    i.close();
+    j.erase(registry);
+    j["version"] = SYNC_FORMAT_VERSION;
+    j[SYNC_STAMP_FILES][registry] = (fs::path(SYNC_STAMPS_FOLDER) / stampName).generic_string();
 
-    j[registry] = stamp;
+    {
+        std::ofstream out(path, std::ios_base::out | std::ios_base::trunc);
+        out << j.dump(4);
+        out.close();
+    }
 
-    std::ofstream out(path, std::ios_base::out | std::ios_base::trunc);
-    out << j.dump(4);
-    out.close();
+    // Remove the previous stamps of this registry. Those that
+    // are still mapped are removed the next time around
+    for (const auto &f : fs::directory_iterator(stampsPath)){
+        const auto name = f.path().filename().string();
+        if (name == stampName || name.rfind(prefix, 0) != 0) continue;
+
+        std::error_code ec;
+        fs::remove(f.path(), ec);
+        if (ec) LOGD << "Cannot remove " << f.path().string() << ": " << ec.message();
+    }
 }
 
 }  // namespace ddb
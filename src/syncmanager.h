@@ -4,6 +4,7 @@
 #ifndef SYNCMANAGER_H
 #define SYNCMANAGER_H
 
+#include "binarystamp.h"
 #include "dbops.h"
 #include "ddb_export.h"
 #include "entry.h"
@@ -12,6 +13,13 @@
 namespace ddb {
 
 #define SYNCFILE "sync.json"
+#define SYNC_STAMPS_FOLDER "stamps"
+
+// sync.json maps registries to their last stamp. Older versions stored the
+// stamps inline, keyed by registry; binary stamp files are listed under a
+// separate key so that those versions never read a value they don't expect
+#define SYNC_FORMAT_VERSION 2
+#define SYNC_STAMP_FILES "stampFiles"
 
 class SyncManager {
     Database *db;
@@ -20,6 +28,7 @@ class SyncManager {
     SyncManager(Database *db) : db(db) {}
 
     DDB_DLL json getLastStamp(const std::string& registry = DEFAULT_REGISTRY);
+    DDB_DLL BinaryStamp getLastBinaryStamp(const std::string& registry = DEFAULT_REGISTRY);
     DDB_DLL void setLastStamp(const std::string& registry = DEFAULT_REGISTRY, Database *sourceDb = nullptr);
     DDB_DLL void setLastStamp(const std::string& registry, const json &stamp);
 };
@@ -0,0 +1,99 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+#include "threadpool.h"
+#include "logger.h"
+
+namespace ddb{
+
+ThreadPool::ThreadPool(size_t threads) : pending(0), nextQueue(0), stopping(false){
+    if (threads == 0) threads = defaultThreadCount();
+
+    for (size_t i = 0; i < threads; i++){
+        queues.push_back(std::make_unique<WorkQueue>());
+    }
+    for (size_t i = 0; i < threads; i++){
+        workers.emplace_back(&ThreadPool::run, this, i);
+    }
+
+    LOGD << "Started thread pool with " << threads << " workers";
+}
+
+ThreadPool::~ThreadPool(){
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        stopping = true;
+    }
+    cv.notify_all();
+
+    for (auto &w : workers){
+        if (w.joinable()) w.join();
+    }
+}
+
+size_t ThreadPool::size() const{
+    return workers.size();
+}
+
+size_t ThreadPool::defaultThreadCount(){
+    const unsigned int n = std::thread::hardware_concurrency();
+    return n > 0 ? n : 1;
+}
+
+void ThreadPool::push(std::function<void()> task){
+    const size_t index = nextQueue++ % queues.size();
+
+    // Count the task before it becomes visible, so that
+    // a worker can never decrement the counter below zero
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        pending++;
+    }
+    {
+        std::lock_guard<std::mutex> guard(queues[index]->mutex);
+        queues[index]->tasks.push_back(std::move(task));
+    }
+
+    cv.notify_one();
+}
+
+// Take a task from our own queue (front) or steal one
+// from another worker's queue (back)
+bool ThreadPool::pop(size_t index, std::function<void()> &task){
+    for (size_t i = 0; i < queues.size(); i++){
+        const size_t qi = (index + i) % queues.size();
+        auto &q = *queues[qi];
+
+        std::lock_guard<std::mutex> guard(q.mutex);
+        if (q.tasks.empty()) continue;
+
+        if (i == 0){
+            task = std::move(q.tasks.front());
+            q.tasks.pop_front();
+        }else{
+            task = std::move(q.tasks.back());
+            q.tasks.pop_back();
+        }
+
+        pending--;
+        return true;
+    }
+
+    return false;
+}
+
+void ThreadPool::run(size_t index){
+    while (!stopping){
+        std::function<void()> task;
+
+        if (pop(index, task)){
+            task();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [this]{ return stopping || pending > 0; });
+    }
+}
+
+}
@@ -0,0 +1,64 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "ddb_export.h"
+
+namespace ddb{
+
+// Fixed size, work-stealing thread pool.
+// Each worker owns a task queue; tasks are distributed round-robin
+// and idle workers steal from the back of other workers' queues.
+// Tasks still queued when the pool is destroyed are discarded.
+class ThreadPool {
+    struct WorkQueue{
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    std::vector<std::thread> workers;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::atomic<size_t> pending;
+    std::atomic<size_t> nextQueue;
+    std::atomic<bool> stopping;
+
+    void push(std::function<void()> task);
+    bool pop(size_t index, std::function<void()> &task);
+    void run(size_t index);
+public:
+    // @param threads number of worker threads (0 = number of cores)
+    DDB_DLL ThreadPool(size_t threads = 0);
+    DDB_DLL ~ThreadPool();
+
+    DDB_DLL size_t size() const;
+
+    template <typename F>
+    std::future<std::invoke_result_t<F>> submit(F f){
+        typedef std::invoke_result_t<F> R;
+        auto task = std::make_shared<std::packaged_task<R()>>(std::move(f));
+        std::future<R> result = task->get_future();
+        push([task](){ (*task)(); });
+        return result;
+    }
+
+    DDB_DLL static size_t defaultThreadCount();
+};
+
+}
+
+#endif // THREADPOOL_H
@@ -1,7 +1,9 @@
 /* This Source Code Form is subject to the terms of the Mozilla Public
  * License, v. 2.0. If a copy of the MPL was not distributed with this
  * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+#include <cmath>
 #include <mutex>
+#include <unordered_map>
 #include "timezone.h"
 #include "logger.h"
 #include "mio.h"
@@ -9,10 +11,58 @@
 
 using namespace ddb;
 
-bool Timezone::initialized = false;
+std::atomic<bool> Timezone::initialized(false);
 ZoneDetect *Timezone::db = nullptr;
 std::mutex timezoneMutex;
 
+namespace {
+
+// Size of the cells of the lookup cache, in degrees
+const double CacheCellSize = 0.1;
+const size_t MaxCacheCells = 4096;
+
+// Result of a ZoneDetect lookup, valid for all
+// locations closer than safezone
+struct CachedLookup {
+    double latitude;
+    double longitude;
+    double safezone;
+    cctz::time_zone tz;
+
+    bool covers(double lat, double lon) const {
+        const double dLat = lat - latitude;
+        const double dLon = lon - longitude;
+        return (dLat == 0 && dLon == 0) || dLat * dLat + dLon * dLon < safezone * safezone;
+    }
+};
+
+std::mutex cacheMutex;
+std::unordered_map<uint64_t, CachedLookup> lookupCache;
+std::unordered_map<std::string, std::pair<bool, cctz::time_zone>> zoneCache;
+
+uint64_t cellKey(double latitude, double longitude) {
+    const auto row = static_cast<uint32_t>(static_cast<int32_t>(std::floor(latitude / CacheCellSize)));
+    const auto col = static_cast<uint32_t>(static_cast<int32_t>(std::floor(longitude / CacheCellSize)));
+    return static_cast<uint64_t>(row) << 32 | col;
+}
+
+// cctz::load_time_zone parses tzdata from disk, load each zone once
+bool loadTimezone(const std::string &timezoneId, cctz::time_zone &tz) {
+    std::lock_guard<std::mutex> guard(cacheMutex);
+
+    auto it = zoneCache.find(timezoneId);
+    if (it == zoneCache.end()) {
+        cctz::time_zone loaded;
+        const bool ok = cctz::load_time_zone(timezoneId, &loaded);
+        it = zoneCache.emplace(timezoneId, std::make_pair(ok, loaded)).first;
+    }
+
+    if (it->second.first) tz = it->second.second;
+    return it->second.first;
+}
+
+}
+
 [[ noreturn ]] void onError(int errZD, int errNative) {
     throw TimezoneException("Timezone error: " + std::string(ZDGetErrorString(errZD)) + " (" + std::to_string(errNative) + ")");
 }
@@ -20,6 +70,7 @@ std::mutex timezoneMutex;
 void Timezone::init() {
     if (initialized) return;
     std::lock_guard<std::mutex> guard(timezoneMutex);
+    if (initialized) return;
 
     ZDSetErrorHandler(onError);
     fs::path dbPath = io::getDataPath("timezone21.bin");
@@ -34,12 +85,16 @@ cctz::time_zone Timezone::lookupTimezone(double latitude, double longitude){
     Timezone::init();
     if (!db) return cctz::utc_time_zone();
 
+    const uint64_t key = cellKey(latitude, longitude);
+    {
+        std::lock_guard<std::mutex> guard(cacheMutex);
+        auto it = lookupCache.find(key);
+        if (it != lookupCache.end() && it->second.covers(latitude, longitude)) return it->second.tz;
+    }
+
     float safezone = 0;
     ZoneDetectResult *results = ZDLookup(db, static_cast<float>(latitude), static_cast<float>(longitude), &safezone);
-    if (!results) {
-        ZDFreeResults(results);
-        return cctz::utc_time_zone();
-    }
+    if (!results) return cctz::utc_time_zone();
 
     unsigned int index = 0;
     cctz::time_zone tz = cctz::utc_time_zone();
@@ -49,7 +104,7 @@ cctz::time_zone Timezone::lookupTimezone(double latitude, double longitude){
         if(results[index].data) {
             std::string timezoneId = std::string(results[index].data[0]) + std::string(results[index].data[1]);
 
-            if (!cctz::load_time_zone(timezoneId, &tz)) {
+            if (!loadTimezone(timezoneId, tz)) {
                 LOGD << "Cannot load timezone " << timezoneId << ", defaulting to: " << tz.name();
             } else {
                 found = true;
@@ -60,10 +115,21 @@ cctz::time_zone Timezone::lookupTimezone(double latitude, double longitude){
         index++;
     }
 
+    ZDFreeResults(results);
+
     if (!found) {
         LOGD << "Cannot find timezone for " << latitude << "," << longitude << ", defaulting to UTC";
     }
 
+    // The safezone (distance to the closest border, in degrees) only accounts for the
+    // zones whose bounds contain the location, so it's only used when the location
+    // is within a zone. Otherwise the result is reused for the same location only
+    {
+        std::lock_guard<std::mutex> guard(cacheMutex);
+        if (lookupCache.size() >= MaxCacheCells) lookupCache.clear();
+        lookupCache[key] = {latitude, longitude, found ? static_cast<double>(safezone) : 0.0, tz};
+    }
+
     return tz;
 }
 
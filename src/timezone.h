@@ -4,16 +4,20 @@
 #ifndef TIMEZONE_H
 #define TIMEZONE_H
 
+#include <atomic>
 #include "cctz/time_zone.h"
 #include "../vendor/zonedetect/zonedetect.h"
 #include "ddb_export.h"
 
 class Timezone{
 public:
-    static bool initialized;
+    static std::atomic<bool> initialized;
     static ZoneDetect *db;
 
     DDB_DLL static void init();
+
+    // Timezone at a location. Results are cached, so that nearby
+    // locations (e.g. the images of a flight) share a single lookup
     DDB_DLL static cctz::time_zone lookupTimezone(double latitude, double longitude);
     DDB_DLL static double getUTCEpoch(int year, int month, int day, int hour, int minute, int second, double msecs, const cctz::time_zone &tz);
 };
@@ -4,6 +4,7 @@
 
 #include "userprofile.h"
 
+#include <fstream>
 #include <ddb.h>
 
 #include "exceptions.h"
@@ -103,4 +104,49 @@ AuthManager *UserProfile::getAuthManager(){
     return authManager;
 }
 
+fs::path UserProfile::getSettingsFile(){
+    return getProfileDir() / "settings.json";
+}
+
+json UserProfile::readSettings(){
+    const fs::path settingsFile = getSettingsFile();
+    if (!fs::exists(settingsFile)) return json::object();
+
+    std::ifstream fin(settingsFile);
+    try{
+        json j;
+        fin >> j;
+        if (j.is_object()) return j;
+    }catch(const json::exception &e){
+        LOGD << "Error reading " << settingsFile.string() << ": " << e.what();
+    }
+
+    return json::object();
+}
+
+BulkLoadSettings UserProfile::getBulkLoadSettings(){
+    if (!bulkLoadSettingsLoaded){
+        const json j = readSettings();
+        if (j.contains("bulkLoad") && j["bulkLoad"].is_object()){
+            const json &b = j["bulkLoad"];
+            try{
+                bulkLoadSettings.enabled = b.value("enabled", bulkLoadSettings.enabled);
+                bulkLoadSettings.minPaths = b.value("minPaths", bulkLoadSettings.minPaths);
+                bulkLoadSettings.cacheSize = b.value("cacheSize", bulkLoadSettings.cacheSize);
+                bulkLoadSettings.mmapSize = b.value("mmapSize", bulkLoadSettings.mmapSize);
+            }catch(const json::exception &e){
+                LOGD << "Invalid bulkLoad settings: " << e.what();
+            }
+        }
+        bulkLoadSettingsLoaded = true;
+    }
+
+    return bulkLoadSettings;
+}
+
+void UserProfile::setBulkLoadSettings(const BulkLoadSettings &settings){
+    bulkLoadSettings = settings;
+    bulkLoadSettingsLoaded = true;
+}
+
 }
@@ -8,6 +8,7 @@
 #include "fs.h"
 #include "logger.h"
 #include "authmanager.h"
+#include "database.h"
 #include "ddb_export.h"
 
 namespace ddb{
@@ -27,14 +28,25 @@ public:
     DDB_DLL fs::path getAuthFile();
 
     DDB_DLL AuthManager *getAuthManager();
+
+    // Settings are read from the "bulkLoad" object in settings.json
+    // (keys as in BulkLoadSettings), missing values use the defaults
+    DDB_DLL fs::path getSettingsFile();
+    DDB_DLL BulkLoadSettings getBulkLoadSettings();
+    DDB_DLL void setBulkLoadSettings(const BulkLoadSettings &settings);
 private:
     UserProfile();
 
+    json readSettings();
+
     void createDir(const fs::path &p);
 
     static UserProfile *instance;
 
     AuthManager *authManager;
+
+    bool bulkLoadSettingsLoaded = false;
+    BulkLoadSettings bulkLoadSettings;
 };
 
 }
@@ -0,0 +1,64 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "dbops.h"
+#include "gtest/gtest.h"
+#include "test.h"
+#include "testarea.h"
+
+namespace {
+
+using namespace ddb;
+
+int countIndexes(Database *db, const std::string &name) {
+    auto q = db->query("SELECT COUNT(*) FROM sqlite_master WHERE type = 'index' AND name = ?");
+    q->bind(1, name);
+    return q->fetch() ? q->getInt(0) : 0;
+}
+
+TEST(database, schemaVersion) {
+    TestArea ta(TEST_NAME);
+    const auto testFolder = ta.getFolder("test");
+    initIndex(testFolder.string());
+
+    auto db = ddb::open(testFolder.string(), false);
+    EXPECT_EQ(db->getUserVersion(), DDB_SCHEMA_VERSION);
+
+    // Up to date databases are not checked again
+    db->exec("DROP INDEX ix_entries_size");
+    db.reset();
+    db = ddb::open(testFolder.string(), false);
+    EXPECT_EQ(countIndexes(db.get(), "ix_entries_size"), 0);
+
+    db->setUserVersion(0);
+    db.reset();
+    db = ddb::open(testFolder.string(), false);
+    EXPECT_EQ(countIndexes(db.get(), "ix_entries_size"), 1);
+    EXPECT_EQ(db->getUserVersion(), DDB_SCHEMA_VERSION);
+}
+
+TEST(database, lazySpatialite) {
+    TestArea ta(TEST_NAME);
+    const auto testFolder = ta.getFolder("test");
+    initIndex(testFolder.string());
+    auto db = ddb::open(testFolder.string(), false);
+
+    // SpatiaLite functions are available without explicit initialization
+    auto q = db->query("SELECT AsText(GeomFromText('POINT(1 2)', 4326))");
+    ASSERT_TRUE(q->fetch());
+    EXPECT_EQ(q->getText(0), "POINT(1 2)");
+
+    // Including from triggers and multi statement exec
+    db.reset();
+    db = ddb::open(testFolder.string(), false);
+    db->exec("INSERT INTO entries (path, type, properties, mtime, size, depth, point_geom) "
+             "VALUES ('a.jpg', 3, '{}', 0, 1, 0, GeomFromText('POINT Z (1 2 3)', 4326)); "
+             "INSERT INTO entries (path, type, properties, mtime, size, depth) VALUES ('b.txt', 2, '{}', 0, 1, 0)");
+    q = db->query("SELECT COUNT(*) FROM entries");
+    ASSERT_TRUE(q->fetch());
+    EXPECT_EQ(q->getInt(0), 2);
+    EXPECT_TRUE(db->getSummary().hasExtent);
+}
+
+}
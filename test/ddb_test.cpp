@@ -2,11 +2,17 @@
  * License, v. 2.0. If a copy of the MPL was not distributed with this
  * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
 
+#include <chrono>
+#include <fstream>
 #include "gtest/gtest.h"
+#include <base64/base64.h>
+#include "binarystamp.h"
 #include "dbops.h"
+#include "ddb.h"
 #include "exceptions.h"
 #include "test.h"
 #include "testarea.h"
+#include "userprofile.h"
 
 namespace {
 
@@ -262,6 +268,291 @@ TEST(deleteFromIndex, fileExactDirtyDotDot) {
 
 }
 
+TEST(addToIndex, multiThreaded) {
+    TestArea ta(TEST_NAME);
+
+    const auto testFolder = ta.getFolder("test");
+    for (int i = 0; i < 50; i++){
+        std::ofstream f((testFolder / ("file" + std::to_string(i) + ".txt")).string());
+        f << "content " << i;
+    }
+
+    initIndex(testFolder.string());
+    auto db = ddb::open(testFolder.string(), false);
+
+    std::vector<std::string> toAdd;
+    for (int i = 0; i < 50; i++) toAdd.emplace_back((testFolder / ("file" + std::to_string(i) + ".txt")).string());
+
+    // Results must be written in the same order as the input
+    std::vector<std::string> added;
+    addToIndex(db.get(), toAdd, [&added](const Entry &e, bool updated){
+        EXPECT_FALSE(updated);
+        added.push_back(e.path);
+        return true;
+    }, 4);
+
+    EXPECT_EQ(countEntries(db.get()), 50);
+    ASSERT_EQ(added.size(), 50);
+    for (int i = 0; i < 50; i++) EXPECT_EQ(added[i], "file" + std::to_string(i) + ".txt");
+
+    // Touch one file, the others should not be updated
+    std::ofstream((testFolder / "file7.txt").string()) << "changed";
+    fs::last_write_time(testFolder / "file7.txt", fs::last_write_time(testFolder / "file7.txt") + std::chrono::seconds(10));
+
+    int updates = 0;
+    addToIndex(db.get(), toAdd, [&updates](const Entry &e, bool updated){
+        EXPECT_TRUE(updated);
+        EXPECT_EQ(e.path, "file7.txt");
+        updates++;
+        return true;
+    }, 4);
+    EXPECT_EQ(updates, 1);
+}
+
+TEST(addToIndex, nestedFolderMultiThreaded) {
+    TestArea ta(TEST_NAME);
+
+    const auto testFolder = ta.getFolder("test");
+    const auto nested = testFolder / "folder";
+    fs::create_directories(nested / "sub" / "subsub");
+    for (const auto &f : {nested / "a.txt", nested / "sub" / "b.txt", nested / "sub" / "subsub" / "c.txt"}){
+        std::ofstream(f.string()) << f.filename().string();
+    }
+
+    initIndex(testFolder.string());
+    auto db = ddb::open(testFolder.string(), false);
+
+    // The expanded list has the nested files, which are walked again
+    // as part of their folders (same as "ddb add -r", with a fixed
+    // thread count so that the pipelined mode is used on any machine)
+    int added = 0;
+    addToIndex(db.get(), expandPathList({nested.string()}, true, 0), [&added](const Entry &, bool){
+        added++;
+        return true;
+    }, 4);
+
+    // 3 folders, 3 files
+    EXPECT_EQ(added, 6);
+    EXPECT_EQ(countEntries(db.get()), 6);
+}
+
+TEST(addToIndex, deterministicOrder) {
+    TestArea ta(TEST_NAME);
+
+    // The same tree, added twice to fresh indexes
+    std::vector<std::vector<std::string>> runs;
+    for (int run = 0; run < 3; run++){
+        const auto testFolder = ta.getFolder("run" + std::to_string(run));
+        for (int d = 0; d < 8; d++){
+            const auto folder = testFolder / ("folder" + std::to_string(d)) / "sub";
+            fs::create_directories(folder);
+            for (int i = 0; i < 10; i++){
+                std::ofstream f((folder / ("file" + std::to_string(i) + ".txt")).string());
+                f << "content " << d << i;
+            }
+        }
+
+        initIndex(testFolder.string());
+        auto db = ddb::open(testFolder.string(), false);
+
+        std::vector<std::string> toAdd;
+        for (int d = 0; d < 8; d++) toAdd.emplace_back((testFolder / ("folder" + std::to_string(d))).string());
+
+        std::vector<std::string> added;
+        addToIndex(db.get(), toAdd, [&added](const Entry &e, bool){
+            added.push_back(e.path);
+            return true;
+        }, run == 2 ? 1 : 4);
+        runs.push_back(added);
+    }
+
+    // 8 folders, 8 subfolders, 80 files
+    ASSERT_EQ(runs[0].size(), 96);
+    EXPECT_EQ(runs[0], runs[1]);
+
+    // Same as the single threaded walk
+    EXPECT_EQ(runs[0], runs[2]);
+}
+
+TEST(addToIndex, bulkLoad) {
+    TestArea ta(TEST_NAME);
+
+    const auto testFolder = ta.getFolder("test");
+    for (int i = 0; i < 50; i++){
+        std::ofstream f((testFolder / ("file" + std::to_string(i) + ".txt")).string());
+        f << "content " << i;
+    }
+
+    initIndex(testFolder.string());
+    auto db = ddb::open(testFolder.string(), false);
+
+    const auto defaults = UserProfile::get()->getBulkLoadSettings();
+    BulkLoadSettings settings;
+    settings.minPaths = 10;
+    UserProfile::get()->setBulkLoadSettings(settings);
+
+    std::vector<std::string> toAdd;
+    for (int i = 0; i < 50; i++) toAdd.emplace_back((testFolder / ("file" + std::to_string(i) + ".txt")).string());
+
+    bool bulkLoaded = false;
+    bool indexed = true;
+    bool propertiesIndexed = true;
+    addToIndex(db.get(), toAdd, [&](const Entry &, bool){
+        if (!db->isBulkLoading()) return true;
+        bulkLoaded = true;
+
+        // Path indexes are dropped during the load, property indexes are kept
+        auto q = db->query("SELECT COUNT(*) FROM sqlite_master WHERE name = 'ix_entries_lower_path'");
+        if (q->fetch() && q->getInt(0) != 0) indexed = false;
+        q = db->query("SELECT COUNT(*) FROM sqlite_master WHERE name = 'ix_entries_make'");
+        if (q->fetch() && q->getInt(0) == 0) propertiesIndexed = false;
+        return true;
+    });
+    UserProfile::get()->setBulkLoadSettings(defaults);
+
+    EXPECT_TRUE(bulkLoaded);
+    EXPECT_TRUE(indexed);
+    EXPECT_TRUE(propertiesIndexed);
+    EXPECT_FALSE(db->isBulkLoading());
+    EXPECT_EQ(countEntries(db.get()), 50);
+
+    // Indexes and durable settings are restored
+    auto q = db->query("SELECT COUNT(*) FROM sqlite_master WHERE name IN ('ix_entries_lower_path', 'ix_entries_type', 'idx_entries_point_geom')");
+    ASSERT_TRUE(q->fetch());
+    EXPECT_EQ(q->getInt(0), 3);
+    q = db->query("PRAGMA synchronous");
+    ASSERT_TRUE(q->fetch());
+    EXPECT_NE(q->getInt(0), 0);
+    q = db->query("SELECT COUNT(*) FROM sqlite_stat1");
+    ASSERT_TRUE(q->fetch());
+    EXPECT_GT(q->getInt(0), 0);
+}
+
+TEST(addToIndex, bulkLoadSingleFolder) {
+    TestArea ta(TEST_NAME);
+
+    const auto testFolder = ta.getFolder("test");
+    const auto survey = testFolder / "survey";
+    create_directory(survey);
+    for (int i = 0; i < 50; i++){
+        std::ofstream f((survey / ("file" + std::to_string(i) + ".txt")).string());
+        f << "content " << i;
+    }
+
+    initIndex(testFolder.string());
+    auto db = ddb::open(testFolder.string(), false);
+
+    const auto defaults = UserProfile::get()->getBulkLoadSettings();
+    BulkLoadSettings settings;
+    settings.minPaths = 10;
+    UserProfile::get()->setBulkLoadSettings(settings);
+
+    // A single path, the walked paths are counted before adding
+    std::vector<bool> bulkLoading;
+    addToIndex(db.get(), {survey.string()}, [&db, &bulkLoading](const Entry &, bool){
+        bulkLoading.push_back(db->isBulkLoading());
+        return true;
+    });
+
+    // The folder and its files, all added in one transaction
+    ASSERT_EQ(bulkLoading.size(), 51);
+    EXPECT_TRUE(bulkLoading.front());
+    EXPECT_TRUE(bulkLoading.back());
+    EXPECT_FALSE(db->isBulkLoading());
+    EXPECT_EQ(countEntries(db.get()), 51);
+
+    // Fewer paths than minPaths
+    removeFromIndex(db.get(), {survey.string()});
+    ASSERT_EQ(countEntries(db.get()), 0);
+    settings.minPaths = 100;
+    UserProfile::get()->setBulkLoadSettings(settings);
+
+    bulkLoading.clear();
+    addToIndex(db.get(), {survey.string()}, [&db, &bulkLoading](const Entry &, bool){
+        bulkLoading.push_back(db->isBulkLoading());
+        return true;
+    });
+    UserProfile::get()->setBulkLoadSettings(defaults);
+
+    ASSERT_EQ(bulkLoading.size(), 51);
+    EXPECT_FALSE(bulkLoading.front());
+    EXPECT_FALSE(bulkLoading.back());
+}
+
+TEST(addToIndex, bulkLoadCancel) {
+    TestArea ta(TEST_NAME);
+
+    const auto testFolder = ta.getFolder("test");
+    const auto survey = testFolder / "survey";
+    create_directory(survey);
+    for (int i = 0; i < 50; i++){
+        std::ofstream f((survey / ("file" + std::to_string(i) + ".txt")).string());
+        f << "content " << i;
+    }
+
+    initIndex(testFolder.string());
+    auto db = ddb::open(testFolder.string(), false);
+
+    const auto defaults = UserProfile::get()->getBulkLoadSettings();
+    BulkLoadSettings settings;
+    settings.minPaths = 10;
+    UserProfile::get()->setBulkLoadSettings(settings);
+
+    int added = 0;
+    addToIndex(db.get(), {survey.string()}, [&added](const Entry &, bool){
+        return ++added < 20;
+    });
+    UserProfile::get()->setBulkLoadSettings(defaults);
+
+    // Entries added before cancelling are committed and the indexes restored
+    EXPECT_FALSE(db->isBulkLoading());
+    EXPECT_EQ(countEntries(db.get()), 20);
+    auto q = db->query("SELECT COUNT(*) FROM sqlite_master WHERE name IN ('ix_entries_lower_path', 'ix_entries_type', 'idx_entries_point_geom')");
+    ASSERT_TRUE(q->fetch());
+    EXPECT_EQ(q->getInt(0), 3);
+
+    // No transaction is left open
+    addToIndex(db.get(), {survey.string()});
+    EXPECT_EQ(countEntries(db.get()), 51);
+}
+
+// Initial add of a synthetic survey, with and without bulk load mode
+TEST(addToIndex, DISABLED_bulkLoadBenchmark) {
+    TestArea ta(TEST_NAME);
+    const int count = 20000;
+
+    const auto source = ta.getFolder("source");
+    for (int i = 0; i < count; i++){
+        const auto folder = source / ("folder" + std::to_string(i / 1000));
+        if (i % 1000 == 0) create_directory(folder);
+        std::ofstream f((folder / ("file" + std::to_string(i) + ".txt")).string());
+        f << "content " << i;
+    }
+
+    const auto defaults = UserProfile::get()->getBulkLoadSettings();
+
+    for (const bool bulk : {false, true}){
+        const auto testFolder = ta.getFolder(bulk ? "bulk" : "normal");
+        fs::copy(source, testFolder, fs::copy_options::recursive | fs::copy_options::overwrite_existing);
+        initIndex(testFolder.string());
+        auto db = ddb::open(testFolder.string(), false);
+
+        BulkLoadSettings settings;
+        settings.enabled = bulk;
+        settings.minPaths = 0;
+        UserProfile::get()->setBulkLoadSettings(settings);
+
+        const auto start = std::chrono::steady_clock::now();
+        addToIndex(db.get(), expandPathList({testFolder.string()}, true, 0));
+        const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+        EXPECT_GE(countEntries(db.get()), count);
+        std::cout << (bulk ? "bulk load: " : "normal load: ") << ms << " ms" << std::endl;
+    }
+
+    UserProfile::get()->setBulkLoadSettings(defaults);
+}
+
 TEST(listIndex, fileExact) {
     TestArea ta(TEST_NAME);
 
@@ -636,6 +927,170 @@ TEST(listIndex, wildcardRecursiveWithLimit) {
 
 }
 
+TEST(listIndex, cursor) {
+    TestArea ta(TEST_NAME);
+
+    const auto sqlite = ta.downloadTestAsset("https://github.com/DroneDB/test_data/raw/master/ddb-remove-test/.ddb/dbase.sqlite", "dbase.sqlite");
+
+    const auto testFolder = ta.getFolder("test");
+    create_directory(testFolder / ".ddb");
+    fs::copy(sqlite.string(), testFolder / ".ddb", fs::copy_options::overwrite_existing);
+
+    auto db = ddb::open(testFolder.string(), false);
+
+    std::vector<std::string> toList;
+    toList.emplace_back((testFolder / "pics").string());
+
+    std::ostringstream out;
+    listIndex(db.get(), toList, out, "json", true);
+    const auto expected = json::parse(out.str());
+
+    auto cursor = listIndexCursor(db.get(), toList, true);
+    std::vector<std::string> paths;
+    Entry e;
+    while (cursor->next(e)) {
+        json j;
+        e.toJSON(j);
+        EXPECT_EQ(j, expected[paths.size()]);
+        paths.push_back(e.path);
+    }
+
+    EXPECT_EQ(paths.size(), expected.size());
+    EXPECT_TRUE(std::is_sorted(paths.begin(), paths.end()));
+    EXPECT_FALSE(cursor->next(e));
+}
+
+TEST(searchIndex, sorted) {
+    TestArea ta(TEST_NAME);
+
+    const auto sqlite = ta.downloadTestAsset("https://github.com/DroneDB/test_data/raw/master/ddb-remove-test/.ddb/dbase.sqlite", "dbase.sqlite");
+
+    const auto testFolder = ta.getFolder("test");
+    create_directory(testFolder / ".ddb");
+    fs::copy(sqlite.string(), testFolder / ".ddb", fs::copy_options::overwrite_existing);
+
+    auto db = ddb::open(testFolder.string(), false);
+
+    std::ostringstream out;
+    searchIndex(db.get(), "pics2/pics/*", out, "text");
+
+    EXPECT_EQ(out.str(), "pics2/pics/IMG_20160826_181302.jpg\npics2/pics/IMG_20160826_181305.jpg\npics2/pics/IMG_20160826_181309.jpg\npics2/pics/IMG_20160826_181314.jpg\npics2/pics/IMG_20160826_181317.jpg\npics2/pics/pics2\npics2/pics/pics2/IMG_20160826_181305.jpg\npics2/pics/pics2/IMG_20160826_181309.jpg\n");
+}
+
+TEST(searchIndex, intersects) {
+    TestArea ta(TEST_NAME);
+    const auto testFolder = ta.getFolder("test");
+    initIndex(testFolder.string());
+    auto db = ddb::open(testFolder.string(), false);
+
+    auto q = db->query("SELECT COUNT(*) FROM geometry_columns WHERE f_table_name = 'entries' AND spatial_index_enabled = 1");
+    ASSERT_TRUE(q->fetch());
+    EXPECT_EQ(q->getInt(0), 2);
+
+    db->exec("INSERT INTO entries (path, type, depth, point_geom) VALUES ('a.jpg', 3, 0, MakePointZ(10, 20, 0, 4326))");
+    db->exec("INSERT INTO entries (path, type, depth, point_geom) VALUES ('far.jpg', 3, 0, MakePointZ(50, 50, 0, 4326))");
+    db->exec("INSERT INTO entries (path, type, depth, polygon_geom) VALUES ('b.tif', 4, 0, GeomFromText('POLYGONZ((9 19 0, 12 19 0, 12 25 0, 9 25 0, 9 19 0))', 4326))");
+    db->exec("INSERT INTO entries (path, type, depth) VALUES ('c.txt', 2, 0)");
+
+    std::ostringstream out;
+    searchIndex(db.get(), "*", out, "text", bboxToWkt(9.5, 19.5, 10.5, 20.5));
+    EXPECT_EQ(out.str(), "a.jpg\nb.tif\n");
+
+    out.str("");
+    searchIndex(db.get(), "*.tif", out, "text", "POINT(11 24)");
+    EXPECT_EQ(out.str(), "b.tif\n");
+
+    out.str("");
+    searchIndex(db.get(), "*", out, "text", bboxToWkt(-10, -10, 0, 0));
+    EXPECT_EQ(out.str(), "");
+
+    EXPECT_THROW(searchIndex(db.get(), "*", out, "text", "NOT A GEOMETRY"), InvalidArgsException);
+    EXPECT_THROW(bboxToWkt(1, 0, 0, 1), InvalidArgsException);
+}
+
+TEST(listIndex, cIterator) {
+    TestArea ta(TEST_NAME);
+
+    const auto sqlite = ta.downloadTestAsset("https://github.com/DroneDB/test_data/raw/master/ddb-remove-test/.ddb/dbase.sqlite", "dbase.sqlite");
+
+    const auto testFolder = ta.getFolder("test");
+    create_directory(testFolder / ".ddb");
+    fs::copy(sqlite.string(), testFolder / ".ddb", fs::copy_options::overwrite_existing);
+
+    const auto ddbPath = testFolder.string();
+    const auto listPath = (testFolder / "pics2").string();
+    const char *paths[] = { listPath.c_str() };
+
+    DDBEntryCursor *cursor = nullptr;
+    ASSERT_EQ(DDBListOpen(ddbPath.c_str(), paths, 1, false, 0, &cursor), DDBERR_NONE);
+
+    std::vector<std::string> listed;
+    bool hasNext = true;
+    while (true) {
+        char *output = nullptr;
+        ASSERT_EQ(DDBCursorNext(cursor, &output, &hasNext), DDBERR_NONE);
+        if (!hasNext) break;
+
+        listed.push_back(json::parse(output)["path"].get<std::string>());
+        free(output);
+    }
+
+    EXPECT_EQ(DDBCursorClose(cursor), DDBERR_NONE);
+    EXPECT_EQ(listed, std::vector<std::string>({"pics2/IMG_20160826_181305.jpg", "pics2/IMG_20160826_181309.jpg", "pics2/pics"}));
+
+    EXPECT_EQ(DDBSearchOpen(ddbPath.c_str(), nullptr, &cursor), DDBERR_EXCEPTION);
+}
+
+TEST(searchIndex, cFiltered) {
+    TestArea ta(TEST_NAME);
+
+    const auto sqlite = ta.downloadTestAsset("https://github.com/DroneDB/test_data/raw/master/ddb-remove-test/.ddb/dbase.sqlite", "dbase.sqlite");
+
+    const auto testFolder = ta.getFolder("test");
+    create_directory(testFolder / ".ddb");
+    fs::copy(sqlite.string(), testFolder / ".ddb", fs::copy_options::overwrite_existing);
+
+    const auto ddbPath = testFolder.string();
+
+    char *output = nullptr;
+    ASSERT_EQ(DDBSearch(ddbPath.c_str(), "pics2/*", &output, "text"), DDBERR_NONE);
+    const std::string all(output);
+    free(output);
+
+    ASSERT_EQ(DDBSearchFiltered(ddbPath.c_str(), "pics2/*", &output, "text", nullptr, nullptr), DDBERR_NONE);
+    EXPECT_EQ(std::string(output), all);
+    free(output);
+
+    EXPECT_EQ(DDBSearchFiltered(ddbPath.c_str(), "pics2/*", &output, "text", nullptr, "make = 'DJI"), DDBERR_EXCEPTION);
+
+    DDBEntryCursor *cursor = nullptr;
+    EXPECT_EQ(DDBSearchOpenFiltered(ddbPath.c_str(), "pics2/*", &cursor, nullptr, "make = 'DJI"), DDBERR_EXCEPTION);
+}
+
+TEST(delta, cStamps) {
+    const std::string stamp = R"({"checksum": "abc", "entries": [{"a.txt": "h1"}], "meta": []})";
+    const std::string empty = R"({"checksum": "def", "entries": [], "meta": []})";
+
+    Stamp s;
+    s.entries.emplace_back("a.txt", "h1");
+    const auto binary = Base64::encode(encodeBinaryStamp(s));
+
+    char *output = nullptr;
+    ASSERT_EQ(DDBDelta(stamp.c_str(), empty.c_str(), &output, "json"), DDBERR_NONE);
+    const std::string expected(output);
+    free(output);
+
+    ASSERT_EQ(DDBDelta(binary.c_str(), empty.c_str(), &output, "json"), DDBERR_NONE);
+    EXPECT_EQ(std::string(output), expected);
+    free(output);
+
+    // Input that is neither JSON nor a binary stamp fails to parse as JSON
+    for (const std::string invalid : {"", "[", "not a stamp"}) {
+        EXPECT_EQ(DDBDelta(invalid.c_str(), empty.c_str(), &output, "json"), DDBERR_EXCEPTION);
+        EXPECT_NE(std::string(DDBGetLastError()).find("Invalid stamp"), std::string::npos) << invalid;
+    }
+}
+
 TEST(fingerprint, fileHandle) {
     TestArea ta(TEST_NAME);
     fs::path ortho = ta.downloadTestAsset("https://github.com/DroneDB/test_data/raw/master/brighton/odm_orthophoto.tif",
@@ -796,4 +1251,100 @@ TEST(moveEntry, badParameters2) {
 
 }
 
+TEST(moveEntry, folderWithMeta) {
+    TestArea ta(TEST_NAME);
+
+    const auto sqlite = ta.downloadTestAsset("https://github.com/DroneDB/test_data/raw/master/ddb-remove-test/.ddb/dbase.sqlite", "dbase.sqlite");
+
+    const auto testFolder = ta.getFolder("test");
+    create_directory(testFolder / ".ddb");
+    fs::copy(sqlite.string(), testFolder / ".ddb", fs::copy_options::overwrite_existing);
+
+    auto db = ddb::open(testFolder.string(), false);
+
+    db->getMetaManager()->add("tags", "\"a\"", "pics2/IMG_20160826_181305.jpg", testFolder.string());
+
+    ASSERT_THROW(moveEntry(db.get(), "pics2", "pics2/sub"), InvalidArgsException);
+
+    moveEntry(db.get(), "pics2", "new/deep/pics2");
+
+    EXPECT_EQ(countEntries(db.get(), "pics2"), 0);
+    EXPECT_EQ(countEntries(db.get(), "new"), 1);
+    EXPECT_EQ(countEntries(db.get(), "new/deep"), 1);
+    EXPECT_EQ(countEntries(db.get(), "new/deep/pics2/pics/pics2/IMG_20160826_181309.jpg"), 1);
+
+    Entry e;
+    ASSERT_TRUE(getEntry(db.get(), "new/deep/pics2/pics/pics2", e));
+    EXPECT_EQ(e.depth, 4);
+
+    auto q = db->query("SELECT path FROM entries_meta WHERE key = 'tags'");
+    ASSERT_TRUE(q->fetch());
+    EXPECT_EQ(q->getText(0), "new/deep/pics2/IMG_20160826_181305.jpg");
+
+    // Folder deletes remove meta as well
+    std::vector<std::string> toRemove;
+    toRemove.emplace_back((testFolder / "new").string());
+    removeFromIndex(db.get(), toRemove);
+
+    EXPECT_EQ(countEntries(db.get(), "new/deep/pics2/IMG_20160826_181305.jpg"), 0);
+    q = db->query("SELECT COUNT(*) FROM entries_meta WHERE key = 'tags'");
+    ASSERT_TRUE(q->fetch());
+    EXPECT_EQ(q->getInt(0), 0);
+}
+
+// Synthetic index with 100k entries (10 folders x 100 subfolders x 100 files)
+// and one meta row per file of the moved folder.
+// Run with --gtest_also_run_disabled_tests
+TEST(moveEntry, DISABLED_benchmark) {
+    TestArea ta(TEST_NAME);
+    const auto testFolder = ta.getFolder("test");
+    initIndex(testFolder.string());
+    auto db = ddb::open(testFolder.string(), false);
+
+    db->exec("BEGIN TRANSACTION");
+    auto q = db->query("INSERT INTO entries (path, type, depth) VALUES (?, ?, ?)");
+    auto metaQ = db->query("INSERT INTO entries_meta (id, path, key, data, mtime) VALUES (?, ?, 'tags', '\"a\"', 0)");
+    const auto insert = [&q](const std::string &path, EntryType type, int depth) {
+        q->bind(1, path);
+        q->bind(2, static_cast<int>(type));
+        q->bind(3, depth);
+        q->execute();
+    };
+
+    for (int i = 0; i < 10; i++) {
+        const auto a = "folder" + std::to_string(i);
+        insert(a, EntryType::Directory, 0);
+        for (int j = 0; j < 100; j++) {
+            const auto b = a + "/sub" + std::to_string(j);
+            insert(b, EntryType::Directory, 1);
+            for (int k = 0; k < 100; k++) {
+                const auto c = b + "/IMG_" + std::to_string(k) + ".JPG";
+                insert(c, EntryType::Image, 2);
+                if (i == 0) {
+                    metaQ->bind(1, c);
+                    metaQ->bind(2, c);
+                    metaQ->execute();
+                }
+            }
+        }
+    }
+    db->exec("COMMIT");
+
+    const auto time = [](const std::string &label, const std::function<void()> &f) {
+        const auto start = std::chrono::steady_clock::now();
+        f();
+        const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+        std::cout << label << ": " << ms << " ms" << std::endl;
+    };
+
+    time("moveEntry folder", [&]() {
+        moveEntry(db.get(), "folder0", "moved/folder0");
+    });
+    EXPECT_EQ(countEntries(db.get(), "moved/folder0/sub50/IMG_50.JPG"), 1);
+
+    time("deleteFromIndex folder", [&]() {
+        EXPECT_EQ(deleteFromIndex(db.get(), "moved/folder0", true), 100 * 100 + 100);
+    });
+}
+
 }
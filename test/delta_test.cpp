@@ -0,0 +1,205 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include <chrono>
+#include <sstream>
+#include "binarystamp.h"
+#include "delta.h"
+#include "exceptions.h"
+#include "gtest/gtest.h"
+#include "test.h"
+
+namespace {
+
+using namespace ddb;
+
+json makeStamp(const std::vector<std::pair<std::string, std::string>> &entries,
+               const std::vector<std::string> &meta) {
+    json j;
+    j["entries"] = json::array();
+    for (const auto &e : entries) j["entries"].push_back(json::object({{e.first, e.second}}));
+    j["meta"] = meta;
+    j["checksum"] = "abc";
+    return j;
+}
+
+TEST(delta, mergeJoin) {
+    const auto source = makeStamp({{"a", ""}, {"a/1.jpg", "h1"}, {"a/2.jpg", "h2b"},
+                                   {"b", "h3"}, {"d", ""}},
+                                  {"m1", "m2"});
+    const auto target = makeStamp({{"a", ""}, {"a/2.jpg", "h2"}, {"a/3.jpg", "h3"},
+                                   {"b", ""}, {"c", ""}, {"c/4.jpg", "h4"}},
+                                  {"m2", "m3"});
+
+    const auto d = getDelta(source, target);
+
+    ASSERT_EQ(d.adds.size(), 4);
+    EXPECT_EQ(d.adds[0].path, "a/1.jpg");
+    EXPECT_EQ(d.adds[1].path, "a/2.jpg");
+    EXPECT_EQ(d.adds[1].hash, "h2b");
+    EXPECT_EQ(d.adds[2].path, "b");
+    EXPECT_EQ(d.adds[3].path, "d");
+
+    ASSERT_EQ(d.removes.size(), 4);
+    EXPECT_EQ(d.removes[0].path, "c/4.jpg");
+    EXPECT_EQ(d.removes[1].path, "c");
+    EXPECT_EQ(d.removes[2].path, "b");
+    EXPECT_TRUE(d.removes[2].isDirectory());
+    EXPECT_EQ(d.removes[3].path, "a/3.jpg");
+
+    EXPECT_EQ(d.metaAdds, std::vector<std::string>({"m1"}));
+    EXPECT_EQ(d.metaRemoves, std::vector<std::string>({"m3"}));
+
+    EXPECT_TRUE(getDelta(source, source).empty());
+}
+
+TEST(delta, readStamp) {
+    // Entries do not need to be sorted
+    const auto stamp = makeStamp({{"b", "h2"}, {"a", ""}, {"a/1.jpg", "h1"}}, {"m2", "m1"});
+
+    std::istringstream in(stamp.dump());
+    const auto s = readStamp(in);
+    ASSERT_EQ(s.entries.size(), 3);
+    EXPECT_EQ(s.entries[0].path, "a");
+    EXPECT_EQ(s.entries[1].path, "a/1.jpg");
+    EXPECT_EQ(s.entries[1].hash, "h1");
+    EXPECT_EQ(s.entries[2].path, "b");
+    EXPECT_EQ(s.meta, std::vector<std::string>({"m1", "m2"}));
+    EXPECT_EQ(s.checksum, "abc");
+
+    const auto p = parseStamp(stamp);
+    EXPECT_EQ(p.entries.size(), s.entries.size());
+    EXPECT_EQ(p.meta, s.meta);
+
+    std::istringstream empty(R"({"entries": [], "meta": []})");
+    std::istringstream other(stamp.dump());
+    EXPECT_EQ(getDelta(other, empty).adds.size(), 3);
+
+    std::istringstream noMeta(R"({"entries": []})");
+    EXPECT_THROW(readStamp(noMeta), InvalidArgsException);
+
+    std::istringstream invalid(R"({"entries": [)");
+    EXPECT_THROW(readStamp(invalid), InvalidArgsException);
+}
+
+TEST(delta, binaryStamp) {
+    const std::string h1 = "b94d27b9934d3e08a52e52d7da7dabfac484efe37a5380ee9088f7ace2efcde9";
+    const std::string h2 = "9f86d081884c7d659a2feaa0c55ad015a3bf4f1b2b0b822cd15d6c15b0f00a08";
+    const auto stamp = makeStamp({{"a", ""}, {"a/1.jpg", h1}, {"a/10.jpg", h2}, {"b.txt", "notasha"}},
+                                 {"m2", "m1"});
+    const auto s = parseStamp(stamp);
+
+    const auto data = encodeBinaryStamp(s);
+    EXPECT_LT(data.size(), stamp.dump().size());
+
+    BinaryStamp b(data.data(), data.size());
+    EXPECT_EQ(b.entries(), 4);
+    EXPECT_EQ(b.meta(), std::vector<std::string>({"m1", "m2"}));
+
+    // Invalid checksums are replaced with the checksum of the stamp
+    EXPECT_EQ(b.checksum().length(), 64);
+    EXPECT_NE(b.checksum(), "abc");
+
+    auto r = b.reader();
+    ASSERT_TRUE(r.next());
+    EXPECT_EQ(r.path(), "a");
+    EXPECT_TRUE(r.isDirectory());
+    ASSERT_TRUE(r.next());
+    EXPECT_EQ(r.path(), "a/1.jpg");
+    EXPECT_EQ(r.hash(), h1);
+    EXPECT_NE(r.digest(), nullptr);
+    ASSERT_TRUE(r.next());
+    EXPECT_EQ(r.path(), "a/10.jpg");
+    EXPECT_EQ(r.hash(), h2);
+    ASSERT_TRUE(r.next());
+    EXPECT_EQ(r.path(), "b.txt");
+    EXPECT_EQ(r.hash(), "notasha");
+    EXPECT_EQ(r.digest(), nullptr);
+    EXPECT_FALSE(r.next());
+
+    auto j = b.toJSON();
+    EXPECT_EQ(j["entries"], stamp["entries"]);
+
+    // Binary stamps are accepted wherever JSON stamps are
+    const auto other = makeStamp({{"a", ""}, {"a/1.jpg", h2}}, {"m1"});
+    const auto expected = json(getDelta(other, stamp)).dump();
+    const auto otherData = encodeBinaryStamp(parseStamp(other));
+    BinaryStamp ob(otherData.data(), otherData.size());
+
+    EXPECT_EQ(json(getDelta(ob, b)).dump(), expected);
+    EXPECT_EQ(json(getDelta(parseStamp(other), b)).dump(), expected);
+    EXPECT_EQ(json(getDelta(ob, s)).dump(), expected);
+
+    std::istringstream in(otherData);
+    std::istringstream jsonIn(stamp.dump());
+    EXPECT_EQ(json(getDelta(in, jsonIn)).dump(), expected);
+
+    EXPECT_THROW(BinaryStamp(data.data(), 40), AppException);
+    std::string truncated = data;
+    truncated.erase(40, 20);
+    EXPECT_THROW(BinaryStamp(truncated.data(), truncated.size()), AppException);
+
+    // Any change to the encoded bytes is caught when the stamp is read
+    for (size_t i : {size_t(8), size_t(40), data.size() - 40, data.size() - 1}) {
+        std::string corrupted = data;
+        corrupted[i] ^= 1;
+        EXPECT_THROW(BinaryStamp(corrupted.data(), corrupted.size()), AppException) << i;
+    }
+}
+
+std::string fakeHash(int i) {
+    char buf[65];
+    snprintf(buf, sizeof(buf), "%064x", i);
+    return buf;
+}
+
+TEST(delta, DISABLED_benchmark) {
+    const int count = 1000000;
+
+    std::ostringstream source, target;
+    source << R"({"checksum":"","entries":[)";
+    target << R"({"checksum":"","entries":[)";
+    for (int i = 0; i < count; i++) {
+        const std::string path = "folder" + std::to_string(i / 1000) + "/" + std::to_string(i) + ".jpg";
+        if (i > 0) source << ",";
+        if (i > 0) target << ",";
+        source << "{\"" << path << "\":\"" << fakeHash(i) << "\"}";
+        target << "{\"" << path << "\":\"" << fakeHash(i % 100 == 0 ? i + count : i) << "\"}";
+    }
+    source << R"(],"meta":[]})";
+    target << R"(],"meta":[]})";
+
+    auto start = std::chrono::high_resolution_clock::now();
+    const json sourceStamp = json::parse(source.str());
+    const json targetStamp = json::parse(target.str());
+    auto parsed = std::chrono::high_resolution_clock::now();
+    auto d = getDelta(sourceStamp, targetStamp);
+    auto end = std::chrono::high_resolution_clock::now();
+
+    EXPECT_EQ(d.adds.size(), count / 100);
+    std::cout << "json parse: " << std::chrono::duration_cast<std::chrono::milliseconds>(parsed - start).count() << " ms" << std::endl;
+    std::cout << "getDelta(json): " << std::chrono::duration_cast<std::chrono::milliseconds>(end - parsed).count() << " ms" << std::endl;
+
+    std::istringstream sourceIn(source.str());
+    std::istringstream targetIn(target.str());
+    start = std::chrono::high_resolution_clock::now();
+    d = getDelta(sourceIn, targetIn);
+    end = std::chrono::high_resolution_clock::now();
+
+    EXPECT_EQ(d.adds.size(), count / 100);
+    std::cout << "getDelta(stream): " << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() << " ms" << std::endl;
+
+    const auto sourceData = encodeBinaryStamp(parseStamp(sourceStamp));
+    const auto targetData = encodeBinaryStamp(parseStamp(targetStamp));
+    std::cout << "json size: " << source.str().size() / 1024 << " KB, binary size: " << sourceData.size() / 1024 << " KB" << std::endl;
+
+    start = std::chrono::high_resolution_clock::now();
+    d = getDelta(BinaryStamp(sourceData.data(), sourceData.size()), BinaryStamp(targetData.data(), targetData.size()));
+    end = std::chrono::high_resolution_clock::now();
+
+    EXPECT_EQ(d.adds.size(), count / 100);
+    std::cout << "getDelta(binary): " << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() << " ms" << std::endl;
+}
+
+}
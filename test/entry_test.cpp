@@ -2,8 +2,12 @@
  * License, v. 2.0. If a copy of the MPL was not distributed with this
  * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
 
+#include <chrono>
 #include "gtest/gtest.h"
 #include "entry.h"
+#include "parsecontext.h"
+#include "test.h"
+#include "testarea.h"
 
 namespace{
 
@@ -21,6 +25,74 @@ TEST(calculateFootprint, Normal) {
 	EXPECT_STREQ(geom.toWkt().c_str(), "POLYGONZ ((-91.994308101 46.84345864217 98.31, -91.99431905836 46.84287152156 98.31, -91.99300336858 46.84285995357 98.31, -91.99299239689 46.84344707395 98.31, -91.994308101 46.84345864217 98.31))");
 }
 
+// Images of a survey across the border of two UTM zones (15N, 16N)
+void makeSurvey(size_t count, std::vector<SensorSize> &sensorSizes, std::vector<GeoLocation> &geos,
+                std::vector<Focal> &focals, std::vector<CameraOrientation> &cameraOris, std::vector<double> &relAltitudes) {
+    for (size_t i = 0; i < count; i++) {
+        sensorSizes.emplace_back(6.17 + (i % 3) * 0.5, 4.55);
+        geos.emplace_back(46.84 + (i % 100) * 0.0005, -90.01 + (i / 100) * 0.0005, i % 7 == 0 ? 0.0 : 198.31);
+        focals.emplace_back(4.5 + (i % 5), 0);
+        cameraOris.emplace_back(i % 11 == 0 ? -10.0 : -90.0 + (i % 40), (i % 360) - 180.0, (i % 9) - 4.0);
+        relAltitudes.push_back(50.0 + (i % 13) * 5);
+    }
+}
+
+TEST(calculateFootprints, Normal) {
+    std::vector<SensorSize> sensorSizes;
+    std::vector<GeoLocation> geos;
+    std::vector<Focal> focals;
+    std::vector<CameraOrientation> cameraOris;
+    std::vector<double> relAltitudes;
+    makeSurvey(1000, sensorSizes, geos, focals, cameraOris, relAltitudes);
+
+    std::vector<BasicPolygonGeometry> geoms;
+    calculateFootprints(sensorSizes, geos, focals, cameraOris, relAltitudes, geoms);
+    ASSERT_EQ(geoms.size(), geos.size());
+
+    for (size_t i = 0; i < geos.size(); i++) {
+        BasicPolygonGeometry expected;
+        calculateFootprint(sensorSizes[i], geos[i], focals[i], cameraOris[i], relAltitudes[i], expected);
+
+        ASSERT_EQ(geoms[i].size(), expected.size());
+        for (int p = 0; p < expected.size(); p++) {
+            EXPECT_NEAR(geoms[i].getPoint(p).x, expected.getPoint(p).x, 1e-9);
+            EXPECT_NEAR(geoms[i].getPoint(p).y, expected.getPoint(p).y, 1e-9);
+            EXPECT_DOUBLE_EQ(geoms[i].getPoint(p).z, expected.getPoint(p).z);
+        }
+    }
+
+    relAltitudes.pop_back();
+    EXPECT_THROW(calculateFootprints(sensorSizes, geos, focals, cameraOris, relAltitudes, geoms), InvalidArgsException);
+}
+
+TEST(calculateFootprints, DISABLED_benchmark) {
+    const size_t count = 10000;
+    std::vector<SensorSize> sensorSizes;
+    std::vector<GeoLocation> geos;
+    std::vector<Focal> focals;
+    std::vector<CameraOrientation> cameraOris;
+    std::vector<double> relAltitudes;
+    makeSurvey(count, sensorSizes, geos, focals, cameraOris, relAltitudes);
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<BasicPolygonGeometry> scalar(count);
+    for (size_t i = 0; i < count; i++) {
+        calculateFootprint(sensorSizes[i], geos[i], focals[i], cameraOris[i], relAltitudes[i], scalar[i]);
+    }
+    const auto scalarMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    std::vector<BasicPolygonGeometry> batch;
+    calculateFootprints(sensorSizes, geos, focals, cameraOris, relAltitudes, batch);
+    const auto batchMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+    ASSERT_EQ(batch.size(), count);
+    EXPECT_NEAR(batch[count - 1].getPoint(0).x, scalar[count - 1].getPoint(0).x, 1e-9);
+    std::cout << count << " footprints" << std::endl;
+    std::cout << "calculateFootprint: " << scalarMs << " ms" << std::endl;
+    std::cout << "calculateFootprints: " << batchMs << " ms" << std::endl;
+}
+
 TEST(parseJsonGeometries, Normal){
     Entry e;
     e.parsePointGeometry("[1, 2, 3]");
@@ -30,4 +102,151 @@ TEST(parseJsonGeometries, Normal){
     EXPECT_EQ(e.polygon_geom.size(), 2);
 }
 
+// SpatiaLite blob header: start, endianness, SRID, MBR, MBR end, class
+std::string spatialiteHeader(uint32_t classType) {
+    std::string b;
+    b.push_back(0x00);
+    b.push_back(0x01);
+    const int32_t srid = 4326;
+    b.append(reinterpret_cast<const char *>(&srid), 4);
+    b.append(32, '\0');
+    b.push_back(0x7C);
+    b.append(reinterpret_cast<const char *>(&classType), 4);
+    return b;
+}
+
+template <typename T> void append(std::string &b, T v) {
+    b.append(reinterpret_cast<const char *>(&v), sizeof(T));
+}
+
+TEST(parseBlobGeometries, Normal) {
+    BasicPointGeometry point;
+    point.addPoint(-91.99, 46.84, 198.31);
+    BasicPointGeometry p;
+    const auto pointWkb = point.toWkb();
+    EXPECT_EQ(pointWkb.size(), 29);
+    p.fromBlob(pointWkb.data(), pointWkb.size());
+    ASSERT_EQ(p.size(), 1);
+    EXPECT_DOUBLE_EQ(p.points[0].x, -91.99);
+    EXPECT_DOUBLE_EQ(p.points[0].y, 46.84);
+    EXPECT_DOUBLE_EQ(p.points[0].z, 198.31);
+
+    BasicPolygonGeometry polygon;
+    polygon.addPoint(0, 0, 1);
+    polygon.addPoint(1, 0, 2);
+    polygon.addPoint(1, 1, 3);
+    polygon.addPoint(0, 0, 1);
+    BasicPolygonGeometry poly;
+    const auto polygonWkb = polygon.toWkb();
+    poly.fromBlob(polygonWkb.data(), polygonWkb.size());
+    ASSERT_EQ(poly.size(), 4);
+    EXPECT_DOUBLE_EQ(poly.points[2].x, 1);
+    EXPECT_DOUBLE_EQ(poly.points[2].z, 3);
+
+    EXPECT_TRUE(BasicPointGeometry().toWkb().empty());
+    poly.fromBlob(nullptr, 0);
+    EXPECT_TRUE(poly.empty());
+
+    // SpatiaLite POINT Z
+    std::string b = spatialiteHeader(1001);
+    append(b, 1.5);
+    append(b, 2.5);
+    append(b, 3.5);
+    b.push_back(static_cast<char>(0xFE));
+    p.fromBlob(b.data(), b.size());
+    ASSERT_EQ(p.size(), 1);
+    EXPECT_DOUBLE_EQ(p.points[0].y, 2.5);
+    EXPECT_DOUBLE_EQ(p.points[0].z, 3.5);
+
+    // SpatiaLite compressed POLYGON Z: first and last vertices
+    // are doubles, the others float offsets from the previous one
+    b = spatialiteHeader(1001003);
+    append(b, static_cast<uint32_t>(1));
+    append(b, static_cast<uint32_t>(4));
+    append(b, 10.0); append(b, 20.0); append(b, 1.0);
+    append(b, 0.5f); append(b, 0.0f); append(b, 1.0f);
+    append(b, 0.0f); append(b, 0.5f); append(b, 1.0f);
+    append(b, 10.0); append(b, 20.0); append(b, 1.0);
+    b.push_back(static_cast<char>(0xFE));
+    poly.fromBlob(b.data(), b.size());
+    ASSERT_EQ(poly.size(), 4);
+    EXPECT_DOUBLE_EQ(poly.points[1].x, 10.5);
+    EXPECT_DOUBLE_EQ(poly.points[2].y, 20.5);
+    EXPECT_DOUBLE_EQ(poly.points[2].z, 3.0);
+    EXPECT_DOUBLE_EQ(poly.points[3].x, 10.0);
+
+    // SpatiaLite compressed POLYGON M: M values are not
+    // compressed, intermediate vertices store them as doubles
+    b = spatialiteHeader(1002003);
+    append(b, static_cast<uint32_t>(1));
+    append(b, static_cast<uint32_t>(4));
+    append(b, 10.0); append(b, 20.0); append(b, 7.0);
+    append(b, 0.5f); append(b, 0.0f); append(b, 8.0);
+    append(b, 0.0f); append(b, 0.5f); append(b, 9.0);
+    append(b, 10.0); append(b, 20.0); append(b, 7.0);
+    b.push_back(static_cast<char>(0xFE));
+    poly.fromBlob(b.data(), b.size());
+    ASSERT_EQ(poly.size(), 4);
+    EXPECT_DOUBLE_EQ(poly.points[1].x, 10.5);
+    EXPECT_DOUBLE_EQ(poly.points[2].y, 20.5);
+    EXPECT_DOUBLE_EQ(poly.points[2].z, 0.0);
+    EXPECT_DOUBLE_EQ(poly.points[3].x, 10.0);
+    EXPECT_DOUBLE_EQ(poly.points[3].y, 20.0);
+
+    // SpatiaLite compressed POLYGON ZM
+    b = spatialiteHeader(1003003);
+    append(b, static_cast<uint32_t>(1));
+    append(b, static_cast<uint32_t>(4));
+    append(b, 10.0); append(b, 20.0); append(b, 1.0); append(b, 7.0);
+    append(b, 0.5f); append(b, 0.0f); append(b, 1.0f); append(b, 8.0);
+    append(b, 0.0f); append(b, 0.5f); append(b, 1.0f); append(b, 9.0);
+    append(b, 10.0); append(b, 20.0); append(b, 1.0); append(b, 7.0);
+    b.push_back(static_cast<char>(0xFE));
+    poly.fromBlob(b.data(), b.size());
+    ASSERT_EQ(poly.size(), 4);
+    EXPECT_DOUBLE_EQ(poly.points[2].y, 20.5);
+    EXPECT_DOUBLE_EQ(poly.points[2].z, 3.0);
+    EXPECT_DOUBLE_EQ(poly.points[3].x, 10.0);
+    EXPECT_DOUBLE_EQ(poly.points[3].z, 1.0);
+
+    // Big endian EWKB POINT Z with SRID
+    const unsigned char ewkb[] = {0x00, 0xA0, 0x00, 0x00, 0x01, 0x00, 0x00, 0x10, 0xE6,
+                                  0x3F, 0xF0, 0, 0, 0, 0, 0, 0,
+                                  0x40, 0x00, 0, 0, 0, 0, 0, 0,
+                                  0x40, 0x08, 0, 0, 0, 0, 0, 0};
+    p.fromBlob(ewkb, sizeof(ewkb));
+    ASSERT_EQ(p.size(), 1);
+    EXPECT_DOUBLE_EQ(p.points[0].x, 1);
+    EXPECT_DOUBLE_EQ(p.points[0].y, 2);
+    EXPECT_DOUBLE_EQ(p.points[0].z, 3);
+
+    EXPECT_THROW(p.fromBlob(pointWkb.data(), pointWkb.size() - 1), InvalidArgsException);
+    const unsigned char multi[] = {0x01, 0x04, 0, 0, 0, 0, 0, 0, 0};
+    EXPECT_THROW(p.fromBlob(multi, sizeof(multi)), InvalidArgsException);
+}
+
+TEST(parseContext, singleOpen) {
+    TestArea ta(TEST_NAME);
+    fs::path image = ta.downloadTestAsset("https://github.com/DroneDB/test_data/raw/master/test-datasets/drone_dataset_brighton_beach/DJI_0018.JPG",
+                                          "DJI_0018.JPG");
+
+    ParseContext ctx(image);
+    EXPECT_EQ(ctx.sha256(), Hash::fileSHA256(image.string()));
+
+    // The image is parsed from the bytes read for hashing
+    Exiv2::Image *img = ctx.getImage();
+    ASSERT_TRUE(img != nullptr);
+    EXPECT_EQ(img, ctx.getImage());
+    EXPECT_EQ(fingerprint(ctx), fingerprint(image));
+    EXPECT_EQ(fingerprint(ctx), EntryType::GeoImage);
+
+    // Same results as before
+    Entry e;
+    parseEntry(image, ta.getFolder(), e, true);
+    EXPECT_EQ(e.hash, Hash::fileSHA256(image.string()));
+    EXPECT_EQ(e.type, EntryType::GeoImage);
+    EXPECT_TRUE(e.properties.contains("width"));
+    EXPECT_FALSE(e.point_geom.empty());
+}
+
 }
@@ -0,0 +1,101 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "dbops.h"
+#include "entryfilter.h"
+#include "exceptions.h"
+#include "gtest/gtest.h"
+#include "test.h"
+#include "testarea.h"
+
+namespace {
+
+using namespace ddb;
+
+TEST(entryFilter, parse) {
+    auto f = parseEntryFilter("");
+    EXPECT_EQ(f.sql, "");
+    EXPECT_TRUE(f.params.empty());
+
+    f = parseEntryFilter("make = 'DJI' and type IN (geoimage, 4) AND size >= 1000");
+    EXPECT_EQ(f.sql, "(json_extract(e.properties, '$.make') = ? AND e.type IN (?, ?) AND e.size >= ?)");
+    ASSERT_EQ(f.params.size(), 4);
+    EXPECT_EQ(std::get<std::string>(f.params[0]), "DJI");
+    EXPECT_EQ(std::get<long long>(f.params[1]), 3);
+    EXPECT_EQ(std::get<long long>(f.params[2]), 4);
+    EXPECT_EQ(std::get<long long>(f.params[3]), 1000);
+
+    f = parseEntryFilter("captureTime BETWEEN '2021-06-01' AND '2021-06-01T00:00:01' AND focalLength < 8.8");
+    EXPECT_EQ(f.sql, "(json_extract(e.properties, '$.captureTime') BETWEEN ? AND ? AND json_extract(e.properties, '$.focalLength') < ?)");
+    EXPECT_DOUBLE_EQ(std::get<double>(f.params[0]), 1622505600000.0);
+    EXPECT_DOUBLE_EQ(std::get<double>(f.params[1]), 1622505601000.0);
+    EXPECT_DOUBLE_EQ(std::get<double>(f.params[2]), 8.8);
+
+    f = parseEntryFilter("mtime <> '2020-01-01'");
+    EXPECT_EQ(f.sql, "(e.mtime != ?)");
+    EXPECT_EQ(std::get<long long>(f.params[0]), 1577836800);
+
+    EXPECT_THROW(parseEntryFilter("bogus = 1"), InvalidArgsException);
+    EXPECT_THROW(parseEntryFilter("type = notatype"), InvalidArgsException);
+    EXPECT_THROW(parseEntryFilter("size >"), InvalidArgsException);
+    EXPECT_THROW(parseEntryFilter("size = 1 OR size = 2"), InvalidArgsException);
+    EXPECT_THROW(parseEntryFilter("make = 'DJI"), InvalidArgsException);
+    EXPECT_THROW(parseEntryFilter("width = 'wide'"), InvalidArgsException);
+}
+
+TEST(entryFilter, usesIndexes) {
+    TestArea ta(TEST_NAME);
+    const auto testFolder = ta.getFolder("test");
+    initIndex(testFolder.string());
+    auto db = ddb::open(testFolder.string(), false);
+
+    for (const std::string filter : {
+             "captureTime BETWEEN 1 AND 2", "captureTime > 1",
+             "make = 'DJI'", "model = 'FC330'",
+             "width >= 4000", "height < 100", "focalLength <= 8.8",
+             "type IN (geoimage, georaster)", "type = 3",
+             "size > 1000", "size BETWEEN 1 AND 2",
+             "depth = 1", "path = 'a.jpg'" }) {
+        const auto f = parseEntryFilter(filter);
+
+        // Same query as searchIndex
+        auto q = db->query("EXPLAIN QUERY PLAN SELECT e.path FROM entries e WHERE " + f.sql + " ORDER BY +e.path");
+        f.bind(q.get());
+
+        std::string plan;
+        while (q->fetch()) plan += q->getText(3) + "\n";
+
+        EXPECT_NE(plan.find("SEARCH e USING"), std::string::npos) << filter << ": " << plan;
+    }
+}
+
+TEST(entryFilter, search) {
+    TestArea ta(TEST_NAME);
+    const auto testFolder = ta.getFolder("test");
+    initIndex(testFolder.string());
+    auto db = ddb::open(testFolder.string(), false);
+
+    db->exec(R"<<<(
+        INSERT INTO entries (path, type, properties, size, depth) VALUES
+        ('a.jpg', 3, '{"make":"DJI","model":"FC330","captureTime":1622505600000.0,"width":4000}', 5000000, 0),
+        ('b.jpg', 3, '{"make":"Parrot","captureTime":1625097600000.0,"width":1280}', 800000, 0),
+        ('c.tif', 4, '{"width":10000}', 90000000, 0),
+        ('d.txt', 2, '{}', 10, 0)
+    )<<<");
+
+    const auto search = [&db](const std::string &filter) {
+        std::ostringstream out;
+        searchIndex(db.get(), "*", out, "text", "", filter);
+        return out.str();
+    };
+
+    EXPECT_EQ(search(""), "a.jpg\nb.jpg\nc.tif\nd.txt\n");
+    EXPECT_EQ(search("make = 'DJI'"), "a.jpg\n");
+    EXPECT_EQ(search("captureTime BETWEEN '2021-06-01' AND '2021-06-30'"), "a.jpg\n");
+    EXPECT_EQ(search("type IN (geoimage, georaster) AND width > 2000"), "a.jpg\nc.tif\n");
+    EXPECT_EQ(search("size < 1000000"), "b.jpg\nd.txt\n");
+    EXPECT_EQ(search("model = 'FC330' AND size > 10000000"), "");
+}
+
+}
@@ -0,0 +1,158 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include <chrono>
+#include <fstream>
+#include "dbops.h"
+#include "entryview.h"
+#include "gtest/gtest.h"
+#include "test.h"
+#include "testarea.h"
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+namespace {
+
+using namespace ddb;
+
+void insertEntries(Database *db, int count) {
+    auto q = db->query("INSERT INTO entries (path, hash, type, properties, mtime, size, depth, point_geom, polygon_geom) "
+                       "VALUES (?, ?, ?, ?, ?, ?, ?, GeomFromWKB(?, 4326), GeomFromWKB(?, 4326))");
+
+    db->exec("BEGIN TRANSACTION");
+    for (int i = 0; i < count; i++) {
+        Entry e;
+        e.path = "folder/" + std::to_string(i) + ".jpg";
+        e.hash = std::string(64, 'a' + i % 26);
+        e.type = EntryType::GeoImage;
+        e.properties = json{{"width", 4000}, {"height", 3000}, {"captureTime", 1600000000000 + i},
+                            {"make", "DJI"}, {"model", "FC300S"}, {"cameraYaw", 10.5}};
+        e.mtime = 1600000000 + i;
+        e.size = 1000 + i;
+        e.depth = 1;
+        e.point_geom.addPoint(10 + i * 0.001, 20, 100);
+        e.polygon_geom.addPoint(9, 19, 0);
+        e.polygon_geom.addPoint(11, 19, 0);
+        e.polygon_geom.addPoint(11, 21, 0);
+        e.polygon_geom.addPoint(9, 19, 0);
+        doInsert(q.get(), e);
+    }
+    db->exec("COMMIT");
+}
+
+TEST(entryArena, store) {
+    EntryArena arena(64);
+    EXPECT_EQ(arena.store("").size(), 0);
+    EXPECT_EQ(arena.size(), 0);
+
+    const auto a = arena.store("abc");
+    const auto big = arena.store(std::string(100, 'x'));
+    const auto b = arena.store("defghi");
+    const auto c = arena.store(std::string(60, 'y'));
+
+    EXPECT_EQ(a, "abc");
+    EXPECT_EQ(big, std::string(100, 'x'));
+    EXPECT_EQ(b, "defghi");
+    EXPECT_EQ(c, std::string(60, 'y'));
+
+    // Small values share blocks, large ones get their own
+    EXPECT_EQ(b.data(), a.data() + 3);
+    EXPECT_EQ(arena.size(), 64 + 100 + 60);
+}
+
+TEST(getMatchingEntryViews, Normal) {
+    TestArea ta(TEST_NAME);
+    const auto testFolder = ta.getFolder("test");
+    initIndex(testFolder.string());
+    auto db = ddb::open(testFolder.string(), false);
+
+    insertEntries(db.get(), 10);
+    db->exec("INSERT INTO entries (path, type, properties, mtime, size, depth) VALUES ('folder', 1, 'null', 0, 0, 0)");
+    db->exec("INSERT INTO entries_meta (id, path, key, data, mtime) VALUES ('m1', 'folder/1.jpg', 'tags', '\"a\"', 1)");
+
+    const auto entries = getMatchingEntries(db.get(), "folder", 0, true);
+    const auto views = getMatchingEntryViews(db.get(), "folder", 0, true);
+    ASSERT_EQ(views.size(), entries.size());
+    ASSERT_EQ(views.size(), 10);
+
+    for (size_t i = 0; i < views.size(); i++) {
+        const auto &v = views[i];
+        const auto &e = entries[i];
+        EXPECT_EQ(v.path(), e.path);
+        EXPECT_EQ(v.hash(), e.hash);
+        EXPECT_EQ(v.type(), e.type);
+        EXPECT_EQ(v.mtime(), e.mtime);
+        EXPECT_EQ(v.size(), e.size);
+        EXPECT_EQ(v.depth(), e.depth);
+        EXPECT_EQ(v.properties(), e.properties);
+        EXPECT_EQ(v.meta(), e.meta);
+        EXPECT_EQ(v.pointGeometry().toWkt(), e.point_geom.toWkt());
+        EXPECT_EQ(v.polygonGeometry().toWkt(), e.polygon_geom.toWkt());
+        EXPECT_EQ(v.toEntry().toJSONString(), e.toJSONString());
+    }
+
+    const auto folder = getMatchingEntryViews(db.get(), "folder");
+    ASSERT_EQ(folder.size(), 1);
+    EXPECT_TRUE(folder[0].isDirectory());
+    EXPECT_TRUE(folder[0].hash().empty());
+    EXPECT_TRUE(folder[0].pointGeometry().empty());
+    EXPECT_TRUE(folder[0].properties().is_null());
+
+    // Views stay valid after the statement and the database are gone
+    db.reset();
+    EXPECT_EQ(views[3].path(), entries[3].path);
+}
+
+#ifdef __linux__
+// Resident memory, in KB
+long residentMemory() {
+    std::ifstream statm("/proc/self/statm");
+    long size = 0, resident = 0;
+    statm >> size >> resident;
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+#else
+long residentMemory() {
+    return 0;
+}
+#endif
+
+TEST(getMatchingEntryViews, DISABLED_benchmark) {
+    TestArea ta(TEST_NAME);
+    const int count = 100000;
+
+    const auto testFolder = ta.getFolder("test");
+    initIndex(testFolder.string());
+    auto db = ddb::open(testFolder.string(), false);
+    insertEntries(db.get(), count);
+
+    // Views first, so that the memory freed by the vector of
+    // entries is not reused and counted in their favor
+    auto mem = residentMemory();
+    auto start = std::chrono::steady_clock::now();
+    {
+        const auto views = getMatchingEntryViews(db.get(), "folder", 0, true);
+        const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+        EXPECT_EQ(views.size(), count);
+        std::cout << "getMatchingEntryViews: " << ms << " ms, " << (residentMemory() - mem) / 1024 << " MB" << std::endl;
+
+        // Touching every field still only decodes what's asked
+        start = std::chrono::steady_clock::now();
+        long long width = 0;
+        for (const auto &v : views) width += v.properties()["width"].get<long long>();
+        EXPECT_EQ(width, 4000LL * count);
+        std::cout << "decode properties: " << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count() << " ms" << std::endl;
+    }
+
+    mem = residentMemory();
+    start = std::chrono::steady_clock::now();
+    const auto entries = getMatchingEntries(db.get(), "folder", 0, true);
+    const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    EXPECT_EQ(entries.size(), count);
+    std::cout << "getMatchingEntries: " << ms << " ms, " << (residentMemory() - mem) / 1024 << " MB" << std::endl;
+}
+
+}
@@ -0,0 +1,406 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include <chrono>
+#include <fstream>
+#include "exif.h"
+#include "exifreader.h"
+#include "parsecontext.h"
+#include "gtest/gtest.h"
+#include "test.h"
+#include "testarea.h"
+
+namespace {
+
+using namespace ddb;
+
+void put16(std::string &s, uint16_t v) {
+    s.push_back(static_cast<char>(v & 0xff));
+    s.push_back(static_cast<char>(v >> 8));
+}
+
+void put32(std::string &s, uint32_t v) {
+    put16(s, static_cast<uint16_t>(v & 0xffff));
+    put16(s, static_cast<uint16_t>(v >> 16));
+}
+
+struct IfdEntry {
+    uint16_t tag;
+    uint16_t type;
+    uint32_t count;
+    std::string data; // little endian value bytes
+};
+
+IfdEntry ascii(uint16_t tag, const std::string &s) {
+    return {tag, 2, static_cast<uint32_t>(s.size() + 1), s + std::string(1, '\0')};
+}
+
+IfdEntry shortValue(uint16_t tag, uint16_t v) {
+    std::string d;
+    put16(d, v);
+    return {tag, 3, 1, d};
+}
+
+IfdEntry rationals(uint16_t tag, const std::vector<std::pair<uint32_t, uint32_t>> &values) {
+    std::string d;
+    for (const auto &r : values) {
+        put32(d, r.first);
+        put32(d, r.second);
+    }
+    return {tag, 5, static_cast<uint32_t>(values.size()), d};
+}
+
+// Append an IFD at the end of tiff, values that don't fit
+// in the entries are stored right after it
+void appendIfd(std::string &tiff, const std::vector<IfdEntry> &entries) {
+    const size_t start = tiff.size();
+    size_t dataOffset = start + 2 + entries.size() * 12 + 4;
+    std::string data;
+
+    put16(tiff, static_cast<uint16_t>(entries.size()));
+    for (const auto &e : entries) {
+        put16(tiff, e.tag);
+        put16(tiff, e.type);
+        put32(tiff, e.count);
+        if (e.data.size() <= 4) {
+            tiff += e.data + std::string(4 - e.data.size(), '\0');
+        } else {
+            put32(tiff, static_cast<uint32_t>(dataOffset + data.size()));
+            data += e.data;
+        }
+    }
+    put32(tiff, 0);
+    tiff += data;
+}
+
+std::string segment(uint8_t marker, const std::string &payload) {
+    std::string s = {static_cast<char>(0xFF), static_cast<char>(marker)};
+    const size_t len = payload.size() + 2;
+    s.push_back(static_cast<char>(len >> 8));
+    s.push_back(static_cast<char>(len & 0xff));
+    return s + payload;
+}
+
+size_t ifdSize(const std::vector<IfdEntry> &entries) {
+    size_t size = 2 + entries.size() * 12 + 4;
+    for (const auto &e : entries) {
+        if (e.data.size() > 4) size += e.data.size();
+    }
+    return size;
+}
+
+IfdEntry pointer(uint16_t tag, size_t offset) {
+    std::string d;
+    put32(d, static_cast<uint32_t>(offset));
+    return {tag, 4, 1, d};
+}
+
+// TIFF with IFD0, followed by the Exif and GPS IFDs
+std::string makeTiff() {
+    const std::vector<IfdEntry> exifIfd = {
+        ascii(0x9003, "2017:05:20 12:30:45"),
+        rationals(0x920A, {{361, 100}}),
+        ascii(0x9291, "12"),
+        shortValue(0xA405, 20),
+    };
+    const std::vector<IfdEntry> gpsIfd = {
+        ascii(0x0001, "S"),
+        rationals(0x0002, {{46, 1}, {30, 1}, {1800, 100}}),
+        ascii(0x0003, "E"),
+        rationals(0x0004, {{10, 1}, {15, 1}, {0, 1}}),
+        {0x0005, 1, 1, std::string(1, '\0')},
+        rationals(0x0006, {{12345, 100}}),
+    };
+    std::vector<IfdEntry> ifd0 = {ascii(0x010F, "DJI"), ascii(0x0110, "FC300S"), shortValue(0x0112, 1),
+                                  pointer(0x8769, 0), pointer(0x8825, 0)};
+    const size_t exifOffset = 8 + ifdSize(ifd0);
+    ifd0[3] = pointer(0x8769, exifOffset);
+    ifd0[4] = pointer(0x8825, exifOffset + ifdSize(exifIfd));
+
+    std::string tiff = "II";
+    put16(tiff, 42);
+    put32(tiff, 8);
+    appendIfd(tiff, ifd0);
+    appendIfd(tiff, exifIfd);
+    appendIfd(tiff, gpsIfd);
+
+    return tiff;
+}
+
+const std::string xmp = R"(<x:xmpmeta xmlns:x="adobe:ns:meta/"><rdf:RDF xmlns:rdf="http://www.w3.org/1999/02/22-rdf-syntax-ns#">
+<rdf:Description rdf:about="DJI Meta Data" xmlns:drone-dji="http://www.dji.com/drone-dji/1.0/"
+ drone-dji:AbsoluteAltitude="+130.25"
+ drone-dji:RelativeAltitude="+50.10"
+ drone-dji:GimbalRollDegree="+0.00"
+ drone-dji:GimbalYawDegree="-45.50"
+ drone-dji:GimbalPitchDegree = '-90.00'>
+ <drone-dji:FlightYawDegree>-44.0</drone-dji:FlightYawDegree>
+</rdf:Description></rdf:RDF></x:xmpmeta>)";
+
+std::string makeJpeg(const std::string &xmpPacket, size_t padding = 0) {
+    std::string sof = {8, 0x0B, static_cast<char>(0xB8), 0x0F, static_cast<char>(0xA0), 3};
+
+    std::string jpeg = {static_cast<char>(0xFF), static_cast<char>(0xD8)};
+    jpeg += segment(0xE0, std::string("JFIF\0", 5) + std::string(9, '\0'));
+
+    // Large segments push the metadata away from the start of the file
+    while (padding > 0) {
+        const size_t n = std::min<size_t>(padding, 60000);
+        jpeg += segment(0xE2, std::string(n, 'p'));
+        padding -= n;
+    }
+
+    jpeg += segment(0xE1, std::string("Exif\0\0", 6) + makeTiff());
+    if (!xmpPacket.empty()) jpeg += segment(0xE1, std::string("http://ns.adobe.com/xap/1.0/\0", 29) + xmpPacket);
+    jpeg += segment(0xDB, std::string(65, 'q'));
+    jpeg += segment(0xC0, sof + std::string(9, '\0'));
+    jpeg += segment(0xDA, std::string(10, '\0'));
+    jpeg += std::string(1000, 'x');
+    jpeg += {static_cast<char>(0xFF), static_cast<char>(0xD9)};
+    return jpeg;
+}
+
+bool readTags(const std::string &jpeg, ExifTags &tags) {
+    return readJpegTags(reinterpret_cast<const uint8_t *>(jpeg.data()), jpeg.size(), tags);
+}
+
+TEST(readJpegTags, synthetic) {
+    const auto jpeg = makeJpeg(xmp);
+
+    ExifTags tags;
+    ASSERT_TRUE(readTags(jpeg, tags));
+    EXPECT_EQ(tags.imageWidth, 4000);
+    EXPECT_EQ(tags.imageHeight, 3000);
+    EXPECT_TRUE(tags.hasExif);
+    EXPECT_TRUE(tags.hasXmp);
+    EXPECT_EQ(tags[ExifMake].toString(), "DJI");
+    EXPECT_EQ(tags[ExifFocalLength].toString(), "361/100");
+    EXPECT_FLOAT_EQ(tags[ExifFocalLength].toFloat(), 3.61f);
+    EXPECT_EQ(tags[ExifFocalLengthIn35mmFilm].toInt64(), 20);
+    EXPECT_EQ(tags[XmpDjiFlightYawDegree].toString(), "-44.0");
+    EXPECT_FALSE(tags[XmpDjiLatitude]);
+
+    ExifParser e(tags);
+    EXPECT_EQ(e.extractImageSize().width, 4000);
+    EXPECT_EQ(e.extractMake(), "DJI");
+    EXPECT_EQ(e.extractSensor(), "dji fc300s");
+    EXPECT_EQ(e.extractImageOrientation(), 1);
+
+    GeoLocation geo;
+    ASSERT_TRUE(e.extractGeo(geo));
+    EXPECT_NEAR(geo.latitude, -46.505, 1e-9);
+    EXPECT_NEAR(geo.longitude, 10.25, 1e-9);
+    EXPECT_NEAR(geo.altitude, 130.25, 1e-5);
+
+    double relAltitude;
+    ASSERT_TRUE(e.extractRelAltitude(relAltitude));
+    EXPECT_NEAR(relAltitude, 50.1, 1e-5);
+
+    CameraOrientation ori;
+    ASSERT_TRUE(e.extractCameraOrientation(ori));
+    EXPECT_DOUBLE_EQ(ori.pitch, -90);
+    EXPECT_DOUBLE_EQ(ori.yaw, -45.5);
+    EXPECT_DOUBLE_EQ(ori.roll, 0);
+
+    // Files are read in place, metadata past the first
+    // read of the file is read on demand
+    TestArea ta(TEST_NAME);
+    for (size_t padding : {size_t(0), size_t(DDB_JPEG_HEADER_READ_SIZE)}) {
+        const auto file = ta.getPath("test" + std::to_string(padding) + ".jpg");
+        std::ofstream(file.string(), std::ios::binary) << makeJpeg(xmp, padding);
+
+        ExifTags fileTags;
+        ASSERT_TRUE(readJpegTags(file, fileTags));
+        EXPECT_EQ(fileTags.imageWidth, 4000);
+        EXPECT_EQ(fileTags[ExifModel].toString(), "FC300S");
+        EXPECT_EQ(fileTags[ExifGPSLatitude].toString(), tags[ExifGPSLatitude].toString());
+        EXPECT_EQ(fileTags[XmpDjiAbsoluteAltitude].toString(), "+130.25");
+    }
+}
+
+TEST(readJpegTags, unsupported) {
+    ExifTags tags;
+    EXPECT_FALSE(readTags("", tags));
+    EXPECT_FALSE(readTags("\x89PNG\r\n", tags));
+    EXPECT_FALSE(readJpegTags(fs::path("does-not-exist.jpg"), tags));
+
+    // Truncated
+    const auto jpeg = makeJpeg(xmp);
+    EXPECT_FALSE(readTags(jpeg.substr(0, 200), tags));
+
+    // No XMP
+    ASSERT_TRUE(readTags(makeJpeg(""), tags));
+    EXPECT_FALSE(tags.hasXmp);
+    EXPECT_FALSE(tags[XmpDjiGimbalYawDegree]);
+
+    // XMP arrays are left to Exiv2
+    EXPECT_FALSE(readTags(makeJpeg(R"(<x:xmpmeta><rdf:Description><Camera:Pitch><rdf:Seq><rdf:li>1</rdf:li></rdf:Seq></Camera:Pitch></rdf:Description></x:xmpmeta>)"), tags));
+}
+
+TEST(readJpegTags, xmpPrefixes) {
+    // Properties are found by namespace, not by the prefix Exiv2 reports them under
+    ExifTags tags;
+    ASSERT_TRUE(readTags(makeJpeg(R"(<x:xmpmeta xmlns:x="adobe:ns:meta/"><rdf:RDF xmlns:rdf="http://www.w3.org/1999/02/22-rdf-syntax-ns#">
+<rdf:Description xmlns:dji="http://www.dji.com/drone-dji/1.0/" xmlns:pano="http://ns.google.com/photos/1.0/panorama/"
+ dji:AbsoluteAltitude="+130.25">
+<dji:GimbalYawDegree>-45.5</dji:GimbalYawDegree>
+<pano:ProjectionType>equirectangular</pano:ProjectionType>
+</rdf:Description></rdf:RDF></x:xmpmeta>)"), tags));
+    EXPECT_EQ(tags[XmpDjiAbsoluteAltitude].toString(), "+130.25");
+    EXPECT_EQ(tags[XmpDjiGimbalYawDegree].toString(), "-45.5");
+    EXPECT_EQ(tags[XmpGPanoProjectionType].toString(), "equirectangular");
+
+    // The Exiv2 prefix bound to another namespace
+    ExifTags other;
+    ASSERT_TRUE(readTags(makeJpeg(R"(<x:xmpmeta><rdf:Description xmlns:drone-dji="http://example.com/other/"
+ drone-dji:AbsoluteAltitude="1"></rdf:Description></x:xmpmeta>)"), other));
+    EXPECT_FALSE(other[XmpDjiAbsoluteAltitude]);
+
+    // Bindings that need a full XML parser are left to Exiv2
+    EXPECT_FALSE(readTags(makeJpeg(R"(<x:xmpmeta><rdf:Description xmlns:a="http://www.dji.com/drone-dji/1.0/" a:AbsoluteAltitude="1"/>
+<rdf:Description xmlns:b="http://www.dji.com/drone-dji/1.0/" b:RelativeAltitude="2"/></x:xmpmeta>)"), tags));
+    EXPECT_FALSE(readTags(makeJpeg(R"(<x:xmpmeta><rdf:Description xmlns:a="http://www.dji.com/drone-dji/1.0/" a:AbsoluteAltitude="1"/>
+<rdf:Description xmlns:a="http://example.com/other/" a:RelativeAltitude="2"/></x:xmpmeta>)"), tags));
+    EXPECT_FALSE(readTags(makeJpeg(R"(<x:xmpmeta><rdf:Description xmlns="http://www.dji.com/drone-dji/1.0/"/></x:xmpmeta>)"), tags));
+}
+
+TEST(findExifTag, keys) {
+    ExifTag tag;
+    ASSERT_TRUE(findExifTag("Exif.Photo.FocalLength", tag));
+    EXPECT_EQ(tag, ExifFocalLength);
+    ASSERT_TRUE(findExifTag("Xmp.drone-dji.GimbalYawDegree", tag));
+    EXPECT_EQ(tag, XmpDjiGimbalYawDegree);
+    EXPECT_FALSE(findExifTag("Exif.Photo.ExposureTime", tag));
+    EXPECT_FALSE(findExifTag("", tag));
+
+    for (int i = 0; i < ExifTagCount; i++) {
+        ASSERT_TRUE(findExifTag(exifTagKey(static_cast<ExifTag>(i)), tag));
+        EXPECT_EQ(tag, i);
+    }
+}
+
+TEST(exifValue, conversions) {
+    ExifValue v;
+    v.setText("+12.5");
+    EXPECT_FLOAT_EQ(v.toFloat(), 12.5f);
+    EXPECT_EQ(v.toInt64(), 12);
+    EXPECT_EQ(v.toRational(), std::make_pair(25, 2));
+
+    v.setText("3/4");
+    EXPECT_FLOAT_EQ(v.toFloat(), 0.75f);
+    EXPECT_EQ(v.toRational(), std::make_pair(3, 4));
+
+    v.setText("true");
+    EXPECT_EQ(v.toInt64(), 1);
+    v.setText("abc");
+    EXPECT_EQ(v.toInt64(), 0);
+
+    // Sub second digits are read as a number
+    v.setText("045");
+    EXPECT_EQ(v.toInt64(), 45);
+
+    ExifValue n;
+    n.addNumber(7);
+    n.addNumber(9);
+    EXPECT_EQ(n.count(), 2);
+    EXPECT_EQ(n.toString(), "7 9");
+    EXPECT_EQ(n.toInt64(1), 9);
+    EXPECT_EQ(n.toInt64(2), 0);
+}
+
+void expectSameProperties(ExifParser &a, ExifParser &b) {
+    EXPECT_EQ(a.hasTags(), b.hasTags());
+    EXPECT_EQ(a.extractImageSize().width, b.extractImageSize().width);
+    EXPECT_EQ(a.extractImageSize().height, b.extractImageSize().height);
+    EXPECT_EQ(a.extractSensor(), b.extractSensor());
+    EXPECT_EQ(a.extractImageOrientation(), b.extractImageOrientation());
+    EXPECT_DOUBLE_EQ(a.extractCaptureTime(), b.extractCaptureTime());
+
+    Focal fa, fb;
+    EXPECT_EQ(a.computeFocal(fa), b.computeFocal(fb));
+    EXPECT_DOUBLE_EQ(fa.length, fb.length);
+    EXPECT_DOUBLE_EQ(fa.length35, fb.length35);
+
+    GeoLocation ga, gb;
+    EXPECT_EQ(a.extractGeo(ga), b.extractGeo(gb));
+    EXPECT_DOUBLE_EQ(ga.latitude, gb.latitude);
+    EXPECT_DOUBLE_EQ(ga.longitude, gb.longitude);
+    EXPECT_DOUBLE_EQ(ga.altitude, gb.altitude);
+
+    double ra = 0, rb = 0;
+    EXPECT_EQ(a.extractRelAltitude(ra), b.extractRelAltitude(rb));
+    EXPECT_DOUBLE_EQ(ra, rb);
+
+    CameraOrientation oa, ob;
+    EXPECT_EQ(a.extractCameraOrientation(oa), b.extractCameraOrientation(ob));
+    EXPECT_DOUBLE_EQ(oa.pitch, ob.pitch);
+    EXPECT_DOUBLE_EQ(oa.yaw, ob.yaw);
+    EXPECT_DOUBLE_EQ(oa.roll, ob.roll);
+}
+
+TEST(readJpegTags, sameAsExiv2) {
+    TestArea ta(TEST_NAME);
+    fs::path image = ta.downloadTestAsset("https://github.com/DroneDB/test_data/raw/master/test-datasets/drone_dataset_brighton_beach/DJI_0018.JPG",
+                                          "DJI_0018.JPG");
+
+    ExifTags tags;
+    ASSERT_TRUE(readJpegTags(image, tags));
+    ExifParser fast(tags);
+
+    ParseContext ctx(image);
+    ASSERT_TRUE(ctx.getImage() != nullptr);
+    ExifParser exiv2(ctx.getImage());
+
+    expectSameProperties(fast, exiv2);
+
+    // JPEGs no longer go through Exiv2
+    ParseContext other(image);
+    ASSERT_TRUE(other.getExifParser() != nullptr);
+    EXPECT_EQ(other.getExifParser()->getTags().imageWidth, tags.imageWidth);
+}
+
+TEST(readJpegTags, DISABLED_benchmark) {
+    TestArea ta(TEST_NAME);
+    const int copies = 1000;
+
+    const fs::path image = ta.downloadTestAsset("https://github.com/DroneDB/test_data/raw/master/test-datasets/drone_dataset_brighton_beach/DJI_0018.JPG",
+                                                "DJI_0018.JPG");
+    const auto folder = ta.getFolder("images");
+    std::vector<fs::path> images;
+    for (int i = 0; i < copies; i++) {
+        images.push_back(folder / ("DJI_" + std::to_string(i) + ".JPG"));
+        fs::copy_file(image, images.back(), fs::copy_options::overwrite_existing);
+    }
+
+    double checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (const auto &p : images) {
+        auto img = Exiv2::ImageFactory::open(p.string());
+        img->readMetadata();
+        ExifParser e(img.get());
+        GeoLocation geo;
+        e.extractGeo(geo);
+        checksum += geo.latitude;
+    }
+    const auto exiv2Ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+    double fastChecksum = 0;
+    start = std::chrono::steady_clock::now();
+    for (const auto &p : images) {
+        ExifTags tags;
+        ASSERT_TRUE(readJpegTags(p, tags));
+        ExifParser e(tags);
+        GeoLocation geo;
+        e.extractGeo(geo);
+        fastChecksum += geo.latitude;
+    }
+    const auto fastMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+    EXPECT_DOUBLE_EQ(checksum, fastChecksum);
+    std::cout << images.size() << " images" << std::endl;
+    std::cout << "Exiv2 readMetadata: " << exiv2Ms << " ms" << std::endl;
+    std::cout << "readJpegTags: " << fastMs << " ms" << std::endl;
+}
+
+}
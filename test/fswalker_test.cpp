@@ -0,0 +1,168 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include <fstream>
+#include <set>
+#include "ddb.h"
+#include "dbops.h"
+#include "exceptions.h"
+#include "fswalker.h"
+#include "gtest/gtest.h"
+#include "test.h"
+#include "testarea.h"
+
+namespace {
+
+using namespace ddb;
+
+fs::path makeTree(TestArea &ta) {
+    const auto root = ta.getFolder("tree");
+    for (int i = 0; i < 5; i++) {
+        const auto dir = root / ("dir" + std::to_string(i)) / "sub";
+        fs::create_directories(dir);
+        for (int j = 0; j < 10; j++) {
+            std::ofstream((dir / ("file" + std::to_string(j) + ".txt")).string()) << j;
+        }
+        std::ofstream((root / ("top" + std::to_string(i) + ".txt")).string()) << i;
+    }
+    fs::create_directories(root / DDB_FOLDER / "tmp");
+    std::ofstream((root / DDB_FOLDER / "tmp" / "x.txt").string()) << "x";
+    return root;
+}
+
+std::set<std::string> walk(const fs::path &root, int maxDepth, int threads) {
+    std::set<std::string> result;
+    walkDirectory(root, [&](const fs::path &p, bool isDirectory, int) {
+        result.insert(fs::relative(p, root).generic_string() + (isDirectory ? "/" : ""));
+        return true;
+    }, maxDepth, threads);
+    return result;
+}
+
+TEST(walkDirectory, sameResultsSingleAndMultiThreaded) {
+    TestArea ta(TEST_NAME);
+    const auto root = makeTree(ta);
+
+    const auto single = walk(root, 0, 1);
+    const auto multi = walk(root, 0, 4);
+
+    // 5 top files, 5 dirs, 5 subdirs, 50 files, .ddb (not descended)
+    EXPECT_EQ(single.size(), 66);
+    EXPECT_EQ(single, multi);
+    EXPECT_TRUE(single.count(".ddb/") == 1);
+    EXPECT_TRUE(single.count(".ddb/tmp/") == 0);
+    EXPECT_TRUE(single.count("dir3/sub/file7.txt") == 1);
+}
+
+TEST(walkDirectory, deterministicOrder) {
+    TestArea ta(TEST_NAME);
+    const auto root = makeTree(ta);
+
+    const auto ordered = [&root](int threads) {
+        std::vector<std::string> result;
+        walkDirectory(root, [&](const fs::path &p, bool, int) {
+            result.push_back(fs::relative(p, root).generic_string());
+            return true;
+        }, 0, threads);
+        return result;
+    };
+
+    const auto single = ordered(1);
+    ASSERT_EQ(single.size(), 66);
+    for (int i = 0; i < 5; i++) EXPECT_EQ(ordered(4), single);
+
+    // Sorted by name, each directory before its subdirectories
+    EXPECT_EQ(single[0], ".ddb");
+    EXPECT_EQ(single[1], "dir0");
+    EXPECT_EQ(single[10], "top4.txt");
+    EXPECT_EQ(single[11], "dir0/sub");
+    EXPECT_EQ(single[12], "dir0/sub/file0.txt");
+    EXPECT_EQ(single[22], "dir1/sub");
+}
+
+TEST(walkDirectory, wideTree) {
+    TestArea ta(TEST_NAME);
+    const auto root = ta.getFolder("wide");
+
+    // More directories than the walker reads ahead at once
+    for (int i = 0; i < 50; i++) {
+        const auto dir = root / ("dir" + std::to_string(i)) / "a" / "b";
+        fs::create_directories(dir);
+        std::ofstream((dir / "file.txt").string()) << i;
+    }
+
+    const auto ordered = [&root](int threads) {
+        std::vector<std::string> result;
+        walkDirectory(root, [&](const fs::path &p, bool, int) {
+            result.push_back(fs::relative(p, root).generic_string());
+            return true;
+        }, 0, threads);
+        return result;
+    };
+
+    const auto single = ordered(1);
+    EXPECT_EQ(single.size(), 200);
+    EXPECT_EQ(ordered(2), single);
+    EXPECT_EQ(ordered(8), single);
+}
+
+TEST(walkDirectory, maxDepth) {
+    TestArea ta(TEST_NAME);
+    const auto root = makeTree(ta);
+
+    EXPECT_EQ(walk(root, 1, 4).size(), 11);
+    EXPECT_EQ(walk(root, 2, 4).size(), 16);
+    EXPECT_EQ(walk(root, 2, 1), walk(root, 2, 4));
+}
+
+TEST(walkDirectory, stop) {
+    TestArea ta(TEST_NAME);
+    const auto root = makeTree(ta);
+
+    for (int threads : {1, 4}) {
+        int count = 0;
+        EXPECT_FALSE(walkDirectory(root, [&](const fs::path &, bool, int) {
+            return ++count < 20;
+        }, 0, threads));
+        EXPECT_EQ(count, 20);
+    }
+}
+
+TEST(walkDirectory, missingDirectory) {
+    TestArea ta(TEST_NAME);
+    EXPECT_THROW(walk(ta.getFolder() / "missing", 0, 4), FSException);
+}
+
+TEST(walkIndexPathList, streamsParents) {
+    TestArea ta(TEST_NAME);
+    const auto root = makeTree(ta);
+
+    std::vector<fs::path> found;
+    walkIndexPathList(root, {(root / "dir1" / "sub" / "file1.txt").string(),
+                             (root / "dir1" / "sub" / "file2.txt").string()}, true,
+                      [&](const fs::path &p) {
+        found.push_back(p);
+        return true;
+    });
+
+    // Two files and their parents, reported once
+    EXPECT_EQ(found.size(), 4);
+
+    const auto all = getIndexPathList(root, {root.string() + "/dir2"}, true);
+    // dir2, dir2/sub and 10 files
+    EXPECT_EQ(all.size(), 12);
+}
+
+TEST(pathTrie, insertContains) {
+    PathTrie t;
+    EXPECT_TRUE(t.insert(fs::path("a") / "b" / "c"));
+    EXPECT_FALSE(t.insert(fs::path("a") / "b" / "c"));
+    EXPECT_TRUE(t.contains(fs::path("a") / "b" / "c"));
+    EXPECT_FALSE(t.contains(fs::path("a") / "b"));
+    EXPECT_TRUE(t.insert(fs::path("a") / "b"));
+    EXPECT_TRUE(t.contains(fs::path("a") / "b"));
+    EXPECT_FALSE(t.contains(fs::path("a") / "x"));
+}
+
+}
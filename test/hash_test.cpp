@@ -0,0 +1,66 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include <fstream>
+#include <random>
+#include "exceptions.h"
+#include "gtest/gtest.h"
+#include "hash.h"
+#include "test.h"
+#include "testarea.h"
+
+namespace {
+
+using namespace ddb;
+
+TEST(hash, knownDigests) {
+    EXPECT_EQ(Hash::strSHA256(""), "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+    EXPECT_EQ(Hash::strSHA256("abc"), "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+}
+
+TEST(hash, matchesReferenceImplementation) {
+    TestArea ta(TEST_NAME);
+    const auto file = ta.getFolder() / "data.bin";
+
+    std::mt19937 rng(42);
+    std::string data;
+
+    // Cover all block/padding boundaries
+    for (size_t n = 0; n < 300; n++){
+        SHA256 reference;
+        EXPECT_EQ(Hash::strSHA256(data), reference(data));
+
+        std::ofstream(file.string(), std::ios::binary) << data;
+        EXPECT_EQ(Hash::fileSHA256(file.string()), reference(data));
+
+        data.push_back(static_cast<char>(rng()));
+    }
+
+    const auto impl = Hash::sha256Implementation();
+    EXPECT_TRUE(impl == "sha-ni" || impl == "portable") << impl;
+}
+
+TEST(hash, batch) {
+    TestArea ta(TEST_NAME);
+
+    std::vector<std::string> paths;
+    std::vector<std::string> expected;
+    for (int i = 0; i < 20; i++){
+        const auto p = ta.getFolder() / ("file" + std::to_string(i) + ".txt");
+        const std::string content(static_cast<size_t>(i) * 1000, static_cast<char>('a' + i));
+        std::ofstream(p.string(), std::ios::binary) << content;
+
+        paths.push_back(p.string());
+        expected.push_back(Hash::strSHA256(content));
+    }
+
+    EXPECT_EQ(Hash::filesSHA256(paths, 4), expected);
+    EXPECT_EQ(Hash::filesSHA256(paths, 1), expected);
+    EXPECT_TRUE(Hash::filesSHA256({}).empty());
+
+    paths.push_back((ta.getFolder() / "missing.txt").string());
+    EXPECT_THROW(Hash::filesSHA256(paths, 4), FSException);
+}
+
+}
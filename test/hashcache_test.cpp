@@ -0,0 +1,143 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include <fstream>
+#include "dbops.h"
+#include "gtest/gtest.h"
+#include "hash.h"
+#include "hashcache.h"
+#include "test.h"
+#include "testarea.h"
+
+namespace {
+
+using namespace ddb;
+
+TEST(hashCache, hitsAndMisses) {
+    TestArea ta(TEST_NAME);
+    const auto testFolder = ta.getFolder("test");
+    const auto file = testFolder / "file.txt";
+    std::ofstream(file.string()) << "hello";
+
+    initIndex(testFolder.string());
+    auto db = ddb::open(testFolder.string(), false);
+    auto cache = db->getHashCache();
+
+    EXPECT_EQ(cache->fileSHA256(file), Hash::fileSHA256(file.string()));
+    EXPECT_EQ(cache->hits(), 0);
+    EXPECT_EQ(cache->misses(), 1);
+
+    EXPECT_EQ(cache->fileSHA256(file), Hash::fileSHA256(file.string()));
+    EXPECT_EQ(cache->hits(), 1);
+    EXPECT_EQ(cache->misses(), 1);
+
+    // Changing the file invalidates the entry
+    std::ofstream(file.string()) << "hello world";
+    EXPECT_EQ(cache->fileSHA256(file), Hash::strSHA256("hello world"));
+    EXPECT_EQ(cache->misses(), 2);
+
+    cache->resetCounters();
+    EXPECT_EQ(cache->hits(), 0);
+    EXPECT_EQ(cache->misses(), 0);
+
+    cache->clear();
+    cache->fileSHA256(file);
+    EXPECT_EQ(cache->misses(), 1);
+}
+
+TEST(hashCache, persistent) {
+    TestArea ta(TEST_NAME);
+    const auto testFolder = ta.getFolder("test");
+    const auto file = testFolder / "file.txt";
+    std::ofstream(file.string()) << "hello";
+
+    initIndex(testFolder.string());
+    {
+        auto db = ddb::open(testFolder.string(), false);
+        addToIndex(db.get(), {file.string()});
+        EXPECT_EQ(db->getHashCache()->misses(), 1);
+    }
+
+    // Hashes computed by add are reused in a new session
+    auto db = ddb::open(testFolder.string(), false);
+    auto cache = db->getHashCache();
+    EXPECT_EQ(cache->fileSHA256(file), Hash::strSHA256("hello"));
+    EXPECT_EQ(cache->hits(), 1);
+    EXPECT_EQ(cache->misses(), 0);
+}
+
+TEST(hashCache, renameHits) {
+    TestArea ta(TEST_NAME);
+    const auto testFolder = ta.getFolder("test");
+    const auto file = testFolder / "file.txt";
+    const auto moved = testFolder / "moved.txt";
+    std::ofstream(file.string()) << "hello";
+
+    initIndex(testFolder.string());
+    auto db = ddb::open(testFolder.string(), false);
+    auto cache = db->getHashCache();
+
+    cache->fileSHA256(file);
+    EXPECT_EQ(cache->misses(), 1);
+
+    // Renames keep inode, size and mtime
+    fs::rename(file, moved);
+    EXPECT_EQ(cache->fileSHA256(moved), Hash::strSHA256("hello"));
+    EXPECT_EQ(cache->hits(), 1);
+    EXPECT_EQ(cache->misses(), 1);
+}
+
+TEST(hashCache, readOnly) {
+    TestArea ta(TEST_NAME);
+    const auto testFolder = ta.getFolder("test");
+    const auto file = testFolder / "file.txt";
+    std::ofstream(file.string()) << "hello";
+
+    initIndex(testFolder.string());
+    auto db = ddb::open(testFolder.string(), false);
+    auto cache = db->getHashCache();
+
+    EXPECT_EQ(cache->fileSHA256(file, false), Hash::strSHA256("hello"));
+    EXPECT_EQ(cache->fileSHA256(file, false), Hash::strSHA256("hello"));
+    EXPECT_EQ(cache->misses(), 2);
+
+    auto q = db->query("SELECT COUNT(*) FROM hash_cache");
+    ASSERT_TRUE(q->fetch());
+    EXPECT_EQ(q->getInt(0), 0);
+}
+
+TEST(hashCache, prune) {
+    TestArea ta(TEST_NAME);
+    const auto testFolder = ta.getFolder("test");
+
+    initIndex(testFolder.string());
+    auto db = ddb::open(testFolder.string(), false);
+    auto cache = db->getHashCache();
+
+    for (int i = 0; i < 5; i++){
+        const auto file = testFolder / ("file" + std::to_string(i) + ".txt");
+        std::ofstream(file.string()) << i;
+        cache->fileSHA256(file);
+    }
+
+    // Most recently stored entries are kept
+    cache->prune(2);
+    auto q = db->query("SELECT COUNT(*) FROM hash_cache");
+    ASSERT_TRUE(q->fetch());
+    EXPECT_EQ(q->getInt(0), 2);
+
+    cache->resetCounters();
+    cache->fileSHA256(testFolder / "file4.txt");
+    cache->fileSHA256(testFolder / "file3.txt");
+    cache->fileSHA256(testFolder / "file0.txt");
+    EXPECT_EQ(cache->hits(), 2);
+    EXPECT_EQ(cache->misses(), 1);
+
+    cache->prune(0);
+    q = db->query("SELECT COUNT(*) FROM hash_cache");
+    ASSERT_TRUE(q->fetch());
+    EXPECT_EQ(q->getInt(0), 0);
+}
+
+}
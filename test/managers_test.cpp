@@ -28,4 +28,75 @@ TEST(syncManager, happyPath) {
 //    EXPECT_EQ(t, newt);
     // TODO!!!
 }
+
+TEST(syncManager, binaryStamp) {
+    TestArea ta(TEST_NAME);
+    const auto testFolder = ta.getFolder("test");
+    initIndex(testFolder.string());
+    auto db = ddb::open(testFolder.string(), false);
+
+    const std::string h(64, 'a');
+    json stamp = {{"checksum", std::string(64, 'b')},
+                  {"entries", {{{"a", ""}}, {{"a/1.jpg", h}}}},
+                  {"meta", {"m1"}}};
+
+    // Legacy sync.json with the stamp inline
+    {
+        json j = {{"testhub.dronedb.app", stamp}};
+        std::ofstream out(db->ddbDirectory() / SYNCFILE);
+        out << j.dump();
+    }
+
+    SyncManager manager(db.get());
+    EXPECT_EQ(manager.getLastStamp("testhub.dronedb.app"), stamp);
+    EXPECT_EQ(manager.getLastBinaryStamp("testhub.dronedb.app").checksum(), std::string(64, 'b'));
+
+    stamp["entries"].push_back({{"b.txt", std::string(64, 'c')}});
+    manager.setLastStamp("testhub.dronedb.app", stamp);
+    EXPECT_EQ(manager.getLastStamp("testhub.dronedb.app"), stamp);
+    EXPECT_EQ(manager.getLastBinaryStamp("testhub.dronedb.app").entries(), 3);
+
+    const auto readSyncFile = [&db]() {
+        std::ifstream in(db->ddbDirectory() / SYNCFILE);
+        json j;
+        in >> j;
+        return j;
+    };
+
+    // Older versions don't find (and can't misread) the stamp file
+    json j = readSyncFile();
+    EXPECT_FALSE(j.contains("testhub.dronedb.app"));
+    EXPECT_EQ(j["version"], SYNC_FORMAT_VERSION);
+    EXPECT_TRUE(j[SYNC_STAMP_FILES]["testhub.dronedb.app"].is_string());
+
+    // Only the latest stamp file is kept
+    int stampFiles = 0;
+    for (const auto &f : fs::directory_iterator(db->ddbDirectory() / SYNC_STAMPS_FOLDER)) {
+        (void)f;
+        stampFiles++;
+    }
+    EXPECT_EQ(stampFiles, 1);
+
+    // A stamp written inline by an older version takes precedence
+    stamp["entries"].erase(2);
+    j["testhub.dronedb.app"] = stamp;
+    {
+        std::ofstream out(db->ddbDirectory() / SYNCFILE);
+        out << j.dump();
+    }
+    EXPECT_EQ(manager.getLastStamp("testhub.dronedb.app"), stamp);
+    EXPECT_FALSE(readSyncFile().contains("testhub.dronedb.app"));
+
+    // New registries start from the current index
+    EXPECT_EQ(manager.getLastStamp("other.dronedb.app"), db->getStamp());
+
+    // Files written by newer versions are not touched
+    j = readSyncFile();
+    j["version"] = SYNC_FORMAT_VERSION + 1;
+    {
+        std::ofstream out(db->ddbDirectory() / SYNCFILE);
+        out << j.dump();
+    }
+    EXPECT_THROW(manager.getLastStamp("testhub.dronedb.app"), AppException);
+}
 }  // namespace
@@ -0,0 +1,140 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include "dbops.h"
+#include "entry_types.h"
+#include "gtest/gtest.h"
+#include "pathquery.h"
+#include "test.h"
+#include "testarea.h"
+
+namespace {
+
+using namespace ddb;
+
+TEST(pathQuery, prefixUpperBound) {
+    EXPECT_EQ(prefixUpperBound("a/"), "a0");
+    EXPECT_EQ(prefixUpperBound("abc"), "abd");
+    EXPECT_EQ(prefixUpperBound(std::string("a\xff", 2)), "b");
+    EXPECT_EQ(prefixUpperBound(std::string("\xff\xff", 2)), "");
+    EXPECT_EQ(prefixUpperBound(""), "");
+}
+
+TEST(pathQuery, conditions) {
+    auto c = folderCondition("pics");
+    EXPECT_EQ(c.sql, "(path >= ? AND path < ?)");
+    EXPECT_EQ(c.params, std::vector<std::string>({"pics/", "pics0"}));
+
+    c = patternCondition("");
+    EXPECT_EQ(c.sql, "path LIKE ? ESCAPE '/'");
+    EXPECT_EQ(c.params, std::vector<std::string>({"%"}));
+
+    c = patternCondition("*.JPG", "e.path");
+    EXPECT_EQ(c.sql, "e.path LIKE ? ESCAPE '/'");
+    EXPECT_EQ(c.params, std::vector<std::string>({"%.JPG"}));
+
+    c = patternCondition("Pics/a.JPG");
+    EXPECT_EQ(c.sql, "(lower(path) = ? AND path LIKE ? ESCAPE '/')");
+    EXPECT_EQ(c.params, std::vector<std::string>({"pics/a.jpg", "Pics//a.JPG"}));
+
+    c = patternCondition("Pics/IMG_*");
+    EXPECT_EQ(c.sql, "(lower(path) >= ? AND lower(path) < ? AND path LIKE ? ESCAPE '/')");
+    EXPECT_EQ(c.params, std::vector<std::string>({"pics/img", "pics/imh", "Pics//IMG_%"}));
+}
+
+TEST(pathQuery, matches) {
+    TestArea ta(TEST_NAME);
+    const auto testFolder = ta.getFolder("test");
+    initIndex(testFolder.string());
+    auto db = ddb::open(testFolder.string(), false);
+
+    for (const auto &p : {"a", "a/b.JPG", "a/c", "a/c/d.jpg", "a.txt", "a0", "B.jpg"}) {
+        auto q = db->query("INSERT INTO entries (path, type, depth) VALUES (?, 0, ?)");
+        q->bind(1, p);
+        q->bind(2, static_cast<int>(std::count(p, p + strlen(p), '/')));
+        q->execute();
+    }
+
+    const auto select = [&db](const PathCondition &c) {
+        auto q = db->query("SELECT path FROM entries WHERE " + c.sql + " ORDER BY path");
+        c.bind(q.get());
+
+        std::vector<std::string> res;
+        while (q->fetch()) res.push_back(q->getText(0));
+        return res;
+    };
+
+    EXPECT_EQ(select(folderCondition("a")), std::vector<std::string>({"a/b.JPG", "a/c", "a/c/d.jpg"}));
+    EXPECT_EQ(select(patternCondition("A/B.jpg")), std::vector<std::string>({"a/b.JPG"}));
+    EXPECT_EQ(select(patternCondition("a*")), std::vector<std::string>({"a", "a.txt", "a/b.JPG", "a/c", "a/c/d.jpg", "a0"}));
+    EXPECT_EQ(select(patternCondition("*.jpg")), std::vector<std::string>({"B.jpg", "a/b.JPG", "a/c/d.jpg"}));
+    EXPECT_EQ(select(patternCondition("a_txt")), std::vector<std::string>({"a.txt"}));
+}
+
+// Synthetic index with 1M entries (100 folders x 100 subfolders x 100 files).
+// Run with --gtest_also_run_disabled_tests
+TEST(pathQuery, DISABLED_benchmark) {
+    TestArea ta(TEST_NAME);
+    const auto testFolder = ta.getFolder("test");
+    initIndex(testFolder.string());
+    auto db = ddb::open(testFolder.string(), false);
+
+    db->exec("BEGIN TRANSACTION");
+    auto q = db->query("INSERT INTO entries (path, type, depth) VALUES (?, ?, ?)");
+    const auto insert = [&q](const std::string &path, EntryType type, int depth) {
+        q->bind(1, path);
+        q->bind(2, static_cast<int>(type));
+        q->bind(3, depth);
+        q->execute();
+    };
+
+    for (int i = 0; i < 100; i++) {
+        const auto a = "folder" + std::to_string(i);
+        insert(a, EntryType::Directory, 0);
+        for (int j = 0; j < 100; j++) {
+            const auto b = a + "/sub" + std::to_string(j);
+            insert(b, EntryType::Directory, 1);
+            for (int k = 0; k < 100; k++) {
+                insert(b + "/IMG_" + std::to_string(k) + ".JPG", EntryType::Image, 2);
+            }
+        }
+    }
+    db->exec("COMMIT");
+
+    const auto time = [](const std::string &label, const std::function<void()> &f) {
+        const auto start = std::chrono::steady_clock::now();
+        f();
+        const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+        std::cout << label << ": " << ms << " ms" << std::endl;
+    };
+
+    time("listIndex folder", [&]() {
+        std::ostringstream out;
+        listIndex(db.get(), { (testFolder / "folder50" / "sub50").string() }, out, "text");
+        const auto res = out.str();
+        EXPECT_EQ(std::count(res.begin(), res.end(), '\n'), 100);
+    });
+
+    time("listIndex root", [&]() {
+        std::ostringstream out;
+        listIndex(db.get(), {}, out, "text");
+    });
+
+    time("searchIndex prefix", [&]() {
+        std::ostringstream out;
+        searchIndex(db.get(), "folder7/sub7/*", out, "text");
+        const auto res = out.str();
+        EXPECT_EQ(std::count(res.begin(), res.end(), '\n'), 100);
+    });
+
+    time("deleteFromIndex folder", [&]() {
+        EXPECT_EQ(deleteFromIndex(db.get(), "folder99", true), 100 * 100 + 100);
+    });
+}
+
+}
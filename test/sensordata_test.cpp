@@ -0,0 +1,48 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include <thread>
+#include "gtest/gtest.h"
+#include "sensor_data.h"
+#include "exceptions.h"
+
+namespace {
+
+using namespace ddb;
+
+TEST(sensorData, Normal) {
+    EXPECT_FALSE(SensorData::contains("not a sensor"));
+    EXPECT_FALSE(SensorData::contains(""));
+    EXPECT_THROW(SensorData::getFocal("not a sensor"), DBException);
+
+    if (SensorData::contains("dji fc300s")) {
+        EXPECT_GT(SensorData::getFocal("dji fc300s"), 0);
+    }
+}
+
+TEST(sensorData, Parallel) {
+    const std::vector<std::string> sensors = {"dji fc300s", "dji fc6310", "not a sensor", "sony dsc-rx100m2"};
+
+    std::vector<double> expected;
+    for (const auto &s : sensors) {
+        expected.push_back(SensorData::contains(s) ? SensorData::getFocal(s) : -1);
+    }
+
+    std::vector<std::thread> threads;
+    std::vector<int> matches(8, 0);
+    for (size_t t = 0; t < matches.size(); t++) {
+        threads.emplace_back([&, t]() {
+            for (int i = 0; i < 10000; i++) {
+                const size_t j = i % sensors.size();
+                const double focal = SensorData::contains(sensors[j]) ? SensorData::getFocal(sensors[j]) : -1;
+                if (focal == expected[j]) matches[t]++;
+            }
+        });
+    }
+    for (auto &t : threads) t.join();
+
+    for (int m : matches) EXPECT_EQ(m, 10000);
+}
+
+}
@@ -0,0 +1,235 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include <algorithm>
+#include <random>
+#include "dbops.h"
+#include "delta.h"
+#include "gtest/gtest.h"
+#include "stamptree.h"
+#include "test.h"
+#include "testarea.h"
+
+namespace {
+
+using namespace ddb;
+
+void addEntry(Database *db, const std::string &path, const std::string &hash) {
+    auto q = db->query("INSERT OR REPLACE INTO entries (path, hash, type, depth) VALUES (?, ?, ?, ?)");
+    q->bind(1, path);
+    q->bind(2, hash);
+    q->bind(3, hash.empty() ? 1 : 2);
+    q->bind(4, static_cast<int>(std::count(path.begin(), path.end(), '/')));
+    q->execute();
+}
+
+void addMeta(Database *db, const std::string &id, const std::string &path) {
+    auto q = db->query("INSERT INTO entries_meta (id, path, key, data, mtime) VALUES (?, ?, 'tags', '\"x\"', 0)");
+    q->bind(1, id);
+    q->bind(2, path);
+    q->execute();
+}
+
+void sortMeta(Delta &d) {
+    std::sort(d.metaAdds.begin(), d.metaAdds.end());
+    std::sort(d.metaRemoves.begin(), d.metaRemoves.end());
+}
+
+void expectSameDelta(Database *source, Database *target) {
+    Delta expected = getDelta(source->getStamp(), target->getStamp());
+    sortMeta(expected);
+
+    // Out of date trees fall back to the stamps, without writing
+    Delta d = getDelta(source, target);
+    sortMeta(d);
+    EXPECT_EQ(json(d).dump(), json(expected).dump());
+
+    source->getStampTree()->update();
+    target->getStampTree()->update();
+    d = getDelta(source, target);
+    sortMeta(d);
+    EXPECT_EQ(json(d).dump(), json(expected).dump());
+}
+
+TEST(stampTree, incremental) {
+    TestArea ta(TEST_NAME);
+    const auto testFolder = ta.getFolder("test");
+    initIndex(testFolder.string());
+    auto db = ddb::open(testFolder.string(), false);
+    auto tree = db->getStampTree();
+
+    EXPECT_FALSE(tree->isUpToDate());
+    EXPECT_EQ(tree->hash(), "");
+    tree->update();
+    EXPECT_TRUE(tree->isUpToDate());
+    const std::string empty = tree->hash();
+    EXPECT_FALSE(empty.empty());
+
+    for (const auto &p : {"a", "a/b", "c"}) addEntry(db.get(), p, "");
+    addEntry(db.get(), "a/b/1.jpg", "h1");
+    addEntry(db.get(), "a/b/2.jpg", "h2");
+    addEntry(db.get(), "c/3.jpg", "h3");
+    addMeta(db.get(), "m1", "a/b/1.jpg");
+
+    // Reads don't update the tree
+    EXPECT_FALSE(tree->isUpToDate());
+    EXPECT_EQ(tree->hash(), empty);
+    {
+        auto q = db->query("SELECT COUNT(*) FROM stamp_dirty");
+        EXPECT_TRUE(q->fetch());
+        EXPECT_GT(q->getInt(0), 0);
+    }
+
+    tree->update();
+    const std::string root = tree->hash();
+    const std::string a = tree->hash("a");
+    const std::string ab = tree->hash("a/b");
+    const std::string c = tree->hash("c");
+    EXPECT_NE(root, empty);
+    EXPECT_FALSE(a.empty());
+    EXPECT_FALSE(ab.empty());
+    EXPECT_EQ(tree->hash("a/b/1.jpg"), "");
+
+    auto n = tree->node("a/b");
+    EXPECT_EQ(n.entries.size(), 2);
+    EXPECT_EQ(n.entries[0].path, "a/b/1.jpg");
+    EXPECT_TRUE(n.folders.empty());
+    EXPECT_EQ(n.meta, std::vector<std::string>({"m1"}));
+
+    n = tree->node("");
+    EXPECT_EQ(n.entries.size(), 2);
+    EXPECT_EQ(n.folders.size(), 2);
+
+    // Changes only affect the ancestors of the changed entry
+    addEntry(db.get(), "a/b/2.jpg", "h2b");
+    tree->update();
+    EXPECT_NE(tree->hash(), root);
+    EXPECT_NE(tree->hash("a"), a);
+    EXPECT_NE(tree->hash("a/b"), ab);
+    EXPECT_EQ(tree->hash("c"), c);
+
+    addEntry(db.get(), "a/b/2.jpg", "h2");
+    tree->update();
+    EXPECT_EQ(tree->hash(), root);
+    EXPECT_EQ(tree->hash("a/b"), ab);
+
+    {
+        auto q = db->query("SELECT COUNT(*) FROM stamp_dirty");
+        EXPECT_TRUE(q->fetch());
+        EXPECT_EQ(q->getInt(0), 0);
+    }
+
+    // Meta
+    addMeta(db.get(), "m2", "c");
+    tree->update();
+    EXPECT_NE(tree->hash(), root);
+    EXPECT_EQ(tree->hash("c"), c);
+    db->exec("DELETE FROM entries_meta WHERE id = 'm2'");
+    tree->update();
+    EXPECT_EQ(tree->hash(), root);
+
+    // Moves
+    db->exec("UPDATE entries SET path = 'd' || substr(path, 2) WHERE path = 'c' OR path LIKE 'c/%'");
+    tree->update();
+    EXPECT_EQ(tree->hash("c"), "");
+    EXPECT_NE(tree->hash("d"), c);
+    EXPECT_NE(tree->hash(), root);
+
+    db->exec("UPDATE entries SET path = 'c' || substr(path, 2) WHERE path = 'd' OR path LIKE 'd/%'");
+    tree->update();
+    EXPECT_EQ(tree->hash(), root);
+
+    // Removes
+    db->exec("DELETE FROM entries WHERE path LIKE 'a/%' OR path = 'a'");
+    db->exec("DELETE FROM entries_meta WHERE id = 'm1'");
+    tree->update();
+    EXPECT_EQ(tree->hash("a/b"), "");
+    EXPECT_EQ(tree->hash("a"), "");
+
+    {
+        auto q = db->query("SELECT COUNT(*) FROM stamp_tree");
+        EXPECT_TRUE(q->fetch());
+        EXPECT_EQ(q->getInt(0), 2); // root, c
+    }
+
+    // Incremental updates match a full rebuild
+    const std::string current = tree->hash();
+    tree->rebuild();
+    EXPECT_EQ(tree->hash(), current);
+    EXPECT_EQ(tree->hash("c"), c);
+}
+
+TEST(stampTree, delta) {
+    TestArea ta(TEST_NAME);
+    const auto sourceFolder = ta.getFolder("source");
+    const auto targetFolder = ta.getFolder("target");
+    initIndex(sourceFolder.string());
+    initIndex(targetFolder.string());
+    auto source = ddb::open(sourceFolder.string(), false);
+    auto target = ddb::open(targetFolder.string(), false);
+
+    expectSameDelta(source.get(), target.get());
+
+    std::mt19937 rng(42);
+    const auto randomPath = [&rng]() {
+        std::string p;
+        const int depth = 1 + rng() % 4;
+        for (int i = 0; i < depth; i++) {
+            if (i > 0) p += "/";
+            p += std::string(1, 'a' + rng() % 3);
+        }
+        return p;
+    };
+
+    for (int round = 0; round < 20; round++) {
+        for (Database *db : {source.get(), target.get()}) {
+            for (int i = 0; i < 20; i++) {
+                const std::string p = randomPath();
+                switch (rng() % 5) {
+                    case 0:
+                        addEntry(db, p, "");
+                        break;
+                    case 1:
+                    case 2:
+                        addEntry(db, p, "h" + std::to_string(rng() % 3));
+                        break;
+                    case 3: {
+                        auto q = db->query("DELETE FROM entries WHERE path = ?");
+                        q->bind(1, p);
+                        q->execute();
+                        break;
+                    }
+                    case 4:
+                        db->exec("INSERT OR IGNORE INTO entries_meta (id, path, key, data, mtime) VALUES ('m" +
+                                 std::to_string(rng() % 50) + "', '" + p + "', 'tags', '\"x\"', 0)");
+                        break;
+                }
+            }
+        }
+
+        expectSameDelta(source.get(), target.get());
+        expectSameDelta(target.get(), source.get());
+    }
+
+    // Identical indexes
+    auto q = target->query("ATTACH DATABASE ? AS src");
+    q->bind(1, source->getOpenFile());
+    q->execute();
+    q.reset();
+    target->exec(R"<<<(
+        DELETE FROM entries;
+        DELETE FROM entries_meta;
+        INSERT INTO entries (path, hash, type, depth) SELECT path, hash, type, depth FROM src.entries;
+        INSERT INTO entries_meta SELECT * FROM src.entries_meta;
+        DETACH DATABASE src;
+    )<<<");
+
+    EXPECT_EQ(source->getStamp()["checksum"], target->getStamp()["checksum"]);
+    source->getStampTree()->update();
+    target->getStampTree()->update();
+    EXPECT_EQ(source->getStampTree()->hash(), target->getStampTree()->hash());
+    EXPECT_TRUE(getDelta(source.get(), target.get()).empty());
+}
+
+}
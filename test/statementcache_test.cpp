@@ -0,0 +1,137 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include <cstring>
+#include "dbops.h"
+#include "gtest/gtest.h"
+#include "statementcache.h"
+#include "test.h"
+#include "testarea.h"
+
+namespace {
+
+using namespace ddb;
+
+TEST(statementCache, reuse) {
+    TestArea ta(TEST_NAME);
+    const auto testFolder = ta.getFolder("test");
+    initIndex(testFolder.string());
+    auto db = ddb::open(testFolder.string(), false);
+
+    auto cache = db->getStatementCache();
+    cache->resetCounters();
+
+    for (int i = 0; i < 10; i++) {
+        auto q = db->query("SELECT COUNT(*) FROM entries WHERE depth > ?");
+        q->bind(1, i);
+        EXPECT_TRUE(q->fetch());
+        EXPECT_EQ(q->getInt(0), 0);
+    }
+
+    EXPECT_EQ(cache->misses(), 1);
+    EXPECT_EQ(cache->hits(), 9);
+
+    // Handed back statements are reset and have no bindings
+    {
+        auto q = db->query("SELECT ?");
+        q->bind(1, 5);
+        EXPECT_TRUE(q->fetch());
+        EXPECT_EQ(q->getInt(0), 5);
+    }
+    {
+        auto q = db->query("SELECT ?");
+        EXPECT_TRUE(q->fetch());
+        EXPECT_EQ(q->getText(0), "");
+        EXPECT_FALSE(q->fetch());
+    }
+}
+
+TEST(statementCache, concurrentUse) {
+    TestArea ta(TEST_NAME);
+    const auto testFolder = ta.getFolder("test");
+    initIndex(testFolder.string());
+    auto db = ddb::open(testFolder.string(), false);
+
+    auto cache = db->getStatementCache();
+    cache->clear();
+    cache->resetCounters();
+
+    // The same SQL can be in use twice at the same time
+    auto a = db->query("SELECT 1 UNION ALL SELECT 2");
+    auto b = db->query("SELECT 1 UNION ALL SELECT 2");
+    EXPECT_TRUE(a->fetch());
+    EXPECT_TRUE(b->fetch());
+    EXPECT_TRUE(b->fetch());
+    EXPECT_EQ(a->getInt(0), 1);
+    EXPECT_EQ(b->getInt(0), 2);
+    EXPECT_EQ(cache->misses(), 2);
+
+    a.reset();
+    b.reset();
+    EXPECT_EQ(cache->size(), 2);
+}
+
+TEST(statementCache, eviction) {
+    TestArea ta(TEST_NAME);
+    const auto testFolder = ta.getFolder("test");
+    initIndex(testFolder.string());
+    auto db = ddb::open(testFolder.string(), false);
+
+    auto cache = db->getStatementCache();
+    cache->setCapacity(2);
+
+    for (int i = 0; i < 5; i++) {
+        db->query("SELECT " + std::to_string(i))->execute();
+    }
+    EXPECT_EQ(cache->size(), 2);
+
+    cache->resetCounters();
+    db->query("SELECT 4")->execute();
+    db->query("SELECT 0")->execute();
+    EXPECT_EQ(cache->hits(), 1);
+    EXPECT_EQ(cache->misses(), 1);
+}
+
+TEST(statement, typedAccess) {
+    TestArea ta(TEST_NAME);
+    const auto testFolder = ta.getFolder("test");
+    initIndex(testFolder.string());
+    auto db = ddb::open(testFolder.string(), false);
+
+    db->exec("CREATE TABLE t (s TEXT, i INTEGER, d REAL, b BLOB)");
+
+    const std::string text = std::string("a\0b", 3);
+    const unsigned char blob[] = {0, 1, 2, 255};
+    auto q = db->query("INSERT INTO t VALUES (?, ?, ?, ?)");
+    q->bind(1, std::string_view(text));
+    q->bind(2, 42LL);
+    q->bind(3, 1.5);
+    q->bindBlob(4, blob, sizeof(blob));
+    q->execute();
+
+    q = db->query("INSERT INTO t VALUES (?, NULL, NULL, NULL)");
+    q->bindNull(1);
+    q->execute();
+
+    q = db->query("SELECT s, i, d, b FROM t ORDER BY rowid");
+    ASSERT_TRUE(q->fetch());
+    EXPECT_EQ(q->getTextView(0), text);
+    EXPECT_EQ(q->getBlobSize(3), 4);
+    EXPECT_EQ(memcmp(q->getBlob(3), blob, sizeof(blob)), 0);
+
+    const auto [s, i, d] = q->getRow<std::string, long long, double>();
+    EXPECT_EQ(s, text);
+    EXPECT_EQ(i, 42);
+    EXPECT_DOUBLE_EQ(d, 1.5);
+    EXPECT_TRUE(q->get<bool>(1));
+
+    ASSERT_TRUE(q->fetch());
+    EXPECT_TRUE(q->isNull(0));
+    EXPECT_TRUE(q->getTextView(0).empty());
+    EXPECT_EQ(q->get<std::string>(0), "");
+    EXPECT_EQ(q->get<int>(1), 0);
+    EXPECT_FALSE(q->fetch());
+}
+
+}
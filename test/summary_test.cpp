@@ -0,0 +1,134 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include "dbops.h"
+#include "gtest/gtest.h"
+#include "test.h"
+#include "testarea.h"
+
+namespace {
+
+using namespace ddb;
+
+void addEntry(Database *db, const std::string &path, EntryType type, long long size,
+              const std::string &properties = "{}", const std::string &point = "",
+              const std::string &polygon = "") {
+    auto q = db->query("INSERT OR REPLACE INTO entries (path, type, size, properties, point_geom, polygon_geom) "
+                       "VALUES (?, ?, ?, ?, GeomFromText(nullif(?, ''), 4326), GeomFromText(nullif(?, ''), 4326))");
+    q->bind(1, path);
+    q->bind(2, static_cast<int>(type));
+    q->bind(3, size);
+    q->bind(4, properties);
+    q->bind(5, point);
+    q->bind(6, polygon);
+    q->execute();
+}
+
+void expectSameSummary(const Summary &a, const Summary &b) {
+    EXPECT_EQ(a.entries, b.entries);
+    EXPECT_EQ(a.size, b.size);
+    EXPECT_EQ(a.types, b.types);
+    EXPECT_EQ(a.hasExtent, b.hasExtent);
+    EXPECT_DOUBLE_EQ(a.minx, b.minx);
+    EXPECT_DOUBLE_EQ(a.miny, b.miny);
+    EXPECT_DOUBLE_EQ(a.maxx, b.maxx);
+    EXPECT_DOUBLE_EQ(a.maxy, b.maxy);
+    EXPECT_EQ(a.hasCaptureTime, b.hasCaptureTime);
+    EXPECT_DOUBLE_EQ(a.minCaptureTime, b.minCaptureTime);
+    EXPECT_DOUBLE_EQ(a.maxCaptureTime, b.maxCaptureTime);
+}
+
+TEST(summary, incremental) {
+    TestArea ta(TEST_NAME);
+    const auto testFolder = ta.getFolder("test");
+    initIndex(testFolder.string());
+    auto db = ddb::open(testFolder.string(), false);
+
+    auto s = db->getSummary();
+    EXPECT_EQ(s.entries, 0);
+    EXPECT_EQ(s.size, 0);
+    EXPECT_TRUE(s.types.empty());
+    EXPECT_FALSE(s.hasExtent);
+    EXPECT_FALSE(s.hasCaptureTime);
+
+    auto extent = db->getExtent();
+    EXPECT_TRUE(extent["temporal"]["interval"][0][0].is_null());
+
+    addEntry(db.get(), "a", EntryType::Directory, 0);
+    addEntry(db.get(), "a/1.jpg", EntryType::GeoImage, 100,
+             R"({"captureTime": 1600000000000})", "POINT Z (10 20 100)");
+    addEntry(db.get(), "a/2.jpg", EntryType::GeoImage, 200,
+             R"({"captureTime": 1600000060000})", "POINT Z (11 21 100)");
+    addEntry(db.get(), "ortho.tif", EntryType::GeoRaster, 1000, "{}", "",
+             "POLYGON Z ((0 0 0, 5 0 0, 5 5 0, 0 5 0, 0 0 0))");
+    addEntry(db.get(), "notes.txt", EntryType::Generic, 5, "null");
+
+    s = db->getSummary();
+    EXPECT_EQ(s.entries, 5);
+    EXPECT_EQ(s.size, 1305);
+    EXPECT_EQ(s.types[EntryType::GeoImage], 2);
+    EXPECT_EQ(s.types[EntryType::Directory], 1);
+    EXPECT_EQ(s.types.size(), 4);
+    ASSERT_TRUE(s.hasExtent);
+    EXPECT_DOUBLE_EQ(s.minx, 0);
+    EXPECT_DOUBLE_EQ(s.miny, 0);
+    EXPECT_DOUBLE_EQ(s.maxx, 11);
+    EXPECT_DOUBLE_EQ(s.maxy, 21);
+    ASSERT_TRUE(s.hasCaptureTime);
+    EXPECT_DOUBLE_EQ(s.minCaptureTime, 1600000000000);
+    EXPECT_DOUBLE_EQ(s.maxCaptureTime, 1600000060000);
+
+    extent = db->getExtent();
+    EXPECT_EQ(extent["spatial"]["bbox"][0], json::array({0.0, 0.0, 11.0, 21.0}));
+    EXPECT_EQ(extent["temporal"]["interval"][0][0], "2020-09-13T12:26:40.000Z");
+    EXPECT_EQ(extent["temporal"]["interval"][0][1], "2020-09-13T12:27:40.000Z");
+
+    EXPECT_EQ(db->getProperties()["entries"], 5);
+
+    // Removing entries on the bounds shrinks them
+    db->exec("DELETE FROM entries WHERE path = 'a/2.jpg'");
+    s = db->getSummary();
+    EXPECT_EQ(s.entries, 4);
+    EXPECT_EQ(s.size, 1105);
+    EXPECT_EQ(s.types[EntryType::GeoImage], 1);
+    EXPECT_DOUBLE_EQ(s.maxx, 10);
+    EXPECT_DOUBLE_EQ(s.maxy, 20);
+    EXPECT_DOUBLE_EQ(s.maxCaptureTime, 1600000000000);
+
+    // Reading doesn't store the recomputed bounds, refreshing does
+    const auto dirty = [&db]() {
+        auto q = db->query("SELECT dirty FROM entries_summary");
+        return q->fetch() && q->getInt(0) != 0;
+    };
+    EXPECT_TRUE(dirty());
+    db->refreshSummary();
+    EXPECT_FALSE(dirty());
+    expectSameSummary(s, db->getSummary());
+
+    // Updates
+    addEntry(db.get(), "ortho.tif", EntryType::GeoRaster, 2000, "{}", "",
+             "POLYGON Z ((-1 -2 0, 5 -2 0, 5 5 0, -1 5 0, -1 -2 0))");
+    db->exec("UPDATE entries SET type = 2 WHERE path = 'a/1.jpg'");
+    s = db->getSummary();
+    EXPECT_EQ(s.entries, 4);
+    EXPECT_EQ(s.size, 2105);
+    EXPECT_EQ(s.types.count(EntryType::GeoImage), 0);
+    EXPECT_EQ(s.types[EntryType::Generic], 2);
+    EXPECT_DOUBLE_EQ(s.minx, -1);
+    EXPECT_DOUBLE_EQ(s.miny, -2);
+
+    // Incremental updates match a full rebuild
+    db->rebuildSummary();
+    expectSameSummary(s, db->getSummary());
+
+    db->exec("DELETE FROM entries");
+    s = db->getSummary();
+    EXPECT_EQ(s.entries, 0);
+    EXPECT_EQ(s.size, 0);
+    EXPECT_TRUE(s.types.empty());
+    EXPECT_FALSE(s.hasExtent);
+    EXPECT_FALSE(s.hasCaptureTime);
+}
+
+}
@@ -0,0 +1,44 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include <atomic>
+#include "gtest/gtest.h"
+#include "threadpool.h"
+
+namespace {
+
+using namespace ddb;
+
+TEST(threadPool, runsAllTasks) {
+    ThreadPool pool(4);
+    EXPECT_EQ(pool.size(), 4);
+
+    std::atomic<int> counter(0);
+    std::vector<std::future<int>> results;
+    for (int i = 0; i < 1000; i++){
+        results.push_back(pool.submit([i, &counter](){
+            counter++;
+            return i * 2;
+        }));
+    }
+
+    for (int i = 0; i < 1000; i++){
+        EXPECT_EQ(results[i].get(), i * 2);
+    }
+    EXPECT_EQ(counter, 1000);
+}
+
+TEST(threadPool, propagatesExceptions) {
+    ThreadPool pool(2);
+    auto f = pool.submit([]() -> int { throw std::runtime_error("fail"); });
+    EXPECT_THROW(f.get(), std::runtime_error);
+}
+
+TEST(threadPool, defaultSize) {
+    ThreadPool pool;
+    EXPECT_EQ(pool.size(), ThreadPool::defaultThreadCount());
+    EXPECT_GE(pool.size(), 1);
+}
+
+}
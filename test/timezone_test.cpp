@@ -0,0 +1,55 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/. */
+
+#include <chrono>
+#include <thread>
+#include "gtest/gtest.h"
+#include "timezone.h"
+
+namespace {
+
+TEST(timezoneLookup, Normal) {
+    EXPECT_EQ(Timezone::lookupTimezone(41.9028, 12.4964).name(), "Europe/Rome");
+    EXPECT_EQ(Timezone::lookupTimezone(41.9030, 12.4966).name(), "Europe/Rome");
+
+    // Cached results are not reused across a nearby border
+    EXPECT_EQ(Timezone::lookupTimezone(42.3314, -83.0458).name(), "America/Detroit");
+    EXPECT_EQ(Timezone::lookupTimezone(42.3149, -83.0364).name(), "America/Toronto");
+    EXPECT_EQ(Timezone::lookupTimezone(42.3314, -83.0458).name(), "America/Detroit");
+}
+
+TEST(timezoneLookup, Parallel) {
+    std::vector<std::thread> threads;
+    std::vector<int> matches(8, 0);
+
+    for (size_t t = 0; t < matches.size(); t++) {
+        threads.emplace_back([&matches, t]() {
+            for (int i = 0; i < 1000; i++) {
+                if (Timezone::lookupTimezone(46.84 + i * 0.00001, -91.99).name() == "America/Chicago") matches[t]++;
+            }
+        });
+    }
+    for (auto &t : threads) t.join();
+
+    for (int m : matches) EXPECT_EQ(m, 1000);
+}
+
+TEST(timezoneLookup, DISABLED_benchmark) {
+    const int count = 50000;
+
+    // A flight over a few km
+    auto start = std::chrono::steady_clock::now();
+    int matches = 0;
+    for (int i = 0; i < count; i++) {
+        const double lat = 46.84 + (i % 500) * 0.0001;
+        const double lon = -91.99 + (i / 500) * 0.0001;
+        if (Timezone::lookupTimezone(lat, lon).name() == "America/Chicago") matches++;
+    }
+    const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+    EXPECT_EQ(matches, count);
+    std::cout << count << " lookups: " << ms << " ms" << std::endl;
+}
+
+}